@@ -1,256 +1,654 @@
 #include "Arm_Lib.h"
+#include "mpsc_ring.h"
 #include <iostream>
 #include <stdexcept>
-#include <cstring>      // For bzero, strerror
-#include <unistd.h>     // For open, close, write, usleep
-#include <fcntl.h>      // For O_RDWR, O_NOCTTY
-#include <termios.h>    // For termios, tcgetattr, tcsetattr
-#include <cerrno>       // For errno
-#include <sys/select.h> // For select
-#include <sys/time.h>
-#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <iomanip>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+namespace {
+    // Pings timed by the low-latency round-trip measurement
+    constexpr int LINK_RTT_PROBES = 8;
+
+    // Unit of work handed to the I/O thread in async mode
+    struct IoJob {
+        enum class Kind : uint8_t { Write, Ping, Read, ReadRaw, Read6, Barrier, Forget };
+
+        Kind kind = Kind::Write;
+        uint8_t len = 0;
+        std::array<uint8_t, arm_protocol::MAX_FRAME_SIZE> bytes{};
+        int id = 0;
+        const char* context = nullptr; // Error prefix for Write jobs
+        std::unique_ptr<std::promise<int>> reply;
+        std::unique_ptr<std::promise<Arm_ServoReadings>> readings;
+    };
 
-// Constructor: Opens and configures the serial port
-Arm_Device::Arm_Device(const std::string& com) : port_name(com), ser_fd(-1) {
-    // Open the serial port
-    // O_RDWR: Read/Write
-    // O_NOCTTY: Not the controlling terminal
-    // O_NDELAY: Non-blocking (we'll set timeouts later)
-    ser_fd = open(port_name.c_str(), O_RDWR | O_NOCTTY);
-    if (ser_fd == -1) {
-        throw std::runtime_error("Failed to open serial port: " + port_name + " - " + strerror(errno));
+    void validate_position(const CalibrationProfile& calibration, int id, uint16_t pos) {
+        if (pos < calibration.min_position(id) || pos > calibration.max_position(id)) {
+            throw std::out_of_range("Servo " + std::to_string(id) + " position must be between " +
+                                    std::to_string(calibration.min_position(id)) + " and " +
+                                    std::to_string(calibration.max_position(id)) + ".");
+        }
     }
 
-    // Configure the serial port
-    struct termios tty;
-    std::memset(&tty, 0, sizeof(tty));
+    int64_t steady_now_ns() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
 
-    if (tcgetattr(ser_fd, &tty) != 0) {
-        close(ser_fd);
-        throw std::runtime_error("Failed to get serial attributes: " + std::string(strerror(errno)));
+    // Keeps the stock wording for the stock ranges
+    std::string angle_range_message(const CalibrationProfile& calibration, int id) {
+        return std::string(id == 5 ? "Servo 5 angle" : "Servo angle") + " must be between 0 and " +
+               std::to_string(calibration.max_angle(id)) + ".";
     }
 
-    // Set Baud Rate (115200)
-    cfsetospeed(&tty, B115200);
-    cfsetispeed(&tty, B115200);
+    template <typename T>
+    std::future<T> ready_future(T value) {
+        std::promise<T> promise;
+        promise.set_value(std::move(value));
+        return promise.get_future();
+    }
+}
 
-    // Set Port Settings
-    tty.c_cflag &= ~PARENB;        // No parity
-    tty.c_cflag &= ~CSTOPB;        // 1 stop bit
-    tty.c_cflag &= ~CSIZE;         // Clear data size bits
-    tty.c_cflag |= CS8;            // 8 data bits
-    tty.c_cflag &= ~CRTSCTS;       // No hardware flow control
-    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control lines
+struct Arm_Device::AsyncState {
+    explicit AsyncState(const Arm_Options& options)
+        : ring(options.queue_capacity),
+          coalesce(options.coalesce_motion),
+          max_tx_backlog(options.max_tx_backlog),
+          batch_window(options.coalesce_motion ? 0 : options.batch_window_us) {}
+
+    MpscRing<IoJob> ring;
+    std::thread thread;
+    std::atomic<bool> stop{false};
+
+    // The I/O thread parks on the condition variable only when the ring is
+    // empty; producers take the mutex only if they see it parked.
+    std::atomic<bool> idle{false};
+    std::mutex wake_mutex;
+    std::condition_variable wake;
+
+    std::atomic<uint64_t> submitted{0};
+    std::atomic<uint64_t> dropped{0};
+    std::atomic<uint64_t> coalesced{0};
+    std::atomic<uint64_t> batched{0};
+    std::atomic<uint64_t> frames_saved{0};
+    std::atomic<uint64_t> syscalls_saved{0};
+
+    // Latest-value motion slots, one per joint. A slot packs
+    // MOTION_PENDING | MOTION_GROUP | position << 16 | time, and motion_mask
+    // has bit (id - 1) set while joint id has a target waiting.
+    static constexpr uint64_t MOTION_PENDING = 1ull << 63;
+    static constexpr uint64_t MOTION_GROUP = 1ull << 62;
+    const bool coalesce;
+    const size_t max_tx_backlog;
+    std::array<std::atomic<uint64_t>, 6> motion{};
+    std::atomic<uint32_t> motion_mask{0};
+
+    // Batching window state, touched by the I/O thread only. commanded holds
+    // the last position sent to each joint, or read back from it while none
+    // was known; bit (id - 1) of commanded_mask is set once joint id has one.
+    const std::chrono::microseconds batch_window;
+    std::array<uint16_t, 6> commanded{};
+    uint8_t commanded_mask = 0;
+    std::array<uint16_t, 6> batch_pos{};
+    uint8_t batch_mask = 0;
+    uint16_t batch_time = 0;
+    uint64_t batch_writes = 0;
+    std::chrono::steady_clock::time_point batch_deadline;
+
+    /**
+     * @brief Records the positions carried by a motion frame that reached the port.
+     */
+    void remember_motion(const uint8_t* frame) {
+        const uint8_t cmd = frame[3];
+        if (cmd == arm_protocol::CMD_SERVO_WRITE6) {
+            for (int i = 0; i < 6; ++i) {
+                commanded[i] = static_cast<uint16_t>((frame[4 + 2 * i] << 8) | frame[5 + 2 * i]);
+            }
+            commanded_mask = 0x3F;
+        } else if (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6) {
+            const int i = cmd - arm_protocol::CMD_SERVO_WRITE_BASE - 1;
+            commanded[i] = static_cast<uint16_t>((frame[4] << 8) | frame[5]);
+            commanded_mask |= static_cast<uint8_t>(1u << i);
+        }
+    }
 
-    // Local flags (non-canonical mode)
-    tty.c_lflag &= ~ICANON; // Disable canonical mode
-    tty.c_lflag &= ~ECHO;   // Disable echo
-    tty.c_lflag &= ~ECHOE;  // Disable erasure
-    tty.c_lflag &= ~ECHONL; // Disable newline echo
-    tty.c_lflag &= ~ISIG;   // Disable interpretation of INTR, QUIT and SUSP
+    /**
+     * @brief Fills in joints with no known target from a read6. Joints that
+     *        have one keep it: mid-move, the measured position is not where
+     *        the joint is headed.
+     */
+    void remember_readings(const Arm_ServoReadings& readings) {
+        for (int i = 0; i < 6; ++i) {
+            if (!(commanded_mask & (1u << i)) && readings.status[i] == Arm_ReadStatus::Ok) {
+                commanded[i] = static_cast<uint16_t>(readings.positions[i]);
+                commanded_mask |= static_cast<uint8_t>(1u << i);
+            }
+        }
+    }
 
-    // Input flags (ignore parity)
-    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // Disable software flow control
-    tty.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL); // Disable special handling
-    tty.c_iflag |= IGNPAR;
+    /**
+     * @brief Publishes the newest target for joint @p id (1-6).
+     * @return true if it replaced a target that was never sent.
+     */
+    bool post_motion(int id, uint16_t pos, uint16_t time, bool group) {
+        const uint64_t packed = MOTION_PENDING | (group ? MOTION_GROUP : 0) |
+                                (static_cast<uint64_t>(pos) << 16) | time;
+        return (motion[id - 1].exchange(packed) & MOTION_PENDING) != 0;
+    }
 
-    // Output flags (raw output)
-    tty.c_oflag = 0;
+    /**
+     * @brief Marks the joints in @p joints as pending and wakes the I/O thread.
+     */
+    void commit_motion(uint32_t joints, bool replaced) {
+        if (replaced) {
+            coalesced.fetch_add(1, std::memory_order_relaxed);
+        }
+        motion_mask.fetch_or(joints);
+        wake_io();
+    }
 
-    // Set Timeouts (VMIN = 0, VTIME = 2)
-    // This matches the Python 'timeout=.2' (2 deciseconds = 0.2s)
-    tty.c_cc[VMIN] = 0;
-    tty.c_cc[VTIME] = 2;
+    /**
+     * @brief Drops every target still waiting in the motion slots.
+     */
+    void discard_motion() {
+        const uint32_t mask = motion_mask.exchange(0);
+        for (int i = 0; i < 6; ++i) {
+            if ((mask & (1u << i)) && (motion[i].exchange(0) & MOTION_PENDING)) {
+                coalesced.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+    }
 
-    // Apply the settings
-    if (tcsetattr(ser_fd, TCSANOW, &tty) != 0) {
-        close(ser_fd);
-        throw std::runtime_error("Failed to set serial attributes: " + std::string(strerror(errno)));
+    void wake_io() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (idle.load()) {
+            std::lock_guard<std::mutex> lock(wake_mutex);
+            wake.notify_one();
+        }
     }
 
-    // Sleep for 0.2s to let the port initialize, just like the Python code
-    usleep(200000); 
-    std::cout << "Serial port " << port_name << " opened successfully." << std::endl;
-}
+    /**
+     * @brief Queues a job. A motion frame that finds the ring full goes to the
+     *        per-joint motion slots, where only a newer target for the same
+     *        joint can replace it. Every other job waits for a free slot, and
+     *        for motion waiting in the slots (coalesced or overflowed) to be
+     *        sent first, so state changes such as torque off are never lost
+     *        or reordered and reads see the motion issued before them.
+     */
+    void push(IoJob& job) {
+        if (job.kind == IoJob::Kind::Write && !coalesce && is_motion(job.bytes[3])) {
+            // Once one target has overflowed, later ones must not overtake it through the ring
+            if (motion_mask.load() != 0 || !ring.try_push(job)) {
+                overflow_motion(job.bytes.data());
+                return;
+            }
+        } else {
+            while (motion_mask.load() != 0 || !ring.try_push(job)) {
+                std::this_thread::yield();
+            }
+        }
+        submitted.fetch_add(1, std::memory_order_relaxed);
+        wake_io();
+    }
 
-// Destructor: Closes the serial port
-Arm_Device::~Arm_Device() {
-    if (ser_fd != -1) {
-        close(ser_fd);
-        std::cout << "\nSerial port " << port_name << " closed." << std::endl;
+    static bool is_motion(uint8_t cmd) {
+        return cmd == arm_protocol::CMD_SERVO_WRITE6 ||
+               (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6);
     }
-}
 
-// Maps an angle to a servo position value
-uint16_t Arm_Device::map_angle_to_pos(int angle, int in_min, int in_max, int out_min, int out_max) {
-    long result = (long)(angle - in_min) * (out_max - out_min) / (in_max - in_min) + out_min;
-    return static_cast<uint16_t>(result);
-}
+    /**
+     * @brief Posts the targets of an encoded motion frame to the motion slots.
+     */
+    void overflow_motion(const uint8_t* frame) {
+        const auto word = [frame](int offset) { return static_cast<uint16_t>((frame[offset] << 8) | frame[offset + 1]); };
+        bool replaced = false;
+        uint32_t joints = 0;
+        if (frame[3] == arm_protocol::CMD_SERVO_WRITE6) {
+            for (int id = 1; id <= 6; ++id) {
+                replaced |= post_motion(id, word(2 + 2 * id), word(16), true);
+            }
+            joints = 0x3F;
+        } else {
+            const int id = frame[3] - arm_protocol::CMD_SERVO_WRITE_BASE;
+            replaced = post_motion(id, word(4), word(6), false);
+            joints = 1u << (id - 1);
+        }
+        if (replaced) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        motion_mask.fetch_or(joints);
+        wake_io();
+    }
+};
 
-// Calculates the checksum
-uint8_t Arm_Device::calculate_checksum(const std::vector<uint8_t>& cmd) {
-    // Start with the complement value (5), just like the Python code `sum(cmd, 5)`
-    uint16_t sum = __COMPLEMENT; 
-    for (uint8_t byte : cmd) {
-        sum += byte;
+bool Arm_ServoReadings::all_ok() const {
+    for (Arm_ReadStatus s : status) {
+        if (s != Arm_ReadStatus::Ok) {
+            return false;
+        }
     }
-    return static_cast<uint8_t>(sum & 0xFF); // Return the low byte
+    return true;
 }
 
-// Writes data to the serial port
-void Arm_Device::write_serial(const std::vector<uint8_t>& data) {
-    if (ser_fd == -1) {
-        throw std::runtime_error("Serial port is not open.");
+// Constructor: Opens and configures the serial port
+Arm_Device::Arm_Device(const std::string& com, const Arm_Options& options)
+    : Arm_Device(std::unique_ptr<Transport>(new TtyTransport(com, options.low_latency)), options) {
+}
+
+Arm_Device::Arm_Device(std::unique_ptr<Transport> transport, const Arm_Options& options)
+    : transport(std::move(transport)), calibration(options.calibration),
+      suppress_redundant(options.suppress_redundant) {
+    if (!this->transport) {
+        throw std::invalid_argument("Arm_Device needs a transport.");
     }
-    ssize_t n = write(ser_fd, data.data(), data.size());
-    if (n < 0) {
-        throw std::runtime_error("Serial write error: " + std::string(strerror(errno)));
+    if (!options.capture_path.empty()) {
+        recorder.reset(new FrameRecorder(options.capture_path));
     }
-    if (n < static_cast<ssize_t>(data.size())) {
-         std::cerr << "Warning: Only wrote " << n << " of " << data.size() << " bytes." << std::endl;
+    if (!options.metrics_path.empty() || !options.metrics_socket.empty()) {
+        MetricsExporterOptions export_options;
+        export_options.file_path = options.metrics_path;
+        export_options.socket_path = options.metrics_socket;
+        export_options.format = options.metrics_format;
+        export_options.interval = std::chrono::milliseconds(options.metrics_interval_ms);
+        export_options.instance = this->transport->name();
+        exporter.reset(new MetricsExporter([this] { return metrics.snapshot(); }, export_options));
     }
-}
-
-bool Arm_Device::read_byte(uint8_t& byte, unsigned int timeout_ms) {
-    if (ser_fd == -1) {
-        return false;
+    if (!options.pose_shm_name.empty()) {
+        pose_memory.reset(new SharedMemory(options.pose_shm_name, sizeof(PoseSnapshot), POSE_SNAPSHOT_LAYOUT,
+                                           SharedMemory::Mode::Create));
+        pose = new (pose_memory->data()) PoseSnapshot();
+    } else {
+        local_pose.reset(new PoseSnapshot());
+        pose = local_pose.get();
+    }
+    if (options.ready_timeout_ms > 0 && !wait_until_ready(options.ready_timeout_ms)) {
+        const std::string message = "Board on " + this->transport->name() + " did not answer within " +
+                                    std::to_string(options.ready_timeout_ms) + " ms";
+        if (options.require_ready) {
+            throw std::runtime_error(message + ".");
+        }
+        std::cerr << "Warning: " << message << "; continuing." << std::endl;
+    }
+    std::cout << "Serial port " << this->transport->name() << " opened successfully." << std::endl;
+    if (options.low_latency) {
+        // Not worth another timeout when the handshake already got no answer
+        if (options.ready_timeout_ms == 0 || time_to_ready_ms >= 0.0) {
+            measure_link_rtt();
+        }
+        const auto* tty = dynamic_cast<const TtyTransport*>(this->transport.get());
+        std::cout << "Low-latency mode: ASYNC_LOW_LATENCY "
+                  << (tty && tty->driver_low_latency() ? "set" : "not supported by this port") << ", round trip ";
+        if (link_rtt_ms < 0.0) {
+            std::cout << "unknown (no reply)";
+        } else {
+            std::cout << std::fixed << std::setprecision(2) << link_rtt_ms << " ms" << std::defaultfloat;
+        }
+        std::cout << '.' << std::endl;
     }
 
-    fd_set readfds;
-    FD_ZERO(&readfds);
-    FD_SET(ser_fd, &readfds);
+    if (options.async_io || options.coalesce_motion || options.batch_window_us > 0) {
+        async.reset(new AsyncState(options));
+        async->thread = std::thread(&Arm_Device::io_thread_main, this);
+    }
+}
 
-    struct timeval tv;
-    tv.tv_sec = timeout_ms / 1000;
-    tv.tv_usec = (timeout_ms % 1000) * 1000;
+// Destructor: Closes the serial port
+Arm_Device::~Arm_Device() {
+    if (async) {
+        // The I/O thread drains whatever is still queued before it exits
+        {
+            std::lock_guard<std::mutex> lock(async->wake_mutex);
+            async->stop = true;
+        }
+        async->wake.notify_one();
+        async->thread.join();
+    }
+    const std::string name = transport->name();
+    transport.reset();
+    std::cout << "\nSerial port " << name << " closed." << std::endl;
+    if (recorder) {
+        std::cout << "Captured " << recorder->frames() << " frames." << std::endl;
+    }
+    // Last, so the final export includes everything the I/O thread flushed
+    exporter.reset();
+}
 
-    int result = select(ser_fd + 1, &readfds, nullptr, nullptr, &tv);
-    if (result <= 0) {
-        return false;
+// Writes data to the serial port
+void Arm_Device::write_serial(const uint8_t* data, size_t len) {
+    const auto started = metrics.start();
+    size_t n = 0;
+    try {
+        n = transport->write(data, len);
+    } catch (const std::runtime_error&) {
+        metrics.add_write_error();
+        throw;
+    }
+    metrics.record_write(data, started);
+    metrics.add_tx(data, n);
+    if (n < len) {
+         metrics.add_partial_write();
+         std::cerr << "Warning: Only wrote " << n << " of " << len << " bytes." << std::endl;
     }
+    if (recorder) {
+        recorder->record(data, n);
+    }
+}
 
-    ssize_t n = ::read(ser_fd, &byte, 1);
-    if (n <= 0) {
-        return false;
+void Arm_Device::send_frame(const uint8_t* data, size_t len, const char* context) {
+    if (async) {
+        IoJob job;
+        job.kind = IoJob::Kind::Write;
+        job.len = static_cast<uint8_t>(std::min(len, job.bytes.size()));
+        std::copy(data, data + job.len, job.bytes.begin());
+        job.context = context;
+        async->push(job);
+        return;
     }
 
-    return true;
+    try {
+        write_serial(data, len);
+    } catch (const std::exception& e) {
+        std::cerr << context << " serial error: " << e.what() << std::endl;
+    }
 }
 
-bool Arm_Device::read_response(uint8_t& ext_type, std::vector<uint8_t>& payload, unsigned int timeout_ms) {
-    uint8_t head = 0;
-    while (read_byte(head, timeout_ms)) {
-        if (head != __HEAD) {
+void Arm_Device::io_thread_main() {
+    IoJob job;
+    for (;;) {
+        if (async->ring.try_pop(job)) {
+            const uint8_t cmd = job.bytes[3];
+            if (async->batch_window.count() > 0 && job.kind == IoJob::Kind::Write &&
+                cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6) {
+                const int i = cmd - arm_protocol::CMD_SERVO_WRITE_BASE - 1;
+                const uint16_t time = static_cast<uint16_t>((job.bytes[6] << 8) | job.bytes[7]);
+                if (async->batch_mask != 0 && time != async->batch_time) {
+                    flush_joint_batch();
+                }
+                if (async->batch_mask == 0) {
+                    async->batch_time = time;
+                    async->batch_deadline = std::chrono::steady_clock::now() + async->batch_window;
+                }
+                async->batch_pos[i] = static_cast<uint16_t>((job.bytes[4] << 8) | job.bytes[5]);
+                async->batch_mask |= static_cast<uint8_t>(1u << i);
+                ++async->batch_writes;
+                continue;
+            }
+            // Anything else keeps its place in the command order
+            flush_joint_batch();
+
+            switch (job.kind) {
+            case IoJob::Kind::Write:
+                try {
+                    write_serial(job.bytes.data(), job.len);
+                    async->remember_motion(job.bytes.data());
+                } catch (const std::exception& e) {
+                    std::cerr << job.context << " serial error: " << e.what() << std::endl;
+                }
+                break;
+            case IoJob::Kind::Ping:
+                job.reply->set_value(ping_servo_blocking(job.id));
+                break;
+            case IoJob::Kind::Read:
+                job.reply->set_value(decode_servo_angle(job.id, servo_read_raw_blocking(job.id)));
+                break;
+            case IoJob::Kind::ReadRaw:
+                job.reply->set_value(servo_read_raw_blocking(job.id));
+                break;
+            case IoJob::Kind::Read6: {
+                Arm_ServoReadings readings = servo_read6_blocking();
+                async->remember_readings(readings);
+                job.readings->set_value(readings);
+                break;
+            }
+            case IoJob::Kind::Barrier:
+                if (async->motion_mask.load() != 0) {
+                    flush_motion();
+                }
+                job.reply->set_value(0);
+                break;
+            case IoJob::Kind::Forget:
+                async->commanded_mask = 0;
+                break;
+            }
+            job.reply.reset();
+            job.readings.reset();
             continue;
         }
 
-        uint8_t device_id_minus_one = 0;
-        if (!read_byte(device_id_minus_one, timeout_ms)) {
-            return false;
+        if (async->batch_mask != 0 && std::chrono::steady_clock::now() >= async->batch_deadline) {
+            flush_joint_batch();
+            continue;
         }
-        if (device_id_minus_one != (__DEVICE_ID - 1)) {
+
+        if (async->motion_mask.load() != 0) {
+            if (tx_backlog() <= async->max_tx_backlog) {
+                // Per-joint writes taken from the ring before the overflow go out first
+                flush_joint_batch();
+                flush_motion();
+            } else {
+                // Let the UART drain (one write6 frame takes ~1.7 ms at 115200
+                // baud); newer targets keep replacing the pending ones meanwhile.
+                std::this_thread::sleep_for(std::chrono::microseconds(500));
+            }
             continue;
         }
 
-        uint8_t ext_len = 0;
-        if (!read_byte(ext_len, timeout_ms)) {
-            return false;
+        if (async->stop.load()) {
+            flush_joint_batch();
+            break;
         }
-        if (!read_byte(ext_type, timeout_ms)) {
-            return false;
+
+        // The 50 ms timeout only guards against a missed wake-up; producers notify us
+        auto wake_at = std::chrono::steady_clock::now() + std::chrono::milliseconds(50);
+        if (async->batch_mask != 0) {
+            wake_at = std::min(wake_at, async->batch_deadline);
         }
+        std::unique_lock<std::mutex> lock(async->wake_mutex);
+        async->idle.store(true);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        async->wake.wait_until(lock, wake_at, [this] {
+            return !async->ring.empty() || async->motion_mask.load() != 0 || async->stop.load();
+        });
+        async->idle.store(false);
+    }
+}
 
-        int data_len = static_cast<int>(ext_len) - 2;
-        if (data_len <= 0) {
-            return false;
+void Arm_Device::flush_motion() {
+    const uint32_t mask = async->motion_mask.exchange(0);
+
+    std::array<uint64_t, 6> slots{};
+    for (int i = 0; i < 6; ++i) {
+        if (mask & (1u << i)) {
+            slots[i] = async->motion[i].exchange(0);
         }
+    }
 
-        std::vector<uint8_t> buffer;
-        buffer.reserve(data_len > 0 ? data_len - 1 : 0);
-        uint16_t check_sum = ext_len + ext_type;
-        uint8_t rx_check_num = 0;
+    // A complete write6 that nothing has partially overwritten goes out as one frame
+    const uint64_t group_bits = AsyncState::MOTION_PENDING | AsyncState::MOTION_GROUP;
+    bool whole_group = true;
+    for (int i = 0; i < 6; ++i) {
+        if ((slots[i] & group_bits) != group_bits || (slots[i] & 0xFFFF) != (slots[0] & 0xFFFF)) {
+            whole_group = false;
+            break;
+        }
+    }
 
-        for (int i = 0; i < data_len; ++i) {
-            uint8_t value = 0;
-            if (!read_byte(value, timeout_ms)) {
-                return false;
+    try {
+        if (whole_group) {
+            const auto pos = [&slots](int i) { return static_cast<uint16_t>(slots[i] >> 16); };
+            const auto cmd = arm_protocol::encode_servo_write6(pos(0), pos(1), pos(2), pos(3), pos(4), pos(5),
+                                                               static_cast<uint16_t>(slots[0] & 0xFFFF));
+            write_serial(cmd);
+            async->remember_motion(cmd.data());
+            return;
+        }
+        for (int i = 0; i < 6; ++i) {
+            if (!(slots[i] & AsyncState::MOTION_PENDING)) {
+                continue;
             }
-            if (i == data_len - 1) {
-                rx_check_num = value;
-            } else {
-                check_sum += value;
-                buffer.push_back(value);
+            const auto cmd = arm_protocol::encode_servo_write(static_cast<uint8_t>(i + 1),
+                                                              static_cast<uint16_t>(slots[i] >> 16),
+                                                              static_cast<uint16_t>(slots[i] & 0xFFFF));
+            write_serial(cmd);
+            async->remember_motion(cmd.data());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Coalesced motion serial error: " << e.what() << std::endl;
+    }
+}
+
+void Arm_Device::flush_joint_batch() {
+    const uint8_t mask = async->batch_mask;
+    if (mask == 0) {
+        return;
+    }
+    const uint64_t writes = async->batch_writes;
+    async->batch_mask = 0;
+    async->batch_writes = 0;
+
+    int joints = 0;
+    for (int i = 0; i < 6; ++i) {
+        joints += (mask >> i) & 1;
+    }
+
+    try {
+        if (joints > 1 && (async->commanded_mask | mask) == 0x3F) {
+            // Untouched joints are re-sent their last target, which leaves them where they were headed
+            std::array<uint16_t, 6> pos = async->commanded;
+            for (int i = 0; i < 6; ++i) {
+                if (mask & (1u << i)) {
+                    pos[i] = async->batch_pos[i];
+                }
             }
+            const auto cmd = arm_protocol::encode_servo_write6(pos[0], pos[1], pos[2], pos[3], pos[4], pos[5],
+                                                               async->batch_time);
+            write_serial(cmd);
+            async->remember_motion(cmd.data());
+            async->frames_saved.fetch_add(writes - 1, std::memory_order_relaxed);
+        } else {
+            std::array<uint8_t, 6 * arm_protocol::Frame<9>::size()> frames{};
+            size_t len = 0;
+            for (int i = 0; i < 6; ++i) {
+                if (!(mask & (1u << i))) {
+                    continue;
+                }
+                const auto cmd = arm_protocol::encode_servo_write(static_cast<uint8_t>(i + 1), async->batch_pos[i],
+                                                                  async->batch_time);
+                std::copy(cmd.bytes.begin(), cmd.bytes.end(), frames.begin() + len);
+                len += cmd.size();
+                async->remember_motion(cmd.data());
+            }
+            write_serial(frames.data(), len);
+            // A joint written twice inside the window is sent once
+            async->frames_saved.fetch_add(writes - static_cast<uint64_t>(joints), std::memory_order_relaxed);
+        }
+        if (writes > 1) {
+            async->batched.fetch_add(writes, std::memory_order_relaxed);
         }
+        async->syscalls_saved.fetch_add(writes - 1, std::memory_order_relaxed);
+    } catch (const std::exception& e) {
+        std::cerr << "Arm_serial_servo_write serial error: " << e.what() << std::endl;
+    }
+}
 
-        if ((check_sum % 256) != rx_check_num) {
-            std::cerr << "Checksum mismatch while reading response." << std::endl;
-            continue;
+size_t Arm_Device::tx_backlog() const {
+    return transport->tx_backlog();
+}
+
+bool Arm_Device::read_response(uint8_t& ext_type, arm_protocol::PayloadView& payload, unsigned int timeout_ms) {
+    // Measured on the transport's clock, which is virtual for a loopback
+    const auto deadline = transport->now() + std::chrono::milliseconds(timeout_ms);
+    for (;;) {
+        const uint64_t bad_before = decoder.checksum_errors();
+        const bool found = decoder.next(ext_type, payload);
+        metrics.add_checksum_errors(decoder.checksum_errors() - bad_before);
+        if (found) {
+            metrics.add_frame_rx();
+            return true;
         }
 
-        payload = std::move(buffer);
-        return true;
+        const auto remaining = deadline - transport->now();
+        if (remaining.count() <= 0) {
+            metrics.add_timeout();
+            return false;
+        }
+
+        // Take everything that has arrived in one read; next() parses it all
+        const long n = transport->read(decoder.write_ptr(), decoder.write_space(), remaining);
+        if (n < 0) {
+            return false;
+        }
+        if (n > 0) {
+            metrics.add_rx(static_cast<size_t>(n));
+            decoder.commit(static_cast<size_t>(n));
+        }
     }
-    return false;
 }
 
 // The main function to control all 6 servos
 void Arm_Device::Arm_serial_servo_write6(int s1, int s2, int s3, int s4, int s5, int s6, int time) {
     // Check angle ranges
-    if (s1 > 180 || s2 > 180 || s3 > 180 || s4 > 180 || s5 > 270 || s6 > 180 ||
-        s1 < 0 || s2 < 0 || s3 < 0 || s4 < 0 || s5 < 0 || s6 < 0) {
-        throw std::out_of_range("Angle parameter is out of range.");
-    }
-
-    // Invert angles for servos 2, 3, 4 as in the Python code
-    s2 = 180 - s2;
-    s3 = 180 - s3;
-    s4 = 180 - s4;
-
-    // Map angles to position values
-    uint16_t pos1 = map_angle_to_pos(s1, 0, 180, 900, 3100);
-    uint16_t pos2 = map_angle_to_pos(s2, 0, 180, 900, 3100);
-    uint16_t pos3 = map_angle_to_pos(s3, 0, 180, 900, 3100);
-    uint16_t pos4 = map_angle_to_pos(s4, 0, 180, 900, 3100);
-    uint16_t pos5 = map_angle_to_pos(s5, 0, 270, 380, 3700);
-    uint16_t pos6 = map_angle_to_pos(s6, 0, 180, 900, 3100);
-
-    // Split time into high and low bytes
-    uint8_t time_H = (time >> 8) & 0xFF;
-    uint8_t time_L = time & 0xFF;
-
-    // Build the command packet
-    std::vector<uint8_t> cmd = {
-        __HEAD,
-        __DEVICE_ID,
-        0x11, // Length (17 bytes)
-        0x1d, // Command ID
-        static_cast<uint8_t>((pos1 >> 8) & 0xFF), // s1 High Byte
-        static_cast<uint8_t>(pos1 & 0xFF),       // s1 Low Byte
-        static_cast<uint8_t>((pos2 >> 8) & 0xFF), // s2 High Byte
-        static_cast<uint8_t>(pos2 & 0xFF),       // s2 Low Byte
-        static_cast<uint8_t>((pos3 >> 8) & 0xFF), // s3 High Byte
-        static_cast<uint8_t>(pos3 & 0xFF),       // s3 Low Byte
-        static_cast<uint8_t>((pos4 >> 8) & 0xFF), // s4 High Byte
-        static_cast<uint8_t>(pos4 & 0xFF),       // s4 Low Byte
-        static_cast<uint8_t>((pos5 >> 8) & 0xFF), // s5 High Byte
-        static_cast<uint8_t>(pos5 & 0xFF),       // s5 Low Byte
-        static_cast<uint8_t>((pos6 >> 8) & 0xFF), // s6 High Byte
-        static_cast<uint8_t>(pos6 & 0xFF),       // s6 Low Byte
-        time_H,
-        time_L
-    };
+    const std::array<int, 6> angles = {s1, s2, s3, s4, s5, s6};
+    std::array<uint16_t, 6> pos{};
+    for (int id = 1; id <= 6; ++id) {
+        if (!calibration.contains(id, angles[id - 1])) {
+            throw std::out_of_range("Angle parameter is out of range.");
+        }
+        // Whole degrees are a lookup in the profile's table (servos 2-4 inverted)
+        pos[id - 1] = calibration.angle_to_position(id, angles[id - 1]);
+    }
+    send_positions6(pos, time);
+}
 
-    // Calculate and append the checksum
-    uint8_t checksum = calculate_checksum(cmd);
-    cmd.push_back(checksum);
+void Arm_Device::Arm_serial_servo_write6(const std::array<double, 6>& angles, int time) {
+    std::array<uint16_t, 6> pos{};
+    for (int id = 1; id <= 6; ++id) {
+        if (!calibration.contains(id, angles[id - 1])) {
+            throw std::out_of_range("Angle parameter is out of range.");
+        }
+        pos[id - 1] = calibration.angle_to_position(id, angles[id - 1]);
+    }
+    send_positions6(pos, time);
+}
 
-    // Send the command
-    try {
-        write_serial(cmd);
-    } catch (const std::exception& e) {
-        std::cerr << "Arm_serial_servo_write6 serial error: " << e.what() << std::endl;
+void Arm_Device::Arm_serial_servo_write6_raw(const std::array<uint16_t, 6>& positions, int time) {
+    for (int id = 1; id <= 6; ++id) {
+        validate_position(calibration, id, positions[id - 1]);
+    }
+    send_positions6(positions, time);
+}
+
+void Arm_Device::send_positions6(const std::array<uint16_t, 6>& pos, int time) {
+    bool unchanged = true;
+    for (int id = 1; id <= 6; ++id) {
+        unchanged &= shadow_write(id, pos[id - 1], time);
     }
+    if (unchanged && suppress_redundant) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    publish_commanded(0x3F, &pos);
+
+    if (async && async->coalesce) {
+        const uint16_t move_time = static_cast<uint16_t>(time);
+        bool replaced = false;
+        for (int id = 1; id <= 6; ++id) {
+            replaced |= async->post_motion(id, pos[id - 1], move_time, true);
+        }
+        async->commit_motion(0x3F, replaced);
+        return;
+    }
+
+    const auto cmd = arm_protocol::encode_servo_write6(pos[0], pos[1], pos[2], pos[3], pos[4], pos[5],
+                                                       static_cast<uint16_t>(time));
+
+    send_frame(cmd, "Arm_serial_servo_write6");
 }
 
 void Arm_Device::Arm_serial_servo_write(int id, int angle, int time) {
@@ -262,67 +660,81 @@ void Arm_Device::Arm_serial_servo_write(int id, int angle, int time) {
     if (id < 1 || id > 6) {
         throw std::out_of_range("Servo ID must be between 1 and 6.");
     }
+    if (!calibration.contains(id, angle)) {
+        throw std::out_of_range(angle_range_message(calibration, id));
+    }
 
-    if ((id == 2 || id == 3 || id == 4) && (angle >= 0 && angle <= 180)) {
-        angle = 180 - angle;
+    send_position(id, calibration.angle_to_position(id, angle), time);
+}
+
+void Arm_Device::Arm_serial_servo_write(int id, double angle, int time) {
+    if (id == 0) {
+        Arm_serial_servo_write6({angle, angle, angle, angle, angle, angle}, time);
+        return;
     }
 
-    uint16_t pos = 0;
-    if (id == 5) {
-        if (angle < 0 || angle > 270) {
-            throw std::out_of_range("Servo 5 angle must be between 0 and 270.");
-        }
-        pos = map_angle_to_pos(angle, 0, 270, 380, 3700);
-    } else {
-        if (angle < 0 || angle > 180) {
-            throw std::out_of_range("Servo angle must be between 0 and 180.");
-        }
-        pos = map_angle_to_pos(angle, 0, 180, 900, 3100);
-    }
-
-    uint8_t value_H = static_cast<uint8_t>((pos >> 8) & 0xFF);
-    uint8_t value_L = static_cast<uint8_t>(pos & 0xFF);
-    uint8_t time_H = static_cast<uint8_t>((time >> 8) & 0xFF);
-    uint8_t time_L = static_cast<uint8_t>(time & 0xFF);
-
-    std::vector<uint8_t> cmd = {
-        __HEAD,
-        __DEVICE_ID,
-        0x07,
-        static_cast<uint8_t>(0x10 + id),
-        value_H,
-        value_L,
-        time_H,
-        time_L
-    };
+    if (id < 1 || id > 6) {
+        throw std::out_of_range("Servo ID must be between 1 and 6.");
+    }
+    if (!calibration.contains(id, angle)) {
+        throw std::out_of_range(angle_range_message(calibration, id));
+    }
 
-    uint8_t checksum = calculate_checksum(cmd);
-    cmd.push_back(checksum);
+    send_position(id, calibration.angle_to_position(id, angle), time);
+}
 
-    try {
-        write_serial(cmd);
-    } catch (const std::exception& e) {
-        std::cerr << "Arm_serial_servo_write serial error: " << e.what() << std::endl;
+void Arm_Device::Arm_serial_servo_write_raw(int id, uint16_t position, int time) {
+    if (id < 1 || id > 6) {
+        throw std::out_of_range("Servo ID must be between 1 and 6.");
     }
+    validate_position(calibration, id, position);
+
+    send_position(id, position, time);
 }
 
-void Arm_Device::Arm_serial_set_torque(int onoff) {
-    std::vector<uint8_t> cmd = {
-        __HEAD,
-        __DEVICE_ID,
-        0x04,
-        0x1A,
-        static_cast<uint8_t>(onoff ? 0x01 : 0x00)
-    };
+void Arm_Device::send_position(int id, uint16_t pos, int time) {
+    if (shadow_write(id, pos, time) && suppress_redundant) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    std::array<uint16_t, 6> joint_pos{};
+    joint_pos[id - 1] = pos;
+    publish_commanded(1u << (id - 1), &joint_pos);
+
+    if (async && async->coalesce) {
+        const bool replaced = async->post_motion(id, pos, static_cast<uint16_t>(time), false);
+        async->commit_motion(1u << (id - 1), replaced);
+        return;
+    }
 
-    uint8_t checksum = calculate_checksum(cmd);
-    cmd.push_back(checksum);
+    const auto cmd = arm_protocol::encode_servo_write(static_cast<uint8_t>(id), pos,
+                                                      static_cast<uint16_t>(time));
 
-    try {
-        write_serial(cmd);
-    } catch (const std::exception& e) {
-        std::cerr << "Arm_serial_set_torque serial error: " << e.what() << std::endl;
+    send_frame(cmd, "Arm_serial_servo_write");
+}
+
+void Arm_Device::Arm_serial_set_torque(int onoff) {
+    const int state = (onoff != 0) ? 1 : 0;
+    if (state == 0) {
+        // A limp arm can be pushed anywhere; stop trusting the commanded angles
+        for (auto& joint : shadow_joints) {
+            joint.store(0, std::memory_order_relaxed);
+        }
+        publish_commanded(0x3F, nullptr);
+        if (async) {
+            // Sent after torque off, a pending target would re-energise the joint
+            async->discard_motion();
+        }
+        forget_batch_targets();
+    }
+    if (shadow_torque.exchange(state) == state && suppress_redundant) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
+
+    const auto cmd = arm_protocol::encode_torque(onoff != 0);
+
+    send_frame(cmd, "Arm_serial_set_torque");
 }
 
 int Arm_Device::Arm_ping_servo(int id) {
@@ -330,16 +742,33 @@ int Arm_Device::Arm_ping_servo(int id) {
         throw std::out_of_range("Servo ID must be between 1 and 250.");
     }
 
-    std::vector<uint8_t> cmd = {
-        __HEAD,
-        __DEVICE_ID,
-        0x04,
-        0x38,
-        static_cast<uint8_t>(id)
-    };
+    if (async) {
+        return Arm_ping_servo_async(id).get();
+    }
+    return ping_servo_blocking(id);
+}
+
+std::future<int> Arm_Device::Arm_ping_servo_async(int id) {
+    if (id <= 0 || id > 250) {
+        throw std::out_of_range("Servo ID must be between 1 and 250.");
+    }
 
-    uint8_t checksum = calculate_checksum(cmd);
-    cmd.push_back(checksum);
+    if (!async) {
+        return ready_future(ping_servo_blocking(id));
+    }
+
+    IoJob job;
+    job.kind = IoJob::Kind::Ping;
+    job.id = id;
+    job.reply.reset(new std::promise<int>());
+    std::future<int> result = job.reply->get_future();
+    async->push(job);
+    return result;
+}
+
+int Arm_Device::ping_servo_blocking(int id) {
+    const auto cmd = arm_protocol::encode_ping(static_cast<uint8_t>(id));
+    const auto started = metrics.start();
 
     try {
         write_serial(cmd);
@@ -349,11 +778,11 @@ int Arm_Device::Arm_ping_servo(int id) {
     }
 
     uint8_t ext_type = 0;
-    std::vector<uint8_t> payload;
-    if (read_response(ext_type, payload)) {
-        if (!payload.empty()) {
-            return payload[0];
-        }
+    arm_protocol::PayloadView payload;
+    const bool received = read_response(ext_type, payload);
+    metrics.record_latency(MetricCommand::Ping, started);
+    if (received && !payload.empty()) {
+        return payload[0];
     }
     return 0;
 }
@@ -363,22 +792,79 @@ int Arm_Device::Arm_serial_servo_read(int id) {
         throw std::out_of_range("Servo ID must be between 1 and 6.");
     }
 
-    uint8_t command_id = static_cast<uint8_t>(id + 0x30);
-    std::vector<uint8_t> cmd = {
-        __HEAD,
-        __DEVICE_ID,
-        0x03,
-        command_id
-    };
+    if (async) {
+        return Arm_serial_servo_read_async(id).get();
+    }
+    return decode_servo_angle(id, servo_read_raw_blocking(id));
+}
+
+std::future<int> Arm_Device::Arm_serial_servo_read_async(int id) {
+    if (id < 1 || id > 6) {
+        throw std::out_of_range("Servo ID must be between 1 and 6.");
+    }
 
-    uint8_t checksum = calculate_checksum(cmd);
-    cmd.push_back(checksum);
+    if (!async) {
+        return ready_future(decode_servo_angle(id, servo_read_raw_blocking(id)));
+    }
+
+    IoJob job;
+    job.kind = IoJob::Kind::Read;
+    job.id = id;
+    job.reply.reset(new std::promise<int>());
+    std::future<int> result = job.reply->get_future();
+    async->push(job);
+    return result;
+}
+
+int Arm_Device::Arm_serial_servo_read_raw(int id) {
+    if (id < 1 || id > 6) {
+        throw std::out_of_range("Servo ID must be between 1 and 6.");
+    }
+
+    if (async) {
+        return Arm_serial_servo_read_raw_async(id).get();
+    }
+    return servo_read_raw_blocking(id);
+}
+
+std::future<int> Arm_Device::Arm_serial_servo_read_raw_async(int id) {
+    if (id < 1 || id > 6) {
+        throw std::out_of_range("Servo ID must be between 1 and 6.");
+    }
+
+    if (!async) {
+        return ready_future(servo_read_raw_blocking(id));
+    }
+
+    IoJob job;
+    job.kind = IoJob::Kind::ReadRaw;
+    job.id = id;
+    job.reply.reset(new std::promise<int>());
+    std::future<int> result = job.reply->get_future();
+    async->push(job);
+    return result;
+}
+
+double Arm_Device::Arm_serial_servo_read_precise(int id) {
+    const int pos = Arm_serial_servo_read_raw(id);
+    if (pos < 0) {
+        return -1.0;
+    }
+    return calibration.position_to_angle_precise(id, static_cast<uint16_t>(pos));
+}
+
+int Arm_Device::servo_read_raw_blocking(int id) {
+    const auto cmd = arm_protocol::encode_servo_read(static_cast<uint8_t>(id));
 
     uint8_t ext_type = 0;
-    std::vector<uint8_t> payload;
+    arm_protocol::PayloadView payload;
 
+    const auto started = metrics.start();
     bool received = false;
     for (int attempt = 0; attempt < 2 && !received; ++attempt) {
+        if (attempt > 0) {
+            metrics.add_retry();
+        }
         try {
             write_serial(cmd);
         } catch (const std::exception& e) {
@@ -390,55 +876,319 @@ int Arm_Device::Arm_serial_servo_read(int id) {
             received = true;
         }
     }
+    metrics.record_latency(MetricCommand::Read, started);
 
     if (!received) {
         return -1;
     }
 
-    if (ext_type != 0x0A || payload.size() < 3) {
+    if (ext_type != arm_protocol::REPLY_SERVO || payload.size < 3) {
         return -1;
     }
 
-    uint16_t pos = (static_cast<uint16_t>(payload[0]) << 8) | payload[1];
+    const uint16_t pos = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+    std::array<double, 6> angles{};
+    angles[id - 1] = calibration.position_to_angle_precise(id, pos);
+    if (angles[id - 1] >= 0.0) {
+        publish_measured(1u << (id - 1), angles);
+    }
+    return pos;
+}
 
-    int angle = -1;
-    if (id == 5) {
-        angle = static_cast<int>(std::round((270.0 * (pos - 380)) / (3700 - 380)));
-        if (angle < 0 || angle > 270) {
-            return -1;
+Arm_ServoReadings Arm_Device::Arm_serial_servo_read6() {
+    if (async) {
+        return Arm_serial_servo_read6_async().get();
+    }
+    return servo_read6_blocking();
+}
+
+std::future<Arm_ServoReadings> Arm_Device::Arm_serial_servo_read6_async() {
+    if (!async) {
+        return ready_future(servo_read6_blocking());
+    }
+
+    IoJob job;
+    job.kind = IoJob::Kind::Read6;
+    job.readings.reset(new std::promise<Arm_ServoReadings>());
+    std::future<Arm_ServoReadings> result = job.readings->get_future();
+    async->push(job);
+    return result;
+}
+
+Arm_ServoReadings Arm_Device::servo_read6_blocking() {
+    Arm_ServoReadings readings;
+
+    // Bit (id - 1) is set while joint id is still waiting for its reply
+    uint8_t pending = 0x3F;
+    const auto started = metrics.start();
+    for (int attempt = 0; attempt < 2 && pending != 0; ++attempt) {
+        if (attempt > 0) {
+            metrics.add_retry();
         }
-    } else {
-        angle = static_cast<int>(std::round((180.0 * (pos - 900)) / (3100 - 900)));
-        if (angle < 0 || angle > 180) {
-            return -1;
+        // Queue every outstanding query back-to-back so the board can answer
+        // them while we are still parsing the first reply.
+        std::array<uint8_t, 6 * arm_protocol::Frame<5>::size()> batch{};
+        size_t batch_len = 0;
+        for (int id = 1; id <= 6; ++id) {
+            if (!(pending & (1u << (id - 1)))) {
+                continue;
+            }
+            const auto cmd = arm_protocol::encode_servo_read(static_cast<uint8_t>(id));
+            std::copy(cmd.bytes.begin(), cmd.bytes.end(), batch.begin() + batch_len);
+            batch_len += cmd.size();
         }
-        if (id == 2 || id == 3 || id == 4) {
-            angle = 180 - angle;
+
+        try {
+            write_serial(batch.data(), batch_len);
+        } catch (const std::exception& e) {
+            std::cerr << "Arm_serial_servo_read6 serial error: " << e.what() << std::endl;
+            return readings;
         }
+
+        uint8_t ext_type = 0;
+        arm_protocol::PayloadView payload;
+        while (pending != 0 && read_response(ext_type, payload)) {
+            // Replies echo the query id (0x31-0x36) in their third data byte
+            if (ext_type != arm_protocol::REPLY_SERVO || payload.size < 3) {
+                continue;
+            }
+            const int id = static_cast<int>(payload[2]) - 0x30;
+            if (id < 1 || id > 6 || !(pending & (1u << (id - 1)))) {
+                continue;
+            }
+            pending &= static_cast<uint8_t>(~(1u << (id - 1)));
+
+            const uint16_t pos = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+            const int angle = decode_servo_angle(id, pos);
+            readings.positions[id - 1] = pos;
+            readings.angles[id - 1] = angle;
+            if (angle >= 0) {
+                readings.precise[id - 1] = calibration.position_to_angle_precise(id, pos);
+            }
+            readings.status[id - 1] = (angle < 0) ? Arm_ReadStatus::OutOfRange : Arm_ReadStatus::Ok;
+        }
+    }
+    metrics.record_latency(MetricCommand::Read6, started);
+
+    unsigned ok = 0;
+    for (int id = 1; id <= 6; ++id) {
+        if (readings.status[id - 1] == Arm_ReadStatus::Ok) {
+            ok |= 1u << (id - 1);
+        }
+    }
+    if (ok != 0) {
+        publish_measured(ok, readings.precise);
     }
+    return readings;
+}
 
-    return angle;
+int Arm_Device::decode_servo_angle(int id, int pos) const {
+    if (pos < 0) {
+        return -1;
+    }
+    return calibration.position_to_angle(id, static_cast<uint16_t>(pos));
 }
 
 void Arm_Device::Arm_Buzzer_On(int delay) {
-    std::vector<uint8_t> cmd = {
-        __HEAD,
-        __DEVICE_ID,
-        0x04,
-        0x06,
-        static_cast<uint8_t>(delay & 0xFF)
-    };
+    // Off and held-on are states; a timed beep is an action and always goes out
+    const int state = delay & 0xFF;
+    const bool steady = (state == 0x00 || state == 0xFF);
+    if (shadow_buzzer.exchange(steady ? state : -1) == state && steady && suppress_redundant) {
+        suppressed.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
 
-    uint8_t checksum = calculate_checksum(cmd);
-    cmd.push_back(checksum);
+    const auto cmd = arm_protocol::encode_buzzer(static_cast<uint8_t>(delay & 0xFF));
 
-    try {
-        write_serial(cmd);
-    } catch (const std::exception& e) {
-        std::cerr << "Arm_Buzzer_On serial error: " << e.what() << std::endl;
-    }
+    send_frame(cmd, "Arm_Buzzer_On");
 }
 
 void Arm_Device::Arm_Buzzer_Off() {
     Arm_Buzzer_On(0x00);
 }
+
+void Arm_Device::Arm_flush() {
+    if (!async) {
+        return;
+    }
+
+    IoJob job;
+    job.kind = IoJob::Kind::Barrier;
+    job.reply.reset(new std::promise<int>());
+    std::future<int> done = job.reply->get_future();
+    async->push(job);
+    done.wait();
+}
+
+bool Arm_Device::shadow_write(int id, uint16_t pos, int time) {
+    const uint64_t packed = SHADOW_KNOWN | (static_cast<uint64_t>(pos) << 16) |
+                            static_cast<uint16_t>(time);
+    return shadow_joints[id - 1].exchange(packed, std::memory_order_relaxed) == packed;
+}
+
+Arm_ShadowState Arm_Device::Arm_shadow_state() const {
+    Arm_ShadowState state;
+    for (int i = 0; i < 6; ++i) {
+        const uint64_t joint = shadow_joints[i].load(std::memory_order_relaxed);
+        if (joint & SHADOW_KNOWN) {
+            const uint16_t pos = static_cast<uint16_t>(joint >> 16);
+            state.positions[i] = pos;
+            state.angles[i] = calibration.position_to_angle(i + 1, pos);
+            state.move_times[i] = static_cast<int>(joint & 0xFFFF);
+        }
+    }
+    state.torque = shadow_torque.load(std::memory_order_relaxed);
+    state.buzzer = shadow_buzzer.load(std::memory_order_relaxed);
+    state.suppressed = suppressed.load(std::memory_order_relaxed);
+    return state;
+}
+
+void Arm_Device::Arm_invalidate_shadow() {
+    for (auto& joint : shadow_joints) {
+        joint.store(0, std::memory_order_relaxed);
+    }
+    publish_commanded(0x3F, nullptr);
+    forget_batch_targets();
+    shadow_torque.store(-1);
+    shadow_buzzer.store(-1);
+}
+
+void Arm_Device::forget_batch_targets() {
+    if (!async || async->batch_window.count() == 0) {
+        return;
+    }
+    IoJob job;
+    job.kind = IoJob::Kind::Forget;
+    async->push(job);
+}
+
+bool Arm_Device::wait_until_ready(unsigned int timeout_ms) {
+    // Bytes left over from before the port was opened are not replies to us
+    transport->discard_input();
+    const auto opened = transport->now();
+    const auto deadline = opened + std::chrono::milliseconds(timeout_ms);
+    const auto ping = arm_protocol::encode_ping(1);
+
+    unsigned int wait_ms = 5;
+    int unanswered = 0;   // Pings sent before the one that got through
+    for (;;) {
+        const auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - transport->now());
+        if (left.count() <= 0) {
+            return false;
+        }
+        write_serial(ping);
+        uint8_t ext_type = 0;
+        arm_protocol::PayloadView payload;
+        if (read_response(ext_type, payload, std::min<unsigned int>(wait_ms, static_cast<unsigned int>(left.count())))) {
+            break;
+        }
+        ++unanswered;
+        wait_ms = std::min(wait_ms * 2, 100u);
+    }
+
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(transport->now() - opened);
+    time_to_ready_ms = elapsed.count() / 1e6;
+    metrics.set_time_to_ready(static_cast<uint64_t>(elapsed.count()));
+    // The earlier pings may still be answered; their replies must not be
+    // taken for the reply to the next query
+    uint8_t ext_type = 0;
+    arm_protocol::PayloadView payload;
+    while (unanswered > 0 && read_response(ext_type, payload, wait_ms)) {
+        --unanswered;
+    }
+    return true;
+}
+
+double Arm_Device::Arm_time_to_ready_ms() const {
+    return time_to_ready_ms;
+}
+
+void Arm_Device::measure_link_rtt() {
+    const auto ping = arm_protocol::encode_ping(1);
+    std::vector<std::chrono::nanoseconds> samples;
+    samples.reserve(LINK_RTT_PROBES);
+    for (int i = 0; i < LINK_RTT_PROBES; ++i) {
+        const auto started = metrics.start();
+        const auto sent = transport->now();
+        try {
+            write_serial(ping);
+        } catch (const std::exception&) {
+            break;
+        }
+        uint8_t ext_type = 0;
+        arm_protocol::PayloadView payload;
+        if (!read_response(ext_type, payload, 100)) {
+            // A late reply would be read as the next probe's; stop here
+            break;
+        }
+        samples.push_back(transport->now() - sent);
+        metrics.record_latency(MetricCommand::Ping, started);
+    }
+    if (samples.empty()) {
+        return;
+    }
+    auto middle = samples.begin() + static_cast<std::ptrdiff_t>(samples.size() / 2);
+    std::nth_element(samples.begin(), middle, samples.end());
+    link_rtt_ms = std::chrono::duration<double, std::milli>(*middle).count();
+}
+
+double Arm_Device::Arm_link_rtt_ms() const {
+    return link_rtt_ms;
+}
+
+void Arm_Device::publish_commanded(unsigned mask, const std::array<uint16_t, 6>* pos) {
+    const int64_t now = steady_now_ns();
+    pose->update([&](ArmPose& state) {
+        for (int id = 1; id <= 6; ++id) {
+            if (mask & (1u << (id - 1))) {
+                state.commanded[id - 1] = pos ? calibration.position_to_angle_precise(id, (*pos)[id - 1]) : -1.0;
+            }
+        }
+        state.commanded_ns = now;
+    });
+}
+
+void Arm_Device::publish_measured(unsigned mask, const std::array<double, 6>& angles) {
+    const int64_t now = steady_now_ns();
+    pose->update([&](ArmPose& state) {
+        for (int i = 0; i < 6; ++i) {
+            if (mask & (1u << i)) {
+                state.measured[i] = angles[i];
+            }
+        }
+        state.measured_ns = now;
+    });
+}
+
+ArmPose Arm_Device::Arm_pose() const {
+    return pose->load();
+}
+
+const PoseSnapshot& Arm_Device::Arm_pose_snapshot() const {
+    return *pose;
+}
+
+MetricsSnapshot Arm_Device::Arm_metrics() const {
+    return metrics.snapshot();
+}
+
+const CalibrationProfile& Arm_Device::Arm_calibration() const {
+    return calibration;
+}
+
+bool Arm_Device::Arm_is_async() const {
+    return static_cast<bool>(async);
+}
+
+Arm_AsyncStats Arm_Device::Arm_async_stats() const {
+    Arm_AsyncStats stats;
+    if (async) {
+        stats.submitted = async->submitted.load(std::memory_order_relaxed);
+        stats.dropped = async->dropped.load(std::memory_order_relaxed);
+        stats.coalesced = async->coalesced.load(std::memory_order_relaxed);
+        stats.batched = async->batched.load(std::memory_order_relaxed);
+        stats.frames_saved = async->frames_saved.load(std::memory_order_relaxed);
+        stats.syscalls_saved = async->syscalls_saved.load(std::memory_order_relaxed);
+    }
+    return stats;
+}
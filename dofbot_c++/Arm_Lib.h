@@ -1,24 +1,161 @@
 #ifndef ARM_LIB_H
 #define ARM_LIB_H
 
+#include <array>
+#include <atomic>
+#include <future>
+#include <memory>
 #include <string>
-#include <vector>
 #include <cstdint> // For uint8_t, uint16_t
 
+#include "Arm_Protocol.h"
+#include "calibration.h"
+#include "frame_decoder.h"
+#include "metrics.h"
+#include "motion_capture.h"
+#include "pose_snapshot.h"
+#include "transport.h"
+
+/**
+ * @brief Outcome of one joint query inside Arm_Device::Arm_serial_servo_read6().
+ */
+enum class Arm_ReadStatus : uint8_t {
+    Ok,         // Reply received and decoded
+    Timeout,    // No reply for this joint before the deadline
+    OutOfRange  // Reply received but the position maps outside the joint range
+};
+
+/**
+ * @brief Snapshot of all six joints returned by Arm_serial_servo_read6().
+ *        Angles of joints whose status is not Ok are reported as -1.
+ */
+struct Arm_ServoReadings {
+    std::array<int, 6> angles = {-1, -1, -1, -1, -1, -1};
+    std::array<int, 6> positions = {-1, -1, -1, -1, -1, -1};   // Raw servo positions; -1 on Timeout
+    std::array<double, 6> precise = {-1.0, -1.0, -1.0, -1.0, -1.0, -1.0}; // Angles before rounding
+    std::array<Arm_ReadStatus, 6> status = {
+        Arm_ReadStatus::Timeout, Arm_ReadStatus::Timeout, Arm_ReadStatus::Timeout,
+        Arm_ReadStatus::Timeout, Arm_ReadStatus::Timeout, Arm_ReadStatus::Timeout
+    };
+
+    /**
+     * @brief True when every joint reported a valid angle.
+     */
+    bool all_ok() const;
+};
+
+/**
+ * @brief Optional behaviour switches for Arm_Device.
+ */
+struct Arm_Options {
+    // Hand the serial port to a dedicated I/O thread. Write commands are then
+    // queued and return immediately; reads wait for their reply. When the
+    // queue is full, motion keeps only the newest target per joint and other
+    // commands wait for room, so nothing but superseded targets is lost.
+    bool async_io = false;
+    // Slots in the async command ring (rounded up to a power of two)
+    size_t queue_capacity = 64;
+    // Keep only the newest unsent target per joint: a write6 or per-joint write
+    // replaces any older target for the same joint that has not reached the
+    // port yet. Other commands (torque, buzzer, reads) wait until the motion
+    // queued before them has been sent, and torque off discards it instead.
+    // Implies async_io.
+    bool coalesce_motion = false;
+    // Bytes allowed in the kernel's tty output queue before coalesced motion is
+    // held back, so stale targets never pile up behind the UART.
+    size_t max_tx_backlog = arm_protocol::MAX_FRAME_SIZE;
+    // Per-joint writes queued within this many microseconds of the first one
+    // (with the same move time) are sent together: as one write6 frame, with
+    // untouched joints held at their last commanded position, once every joint
+    // has been commanded at least once; otherwise as back-to-back frames in a
+    // single write(). 0 disables batching. Implies async_io; ignored when
+    // coalesce_motion is set.
+    unsigned int batch_window_us = 0;
+    // Skip commands that would not change the commanded state: a write whose
+    // position and move time match the last one sent to that joint, torque
+    // already in the requested state, buzzer already off or held on. The
+    // shadow state is tracked either way (see Arm_shadow_state()).
+    bool suppress_redundant = false;
+    // Angle/position mapping of this arm (see calibration.h)
+    CalibrationProfile calibration = DEFAULT_CALIBRATION;
+    // Record every frame written to the port, with its time, to this file
+    // (see motion_capture.h). Empty disables capture.
+    std::string capture_path;
+    // Export Arm_metrics() every metrics_interval_ms to this file and/or serve
+    // it on this Unix socket (see metrics.h). Both empty disables the exporter.
+    std::string metrics_path;
+    std::string metrics_socket;
+    MetricsFormat metrics_format = MetricsFormat::Prometheus;
+    unsigned int metrics_interval_ms = 1000;
+    // At open, discard stale input and ping servo 1 with a growing reply
+    // timeout (5 ms doubling to 100 ms) until the board answers or this
+    // much time has passed. 0 skips the handshake.
+    unsigned int ready_timeout_ms = 500;
+    // Throw from the constructor if the handshake times out, instead of
+    // warning on stderr and carrying on.
+    bool require_ready = false;
+    // Tune the tty for the shortest reply latency (set_serial_low_latency():
+    // poll-driven reads with VMIN = VTIME = 0, ASYNC_LOW_LATENCY where the
+    // driver supports it) and measure the link round trip at open (see
+    // Arm_link_rtt_ms()). Transports passed in ready-made are only measured.
+    bool low_latency = false;
+    // Place the commanded/measured PoseSnapshot in POSIX shared memory under
+    // this name (e.g. "/dofbot.pose") for SharedPoseReader. Empty keeps it in-process.
+    std::string pose_shm_name;
+};
+
+/**
+ * @brief Counters describing the async command queue.
+ */
+struct Arm_AsyncStats {
+    uint64_t submitted = 0;      // Frames accepted into the queue
+    uint64_t dropped = 0;        // Motion frames replaced by a newer target while the queue was full
+    uint64_t coalesced = 0;      // Motion frames superseded before they were sent
+    uint64_t batched = 0;        // Per-joint writes sent as part of a batch
+    uint64_t frames_saved = 0;   // Frames batching did not have to send
+    uint64_t syscalls_saved = 0; // write() calls batching did not have to make
+};
+
+/**
+ * @brief Last commanded state as tracked by Arm_Device, without touching the wire.
+ *        -1 marks anything not commanded yet (or forgotten after torque off).
+ */
+struct Arm_ShadowState {
+    std::array<int, 6> angles = {-1, -1, -1, -1, -1, -1};
+    std::array<int, 6> positions = {-1, -1, -1, -1, -1, -1}; // Raw positions actually sent
+    std::array<int, 6> move_times = {-1, -1, -1, -1, -1, -1};
+    int torque = -1;      // 1 on, 0 off
+    int buzzer = -1;      // 0 off, 0xFF held on; -1 after a timed beep
+    uint64_t suppressed = 0; // Commands skipped by Arm_Options::suppress_redundant
+};
+
 class Arm_Device {
 public:
     /**
      * @brief Constructs the Arm_Device and opens the serial port.
      * @param com The serial port path (e.g., "/dev/tty.usbserial-2130").
-     * @throws std::runtime_error if the port cannot be opened or configured.
+     * @param options Behaviour switches, see Arm_Options.
+     * @throws std::runtime_error if the port cannot be opened or configured,
+     *         or the board does not answer and Arm_Options::require_ready is set.
+     */
+    explicit Arm_Device(const std::string& com, const Arm_Options& options = Arm_Options());
+
+    /**
+     * @brief Constructs the Arm_Device on an already open transport, e.g. a
+     *        LoopbackTransport for hardware-free tests on a virtual clock.
+     * @param transport The byte transport to the board; must not be null.
+     * @param options Behaviour switches, see Arm_Options.
      */
-    explicit Arm_Device(const std::string& com);
+    explicit Arm_Device(std::unique_ptr<Transport> transport, const Arm_Options& options = Arm_Options());
 
     /**
-     * @brief Destructor. Closes the serial port.
+     * @brief Destructor. Sends any queued commands, then closes the serial port.
      */
     ~Arm_Device();
 
+    Arm_Device(const Arm_Device&) = delete;
+    Arm_Device& operator=(const Arm_Device&) = delete;
+
     /**
      * @brief Sets the angles of all 6 servos simultaneously.
      * @param s1 Angle for servo 1 (0-180)
@@ -33,11 +170,36 @@ public:
      */
     void Arm_serial_servo_write6(int s1, int s2, int s3, int s4, int s5, int s6, int time);
 
+    /**
+     * @brief Sets all 6 servos to fractional angles, resolved to the nearest
+     *        servo count (about 0.08 degrees) instead of whole degrees.
+     * @throws std::out_of_range if any angle is outside its valid range.
+     */
+    void Arm_serial_servo_write6(const std::array<double, 6>& angles, int time);
+
+    /**
+     * @brief Sets all 6 servos to raw positions, bypassing the angle mapping.
+     * @throws std::out_of_range if a position is outside its joint's calibrated
+     *         span (stock: 900-3100; servo 5: 380-3700).
+     */
+    void Arm_serial_servo_write6_raw(const std::array<uint16_t, 6>& positions, int time);
+
     /**
      * @brief Command a single servo to move to the desired angle.
      */
     void Arm_serial_servo_write(int id, int angle, int time);
 
+    /**
+     * @brief Command a single servo (0 = all) to a fractional angle.
+     */
+    void Arm_serial_servo_write(int id, double angle, int time);
+
+    /**
+     * @brief Command a single servo to a raw position.
+     * @throws std::out_of_range if the position is outside the joint's calibrated span.
+     */
+    void Arm_serial_servo_write_raw(int id, uint16_t position, int time);
+
     /**
      * @brief Enable or disable torque on all servos.
      */
@@ -56,7 +218,114 @@ public:
     int Arm_serial_servo_read(int id);
 
     /**
-     * @brief Turn the buzzer on for the requested duration (0 keeps it on).
+     * @brief Read the raw position reported by a servo.
+     * @return Position in servo counts, or -1 if the read failed.
+     */
+    int Arm_serial_servo_read_raw(int id);
+
+    /**
+     * @brief Read the current angle of a servo without rounding to whole degrees.
+     * @return Angle in degrees, or -1.0 if the read failed or fell outside the joint range.
+     */
+    double Arm_serial_servo_read_precise(int id);
+
+    /**
+     * @brief Read the current angle of all six servos in one pipelined exchange.
+     *
+     * The six 0x31-0x36 queries are sent back-to-back in a single write and the
+     * 0x0A replies are matched to their joint by the command id they echo, so a
+     * full snapshot costs roughly one round-trip instead of six. Joints that did
+     * not answer are queried once more, mirroring Arm_serial_servo_read().
+     * @return Per-joint angles and status.
+     */
+    Arm_ServoReadings Arm_serial_servo_read6();
+
+    /**
+     * @brief Ping a servo without blocking the caller when async I/O is enabled.
+     * @return Future resolving to the value Arm_ping_servo() would return.
+     */
+    std::future<int> Arm_ping_servo_async(int id);
+
+    /**
+     * @brief Read one servo angle without blocking the caller when async I/O is enabled.
+     * @return Future resolving to the value Arm_serial_servo_read() would return.
+     */
+    std::future<int> Arm_serial_servo_read_async(int id);
+
+    /**
+     * @brief Read one raw servo position without blocking the caller when async I/O is enabled.
+     * @return Future resolving to the value Arm_serial_servo_read_raw() would return.
+     */
+    std::future<int> Arm_serial_servo_read_raw_async(int id);
+
+    /**
+     * @brief Snapshot all six joints without blocking the caller when async I/O is enabled.
+     */
+    std::future<Arm_ServoReadings> Arm_serial_servo_read6_async();
+
+    /**
+     * @brief Block until every command queued so far, including coalesced motion,
+     *        has been written to the port. Returns immediately in synchronous mode.
+     */
+    void Arm_flush();
+
+    /**
+     * @brief I/O counters and per-command latency histograms (all zero when
+     *        built with DOFBOT_METRICS=0).
+     */
+    MetricsSnapshot Arm_metrics() const;
+
+    /**
+     * @brief Angle/position mapping this arm was opened with.
+     */
+    const CalibrationProfile& Arm_calibration() const;
+
+    /**
+     * @brief Milliseconds from opening the port until the board answered the
+     *        readiness handshake; -1 if it was skipped or never answered.
+     */
+    double Arm_time_to_ready_ms() const;
+
+    /**
+     * @brief Median ping round trip measured at open in low-latency mode, in
+     *        milliseconds; -1 if not measured or the board never answered.
+     */
+    double Arm_link_rtt_ms() const;
+
+    /**
+     * @brief Latest commanded and measured angles, without touching the wire.
+     *        Lock-free, and safe to call from any thread.
+     */
+    ArmPose Arm_pose() const;
+
+    /**
+     * @brief The seqlock behind Arm_pose(), for readers that poll version().
+     */
+    const PoseSnapshot& Arm_pose_snapshot() const;
+
+    /**
+     * @brief True when serial I/O runs on the background thread.
+     */
+    bool Arm_is_async() const;
+
+    /**
+     * @brief Counters of the async command queue (all zero in synchronous mode).
+     */
+    Arm_AsyncStats Arm_async_stats() const;
+
+    /**
+     * @brief Last commanded angles, move times, torque and buzzer state.
+     */
+    Arm_ShadowState Arm_shadow_state() const;
+
+    /**
+     * @brief Forgets the shadow state, e.g. after the arm was moved by hand,
+     *        so the next command of every kind is sent even when suppressing.
+     */
+    void Arm_invalidate_shadow();
+
+    /**
+     * @brief Turn the buzzer on for the requested duration (0xFF keeps it on).
      */
     void Arm_Buzzer_On(int delay = 0xFF);
 
@@ -66,39 +335,159 @@ public:
     void Arm_Buzzer_Off();
 
 private:
-    int ser_fd; // Serial port file descriptor
-    std::string port_name;
+    std::unique_ptr<Transport> transport; // Serial port, or any other byte transport
+    const CalibrationProfile calibration;
+
+    // Commanded state, updated by the calling threads before a command is
+    // queued or written. A joint slot packs SHADOW_KNOWN | position << 16 | time.
+    static constexpr uint64_t SHADOW_KNOWN = 1ull << 63;
+    const bool suppress_redundant;
+    std::array<std::atomic<uint64_t>, 6> shadow_joints{};
+    std::atomic<int> shadow_torque{-1};
+    std::atomic<int> shadow_buzzer{-1};
+    std::atomic<uint64_t> suppressed{0};
+
+    /**
+     * @brief Records a write of @p pos over @p time to joint @p id.
+     * @return true if the joint was already commanded exactly that.
+     */
+    bool shadow_write(int id, uint16_t pos, int time);
+
+    /**
+     * @brief Sends validated positions to all six joints, honouring the shadow
+     *        state and motion coalescing.
+     */
+    void send_positions6(const std::array<uint16_t, 6>& pos, int time);
+
+    /**
+     * @brief Sends a validated position to joint @p id (1-6), as above.
+     */
+    void send_position(int id, uint16_t pos, int time);
+
+    double time_to_ready_ms = -1.0;
+
+    /**
+     * @brief Pings the board until it answers or @p timeout_ms passes (see
+     *        Arm_Options::ready_timeout_ms). Runs before the I/O thread starts.
+     * @return true once a reply arrived.
+     */
+    bool wait_until_ready(unsigned int timeout_ms);
+
+    double link_rtt_ms = -1.0;
+
+    /**
+     * @brief Times a few pings to servo 1 and keeps the median in link_rtt_ms.
+     *        Runs before the I/O thread starts.
+     */
+    void measure_link_rtt();
+
+    // Latest commanded/measured pose; points into pose_memory or local_pose
+    std::unique_ptr<SharedMemory> pose_memory;
+    std::unique_ptr<PoseSnapshot> local_pose;
+    PoseSnapshot* pose = nullptr;
+
+    /**
+     * @brief Publishes the positions of the joints in @p mask (bit id - 1) as
+     *        commanded, or marks every joint unknown when @p pos is null.
+     */
+    void publish_commanded(unsigned mask, const std::array<uint16_t, 6>* pos);
+
+    /**
+     * @brief Publishes the angles of the joints in @p mask as measured.
+     */
+    void publish_measured(unsigned mask, const std::array<double, 6>& angles);
+
+    // Capture of outgoing frames; null unless Arm_Options::capture_path is set
+    std::unique_ptr<FrameRecorder> recorder;
+
+    MetricsRegistry metrics;
+    // Periodic export of metrics; null unless a metrics path or socket is set
+    std::unique_ptr<MetricsExporter> exporter;
+
+    // Background I/O thread and its command ring; null in synchronous mode
+    struct AsyncState;
+    std::unique_ptr<AsyncState> async;
 
     // Protocol constants
-    static const uint8_t __HEAD = 0xFF;
-    static const uint8_t __DEVICE_ID = 0xFC;
+    static const uint8_t __HEAD = arm_protocol::HEAD;
+    static const uint8_t __DEVICE_ID = arm_protocol::DEVICE_ID;
     // 257 - 252 = 5. Used as the starting value for the checksum.
-    static const uint8_t __COMPLEMENT = 5;
+    static const uint8_t __COMPLEMENT = arm_protocol::COMPLEMENT;
+
+    // Receive buffer and parser for replies; parsing a frame never allocates
+    arm_protocol::FrameDecoder decoder;
+
+    /**
+     * @brief Converts a raw servo position from a 0x0A reply into degrees.
+     * @return Angle in degrees, or -1 if the position is outside the joint range
+     *         or @p pos is -1 (no reply).
+     */
+    int decode_servo_angle(int id, int pos) const;
+
+    /**
+     * @brief Writes a byte buffer to the serial port.
+     */
+    void write_serial(const uint8_t* data, size_t len);
+
+    /**
+     * @brief Writes an encoded command frame to the serial port.
+     */
+    template <std::size_t N>
+    void write_serial(const arm_protocol::Frame<N>& frame) {
+        write_serial(frame.data(), frame.size());
+    }
+
+    /**
+     * @brief Sends a command frame: queued for the I/O thread in async mode,
+     *        written directly otherwise. Serial errors are reported on stderr
+     *        prefixed with @p context, as every command did before.
+     */
+    void send_frame(const uint8_t* data, size_t len, const char* context);
+
+    template <std::size_t N>
+    void send_frame(const arm_protocol::Frame<N>& frame, const char* context) {
+        send_frame(frame.data(), frame.size(), context);
+    }
+
+    // Blocking implementations; run on the caller in synchronous mode and on
+    // the I/O thread in async mode.
+    int ping_servo_blocking(int id);
+    int servo_read_raw_blocking(int id);
+    Arm_ServoReadings servo_read6_blocking();
+
+    /**
+     * @brief Body of the background I/O thread.
+     */
+    void io_thread_main();
 
     /**
-     * @brief Maps a value from one range to another (like Arduino's map()).
+     * @brief Writes the latest coalesced motion targets (I/O thread only).
      */
-    uint16_t map_angle_to_pos(int angle, int in_min, int in_max, int out_min, int out_max);
+    void flush_motion();
 
     /**
-     * @brief Calculates the checksum for a command packet.
+     * @brief Sends the per-joint writes collected in the batching window (I/O thread only).
      */
-    uint8_t calculate_checksum(const std::vector<uint8_t>& cmd);
+    void flush_joint_batch();
 
     /**
-     * @brief Writes a byte vector to the serial port.
+     * @brief Stops batching from filling untouched joints with targets sent
+     *        before the arm went limp or the shadow was invalidated. Ordered
+     *        with the commands already queued.
      */
-    void write_serial(const std::vector<uint8_t>& data);
+    void forget_batch_targets();
 
     /**
-     * @brief Read a single byte from the serial port with a timeout.
+     * @brief Bytes still waiting in the transport's output queue.
      */
-    bool read_byte(uint8_t& byte, unsigned int timeout_ms);
+    size_t tx_backlog() const;
 
     /**
      * @brief Read a protocol frame and return the payload without the checksum.
+     *        Waits at most @p timeout_ms in total, however the bytes trickle in.
+     *        The payload points into the decoder and stays valid until the next read.
      */
-    bool read_response(uint8_t& ext_type, std::vector<uint8_t>& payload, unsigned int timeout_ms = 200);
+    bool read_response(uint8_t& ext_type, arm_protocol::PayloadView& payload, unsigned int timeout_ms = 200);
 };
 
 #endif // ARM_LIB_H
@@ -0,0 +1,157 @@
+/**
+ * @file Arm_Protocol.h
+ * @brief Compile-time sized command frames for the Dofbot serial protocol.
+ *
+ * Every command sent to the board has the layout
+ *   0xFF 0xFC <len> <cmd> <payload...> <checksum>
+ * where <len> counts the bytes from <len> up to and including the checksum
+ * minus one, and the checksum is the low byte of the sum of all previous
+ * bytes seeded with 257 - 0xFC = 5. The encoders below build those frames in
+ * a fixed-size std::array so that no command touches the heap.
+ */
+
+#ifndef ARM_PROTOCOL_H
+#define ARM_PROTOCOL_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+namespace arm_protocol {
+
+constexpr uint8_t HEAD = 0xFF;
+constexpr uint8_t DEVICE_ID = 0xFC;
+// 257 - 252 = 5. Used as the starting value for the checksum.
+constexpr uint8_t COMPLEMENT = 5;
+
+// Command ids understood by the board
+constexpr uint8_t CMD_BUZZER = 0x06;
+constexpr uint8_t CMD_SERVO_WRITE_BASE = 0x10; // 0x11-0x16 write one servo
+constexpr uint8_t CMD_TORQUE = 0x1A;
+constexpr uint8_t CMD_SERVO_WRITE6 = 0x1D;
+constexpr uint8_t CMD_SERVO_READ_BASE = 0x30;  // 0x31-0x36 read one servo
+constexpr uint8_t CMD_PING = 0x38;
+
+// Reply type carrying a servo position
+constexpr uint8_t REPLY_SERVO = 0x0A;
+
+// Largest command frame we ever send (write6: 4 header + 14 payload + checksum)
+constexpr std::size_t MAX_FRAME_SIZE = 19;
+
+/**
+ * @brief A fully encoded command frame of N bytes, checksum included.
+ */
+template <std::size_t N>
+struct Frame {
+    std::array<uint8_t, N> bytes{};
+
+    static constexpr std::size_t size() { return N; }
+    const uint8_t* data() const { return bytes.data(); }
+};
+
+/**
+ * @brief Sums the bytes of a frame seeded with COMPLEMENT and returns the low byte.
+ */
+constexpr uint8_t checksum(const uint8_t* data, std::size_t len) {
+    unsigned int sum = COMPLEMENT;
+    for (std::size_t i = 0; i < len; ++i) {
+        sum += data[i];
+    }
+    return static_cast<uint8_t>(sum & 0xFF);
+}
+
+/**
+ * @brief Builds a frame for command @p cmd carrying the given payload bytes.
+ */
+template <typename... Payload>
+constexpr Frame<sizeof...(Payload) + 5> make_frame(uint8_t cmd, Payload... payload) {
+    Frame<sizeof...(Payload) + 5> frame{};
+    frame.bytes[0] = HEAD;
+    frame.bytes[1] = DEVICE_ID;
+    frame.bytes[2] = static_cast<uint8_t>(sizeof...(Payload) + 3);
+    frame.bytes[3] = cmd;
+
+    const uint8_t values[] = {static_cast<uint8_t>(payload)..., 0};
+    for (std::size_t i = 0; i < sizeof...(Payload); ++i) {
+        frame.bytes[4 + i] = values[i];
+    }
+
+    frame.bytes[frame.size() - 1] = checksum(frame.bytes.data(), frame.size() - 1);
+    return frame;
+}
+
+constexpr uint8_t high_byte(unsigned int value) { return static_cast<uint8_t>((value >> 8) & 0xFF); }
+constexpr uint8_t low_byte(unsigned int value) { return static_cast<uint8_t>(value & 0xFF); }
+
+/**
+ * @brief 0x1D: move all six servos to raw positions over @p time milliseconds.
+ */
+constexpr Frame<19> encode_servo_write6(uint16_t pos1, uint16_t pos2, uint16_t pos3,
+                                        uint16_t pos4, uint16_t pos5, uint16_t pos6,
+                                        uint16_t time) {
+    return make_frame(CMD_SERVO_WRITE6,
+                      high_byte(pos1), low_byte(pos1),
+                      high_byte(pos2), low_byte(pos2),
+                      high_byte(pos3), low_byte(pos3),
+                      high_byte(pos4), low_byte(pos4),
+                      high_byte(pos5), low_byte(pos5),
+                      high_byte(pos6), low_byte(pos6),
+                      high_byte(time), low_byte(time));
+}
+
+/**
+ * @brief 0x11-0x16: move servo @p id (1-6) to a raw position over @p time milliseconds.
+ */
+constexpr Frame<9> encode_servo_write(uint8_t id, uint16_t pos, uint16_t time) {
+    return make_frame(static_cast<uint8_t>(CMD_SERVO_WRITE_BASE + id),
+                      high_byte(pos), low_byte(pos),
+                      high_byte(time), low_byte(time));
+}
+
+/**
+ * @brief 0x31-0x36: request the position of servo @p id (1-6).
+ */
+constexpr Frame<5> encode_servo_read(uint8_t id) {
+    return make_frame(static_cast<uint8_t>(CMD_SERVO_READ_BASE + id));
+}
+
+/**
+ * @brief 0x1A: enable (non-zero) or disable torque on all servos.
+ */
+constexpr Frame<6> encode_torque(bool on) {
+    return make_frame(CMD_TORQUE, static_cast<uint8_t>(on ? 0x01 : 0x00));
+}
+
+/**
+ * @brief 0x38: ping servo @p id (1-250).
+ */
+constexpr Frame<6> encode_ping(uint8_t id) {
+    return make_frame(CMD_PING, id);
+}
+
+/**
+ * @brief 0x06: buzzer on for @p delay units (0 switches it off).
+ */
+constexpr Frame<6> encode_buzzer(uint8_t delay) {
+    return make_frame(CMD_BUZZER, delay);
+}
+
+// Reference frames from the Python driver: sum([0xFF,0xFC,0x04,0x1A,0x01], 5) & 0xFF
+static_assert(encode_torque(true).bytes[5] == 0x1F, "torque checksum");
+static_assert(encode_servo_read(1).bytes[4] == 0x34, "read checksum");
+
+/**
+ * @brief Non-owning view of a reply payload inside a receive buffer.
+ */
+struct PayloadView {
+    const uint8_t* data = nullptr;
+    std::size_t size = 0;
+
+    bool empty() const { return size == 0; }
+    uint8_t operator[](std::size_t index) const { return data[index]; }
+};
+
+} // namespace arm_protocol
+
+#endif // ARM_PROTOCOL_H
@@ -0,0 +1,113 @@
+/**
+ * @file alloc_bench.cpp
+ * @brief Counts heap allocations and time per command against a pseudo-terminal.
+ *
+ * The benchmark hands the slave side of a SimulatedPort to Arm_Device, so
+ * servo reads and pings get real replies. Global operator new is instrumented
+ * so every command type can be checked for per-call heap traffic.
+ */
+
+#include "Arm_Lib.h"
+#include "servo_sim.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <exception>
+#include <functional>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+
+namespace {
+    std::atomic<unsigned long> g_allocations(0);
+
+    void run_case(const char* name, int iterations, const std::function<void()>& body) {
+        // Warm up lazily initialised state (iostreams, std::function storage, ...)
+        body();
+
+        const unsigned long before = g_allocations.load();
+        const auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < iterations; ++i) {
+            body();
+        }
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        const unsigned long allocations = g_allocations.load() - before;
+
+        const double ns_per_op =
+            std::chrono::duration<double, std::nano>(elapsed).count() / iterations;
+        std::printf("%-24s %8d ops %12.0f ns/op %8.3f allocs/op\n",
+                    name, iterations, ns_per_op, static_cast<double>(allocations) / iterations);
+    }
+}
+
+void* operator new(std::size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+    std::free(p);
+}
+
+int main() {
+    try {
+        const SimulatedPort port;
+        const std::string& slave_name = port.path();
+
+        {
+            Arm_Device arm(slave_name);
+
+            run_case("servo_write6", 2000, [&] { arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 500); });
+            run_case("servo_write", 2000, [&] { arm.Arm_serial_servo_write(3, 45, 500); });
+            run_case("set_torque", 2000, [&] { arm.Arm_serial_set_torque(1); });
+            run_case("buzzer", 2000, [&] { arm.Arm_Buzzer_On(1); });
+            run_case("ping_servo", 200, [&] { arm.Arm_ping_servo(1); });
+            run_case("servo_read", 200, [&] { arm.Arm_serial_servo_read(1); });
+            run_case("servo_read6", 200, [&] { arm.Arm_serial_servo_read6(); });
+        }
+        {
+            Arm_Options options;
+            options.async_io = true;
+            options.queue_capacity = 4096;
+            Arm_Device arm(slave_name, options);
+
+            run_case("async_servo_write6", 2000, [&] { arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 500); });
+            run_case("async_servo_write", 2000, [&] { arm.Arm_serial_servo_write(3, 45, 500); });
+            arm.Arm_flush();
+            run_case("async_servo_read6", 200, [&] { arm.Arm_serial_servo_read6(); });
+
+            const Arm_AsyncStats stats = arm.Arm_async_stats();
+            std::printf("async queue: %llu submitted, %llu dropped\n",
+                        static_cast<unsigned long long>(stats.submitted),
+                        static_cast<unsigned long long>(stats.dropped));
+        }
+        {
+            Arm_Options options;
+            options.coalesce_motion = true;
+            Arm_Device arm(slave_name, options);
+
+            run_case("coalesced_servo_write6", 2000, [&] { arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 20); });
+            run_case("coalesced_servo_write", 2000, [&] { arm.Arm_serial_servo_write(3, 45, 20); });
+            arm.Arm_flush();
+
+            const Arm_AsyncStats stats = arm.Arm_async_stats();
+            std::printf("coalescing: %llu targets superseded before reaching the port\n",
+                        static_cast<unsigned long long>(stats.coalesced));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,375 @@
+#include "arm_daemon.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <new>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    constexpr std::size_t kMaxLineLength = 4096;
+
+    sockaddr_un unix_address(const std::string& path) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (path.size() >= sizeof(addr.sun_path)) {
+            throw std::runtime_error("Daemon socket path is too long: " + path);
+        }
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        return addr;
+    }
+
+    // A peer that hangs up early must not raise SIGPIPE in the host program
+    bool send_all(int fd, const std::string& text) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        const char* data = text.data();
+        std::size_t left = text.size();
+        while (left > 0) {
+            const ssize_t n = ::send(fd, data, left, flags);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            data += n;
+            left -= static_cast<std::size_t>(n);
+        }
+        return true;
+    }
+
+    // Receives until @p buffer holds a complete line and moves it to @p line
+    bool receive_line(int fd, std::string& buffer, std::string& line) {
+        for (;;) {
+            const std::size_t end = buffer.find('\n');
+            if (end != std::string::npos) {
+                line.assign(buffer, 0, end);
+                buffer.erase(0, end + 1);
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                return true;
+            }
+            if (buffer.size() > kMaxLineLength) {
+                return false;
+            }
+            char chunk[512];
+            const ssize_t n = ::recv(fd, chunk, sizeof(chunk), 0);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return false;
+            }
+            buffer.append(chunk, static_cast<std::size_t>(n));
+        }
+    }
+
+    template <typename T>
+    T next_arg(std::istringstream& in, const char* what) {
+        T value{};
+        if (!(in >> value)) {
+            throw std::invalid_argument(std::string("expected ") + what);
+        }
+        return value;
+    }
+
+    template <typename Array>
+    std::string join(const Array& values) {
+        std::ostringstream out;
+        for (std::size_t i = 0; i < values.size(); ++i) {
+            out << (i ? " " : "") << values[i];
+        }
+        return out.str();
+    }
+}
+
+DaemonStatusReader::DaemonStatusReader(const std::string& name)
+    : memory(name, sizeof(SeqLock<DaemonStatus>), DAEMON_STATUS_LAYOUT, SharedMemory::Mode::ReadOnly) {
+}
+
+DaemonClient::DaemonClient(const std::string& socket_path) {
+    const sockaddr_un addr = unix_address(socket_path);
+    fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0) {
+        const std::string error = strerror(errno);
+        if (fd >= 0) {
+            close(fd);
+        }
+        throw std::runtime_error("Failed to connect to dofbotd at " + socket_path + " - " + error);
+    }
+}
+
+DaemonClient::~DaemonClient() {
+    close(fd);
+}
+
+std::string DaemonClient::request(const std::string& line) {
+    std::string reply;
+    if (!send_all(fd, line + "\n") || !receive_line(fd, pending, reply)) {
+        throw std::runtime_error("Lost the connection to dofbotd.");
+    }
+    if (reply.rfind("ok", 0) == 0) {
+        return reply.size() > 3 ? reply.substr(3) : std::string();
+    }
+    if (reply.rfind("error ", 0) == 0) {
+        throw std::runtime_error(reply.substr(6));
+    }
+    throw std::runtime_error("Unexpected reply from dofbotd: " + reply);
+}
+
+int DaemonClient::ping(int id) {
+    return std::stoi(request("ping " + std::to_string(id)));
+}
+
+void DaemonClient::write(int id, double angle, int time) {
+    std::ostringstream line;
+    line << "write " << id << ' ' << angle << ' ' << time;
+    request(line.str());
+}
+
+void DaemonClient::write6(const std::array<double, 6>& angles, int time) {
+    request("write6 " + join(angles) + " " + std::to_string(time));
+}
+
+int DaemonClient::read(int id) {
+    return std::stoi(request("read " + std::to_string(id)));
+}
+
+std::array<int, 6> DaemonClient::read6() {
+    std::istringstream in(request("read6"));
+    std::array<int, 6> angles{};
+    for (int& angle : angles) {
+        if (!(in >> angle)) {
+            throw std::runtime_error("Malformed read6 reply from dofbotd.");
+        }
+    }
+    return angles;
+}
+
+void DaemonClient::torque(bool on) {
+    request(on ? "torque on" : "torque off");
+}
+
+void DaemonClient::buzzer(int delay) {
+    request("buzzer " + std::to_string(delay));
+}
+
+void DaemonClient::buzzer_off() {
+    request("buzzer off");
+}
+
+DaemonServer::DaemonServer(Arm_Device& arm, const DaemonOptions& options) : arm(arm), options(options) {
+    if (!arm.Arm_is_async()) {
+        throw std::invalid_argument("dofbotd needs an Arm_Device opened with async_io.");
+    }
+    if (!(options.poll_hz >= 0.0)) {
+        throw std::invalid_argument("Poll rate must not be negative.");
+    }
+    const sockaddr_un addr = unix_address(options.socket_path);
+    if (!options.shm_name.empty()) {
+        status_memory.reset(new SharedMemory(options.shm_name, sizeof(SeqLock<DaemonStatus>), DAEMON_STATUS_LAYOUT,
+                                             SharedMemory::Mode::Create));
+        status = new (status_memory->data()) SeqLock<DaemonStatus>();
+    }
+    if (pipe(wake_pipe.data()) != 0) {
+        throw std::runtime_error("Failed to create wake-up pipe: " + std::string(strerror(errno)));
+    }
+
+    ::unlink(options.socket_path.c_str());   // A stale socket from a previous run
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<const sockaddr*>(&addr), sizeof(addr)) != 0 ||
+        ::listen(listen_fd, 16) != 0) {
+        const std::string error = strerror(errno);
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        close(wake_pipe[0]);
+        close(wake_pipe[1]);
+        throw std::runtime_error("Failed to listen on " + options.socket_path + " - " + error);
+    }
+
+    publish_status();
+    acceptor = std::thread(&DaemonServer::accept_loop, this);
+    if (options.poll_hz > 0.0) {
+        poller = std::thread(&DaemonServer::poll_loop, this);
+    }
+}
+
+DaemonServer::~DaemonServer() {
+    running = false;
+    const char byte = 0;
+    if (::write(wake_pipe[1], &byte, 1) < 0) {
+        std::cerr << "Failed to stop dofbotd cleanly." << std::endl;
+    }
+    acceptor.join();
+    if (poller.joinable()) {
+        poller.join();
+    }
+    {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        for (Connection& connection : connections) {
+            ::shutdown(connection.fd, SHUT_RDWR);
+            connection.thread.join();
+            close(connection.fd);
+        }
+        connections.clear();
+    }
+    close(listen_fd);
+    ::unlink(options.socket_path.c_str());
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+}
+
+std::string DaemonServer::handle(const std::string& line) {
+    std::istringstream in(line);
+    std::string command;
+    in >> command;
+    std::string reply = "ok";
+
+    try {
+        if (command == "ping") {
+            reply += " " + std::to_string(arm.Arm_ping_servo(next_arg<int>(in, "servo id")));
+        } else if (command == "write") {
+            const int id = next_arg<int>(in, "servo id");
+            const double angle = next_arg<double>(in, "angle");
+            arm.Arm_serial_servo_write(id, angle, next_arg<int>(in, "move time"));
+        } else if (command == "write6") {
+            std::array<double, 6> angles{};
+            for (double& angle : angles) {
+                angle = next_arg<double>(in, "six angles");
+            }
+            arm.Arm_serial_servo_write6(angles, next_arg<int>(in, "move time"));
+        } else if (command == "read") {
+            reply += " " + std::to_string(arm.Arm_serial_servo_read(next_arg<int>(in, "servo id")));
+        } else if (command == "read6") {
+            reply += " " + join(arm.Arm_serial_servo_read6().angles);
+        } else if (command == "torque") {
+            const std::string state = next_arg<std::string>(in, "on or off");
+            if (state != "on" && state != "off") {
+                throw std::invalid_argument("expected on or off");
+            }
+            arm.Arm_serial_set_torque(state == "on" ? 1 : 0);
+        } else if (command == "buzzer") {
+            std::string delay;
+            if (!(in >> delay)) {
+                arm.Arm_Buzzer_On();
+            } else if (delay == "off") {
+                arm.Arm_Buzzer_Off();
+            } else {
+                arm.Arm_Buzzer_On(std::stoi(delay));
+            }
+        } else if (command == "status") {
+            reply += " " + std::to_string(clients.load()) + " " + std::to_string(requests.load()) + " " +
+                     std::to_string(polls.load());
+        } else {
+            throw std::invalid_argument("unknown command '" + command + "'");
+        }
+
+        std::string extra;
+        if (in >> extra) {
+            throw std::invalid_argument("unexpected '" + extra + "'");
+        }
+    } catch (const std::exception& e) {
+        reply = std::string("error ") + e.what();
+    }
+    requests.fetch_add(1, std::memory_order_relaxed);
+    publish_status();
+    return reply;
+}
+
+void DaemonServer::accept_loop() {
+    while (running) {
+        std::array<pollfd, 2> fds = {{{wake_pipe[0], POLLIN, 0}, {listen_fd, POLLIN, 0}}};
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "dofbotd poll failed: " << strerror(errno) << std::endl;
+            return;
+        }
+        if (fds[0].revents != 0) {
+            return;
+        }
+        const int client = ::accept(listen_fd, nullptr, nullptr);
+        if (client < 0) {
+            continue;
+        }
+
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        // Reap connections whose client hung up
+        for (auto it = connections.begin(); it != connections.end();) {
+            if (it->done) {
+                it->thread.join();
+                close(it->fd);
+                it = connections.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        connections.emplace_back();
+        Connection& connection = connections.back();
+        connection.fd = client;
+        clients.fetch_add(1);
+        connection.thread = std::thread(&DaemonServer::serve, this, std::ref(connection));
+    }
+}
+
+void DaemonServer::serve(Connection& connection) {
+    std::string buffer;
+    std::string line;
+    while (running && receive_line(connection.fd, buffer, line)) {
+        if (!send_all(connection.fd, handle(line) + "\n")) {
+            break;
+        }
+    }
+    clients.fetch_sub(1);
+    publish_status();
+    connection.done = true;
+}
+
+void DaemonServer::poll_loop() {
+    const auto period = std::chrono::duration<double>(1.0 / options.poll_hz);
+    auto next_poll = std::chrono::steady_clock::now();
+    for (;;) {
+        // A slow read6 pushes the schedule back rather than causing a burst
+        next_poll = std::max(next_poll + std::chrono::duration_cast<std::chrono::steady_clock::duration>(period),
+                             std::chrono::steady_clock::now());
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(
+            next_poll - std::chrono::steady_clock::now());
+        pollfd wake = {wake_pipe[0], POLLIN, 0};
+        if (::poll(&wake, 1, static_cast<int>(std::max<int64_t>(0, wait.count()))) > 0) {
+            return;
+        }
+        // Arm_Device publishes the measured pose itself
+        arm.Arm_serial_servo_read6();
+        polls.fetch_add(1, std::memory_order_relaxed);
+        publish_status();
+    }
+}
+
+void DaemonServer::publish_status() {
+    if (!status) {
+        return;
+    }
+    DaemonStatus current;
+    current.torque = arm.Arm_shadow_state().torque;
+    current.clients = clients.load(std::memory_order_relaxed);
+    current.requests = requests.load(std::memory_order_relaxed);
+    current.polls = polls.load(std::memory_order_relaxed);
+    current.pid = static_cast<int32_t>(getpid());
+    status->store(current);
+}
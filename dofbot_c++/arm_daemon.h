@@ -0,0 +1,187 @@
+/**
+ * @file arm_daemon.h
+ * @brief dofbotd: one long-running process owns the serial port and serves
+ *        any number of local clients.
+ *
+ * DaemonServer runs the Arm_Device in async mode and answers requests on a
+ * Unix stream socket, one thread per connection. Each request is one text
+ * line and gets one reply line, so the protocol also works from a shell
+ * (`echo "read6" | socat - UNIX-CONNECT:/tmp/dofbotd.sock`):
+ *
+ *   ping ID                          ok STATUS
+ *   write ID ANGLE TIME              ok
+ *   write6 A1 A2 A3 A4 A5 A6 TIME    ok
+ *   read ID                          ok ANGLE        (-1 if no valid reply)
+ *   read6                            ok A1 ... A6
+ *   torque on|off                    ok
+ *   buzzer [DELAY] | buzzer off      ok
+ *   status                           ok CLIENTS REQUESTS POLLS
+ *
+ * Failures reply "error MESSAGE". Writes only queue the command, so they are
+ * answered in microseconds.
+ *
+ * The daemon's Arm_Device publishes its PoseSnapshot (commanded pose, and
+ * the measured pose refreshed by a background read6 poll) in shared memory
+ * under daemon_pose_shm_name(), and the daemon its counters as a
+ * SeqLock<DaemonStatus> under DaemonOptions::shm_name. SharedPoseReader and
+ * DaemonStatusReader copy consistent snapshots out without locks or
+ * syscalls, so clients that only watch the arm never touch the socket or the
+ * serial link.
+ */
+
+#ifndef DOFBOT_ARM_DAEMON_H
+#define DOFBOT_ARM_DAEMON_H
+
+#include "Arm_Lib.h"
+#include "pose_snapshot.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+
+constexpr const char* DAEMON_SOCKET_PATH = "/tmp/dofbotd.sock";
+constexpr const char* DAEMON_SHM_NAME = "/dofbotd";
+
+/**
+ * @brief Name of the pose segment that goes with status segment @p shm_name.
+ */
+inline std::string daemon_pose_shm_name(const std::string& shm_name) {
+    return shm_name + ".pose";
+}
+
+/**
+ * @brief Counters published by the daemon.
+ */
+struct DaemonStatus {
+    int torque = -1;           // 1 on, 0 off, -1 not commanded yet
+    uint32_t clients = 0;      // Open connections
+    uint64_t requests = 0;     // Requests answered since start
+    uint64_t polls = 0;        // Background read6 polls
+    int32_t pid = 0;
+};
+
+constexpr uint32_t DAEMON_STATUS_LAYOUT = 0x44535402;   // "DST" v2
+
+/**
+ * @brief Read-only view of a running daemon's status segment.
+ */
+class DaemonStatusReader {
+public:
+    /**
+     * @throws std::runtime_error if no daemon has published @p name.
+     */
+    explicit DaemonStatusReader(const std::string& name = DAEMON_SHM_NAME);
+
+    /**
+     * @brief Latest consistent status; lock-free.
+     */
+    DaemonStatus read() const {
+        return static_cast<const SeqLock<DaemonStatus>*>(memory.data())->load();
+    }
+
+private:
+    SharedMemory memory;
+};
+
+/**
+ * @brief Connection to dofbotd. Not thread-safe; open one per thread.
+ */
+class DaemonClient {
+public:
+    /**
+     * @throws std::runtime_error if the daemon is not listening on @p socket_path.
+     */
+    explicit DaemonClient(const std::string& socket_path = DAEMON_SOCKET_PATH);
+    ~DaemonClient();
+
+    DaemonClient(const DaemonClient&) = delete;
+    DaemonClient& operator=(const DaemonClient&) = delete;
+
+    /**
+     * @brief Sends one request line and returns the reply after "ok".
+     * @throws std::runtime_error with the daemon's message on "error", or if
+     *         the connection fails.
+     */
+    std::string request(const std::string& line);
+
+    int ping(int id);
+    void write(int id, double angle, int time);
+    void write6(const std::array<double, 6>& angles, int time);
+    int read(int id);
+    std::array<int, 6> read6();
+    void torque(bool on);
+    void buzzer(int delay = 0xFF);
+    void buzzer_off();
+
+private:
+    int fd = -1;
+    std::string pending;   // Received bytes not yet consumed as a reply line
+};
+
+struct DaemonOptions {
+    std::string socket_path = DAEMON_SOCKET_PATH;
+    std::string shm_name = DAEMON_SHM_NAME;   // Status segment; empty disables it
+    double poll_hz = 10.0;                    // Background read6 rate for the measured pose; 0 disables
+};
+
+/**
+ * @brief Serves an async Arm_Device to local clients until stopped.
+ */
+class DaemonServer {
+public:
+    /**
+     * @param arm Opened with Arm_Options::async_io, so clients can share it, and
+     *        usually with Arm_Options::pose_shm_name = daemon_pose_shm_name().
+     * @throws std::invalid_argument if @p arm is not in async mode.
+     * @throws std::runtime_error if the socket or segment cannot be created.
+     */
+    DaemonServer(Arm_Device& arm, const DaemonOptions& options = DaemonOptions());
+
+    /**
+     * @brief Stops serving, closes every connection and removes the socket.
+     */
+    ~DaemonServer();
+
+    DaemonServer(const DaemonServer&) = delete;
+    DaemonServer& operator=(const DaemonServer&) = delete;
+
+    /**
+     * @brief Answers one request line, exactly as a connected client would see it.
+     */
+    std::string handle(const std::string& line);
+
+private:
+    struct Connection {
+        int fd;
+        std::thread thread;
+        std::atomic<bool> done{false};
+    };
+
+    Arm_Device& arm;
+    DaemonOptions options;
+    std::unique_ptr<SharedMemory> status_memory;
+    SeqLock<DaemonStatus>* status = nullptr;   // In status_memory; null without a segment
+    int listen_fd = -1;
+    std::array<int, 2> wake_pipe{{-1, -1}};
+    std::atomic<bool> running{true};
+    std::thread acceptor;
+    std::thread poller;
+
+    std::mutex connections_mutex;
+    std::list<Connection> connections;
+
+    std::atomic<uint32_t> clients{0};
+    std::atomic<uint64_t> requests{0};
+    std::atomic<uint64_t> polls{0};
+
+    void accept_loop();
+    void serve(Connection& connection);
+    void poll_loop();
+    void publish_status();
+};
+
+#endif // DOFBOT_ARM_DAEMON_H
@@ -17,7 +17,7 @@ int main(int argc, char* argv[]) {
 
     try {
         const CommonArgs args = parse_common_args(argc, argv, description);
-        Arm_Device arm(args.port);
+        Arm_Device arm(args.port, make_arm_options(args));
 
         std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
 
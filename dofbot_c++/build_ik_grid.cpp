@@ -0,0 +1,131 @@
+/**
+ * @file build_ik_grid.cpp
+ * @brief Builds an IK lookup grid file for a workspace box and checks it.
+ */
+
+#include "ik_grid.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <exception>
+#include <iostream>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    const char* kUsage =
+        "Build a precomputed IK grid for fast pick-and-place lookups.\n\n"
+        "Usage: build_ik_grid --out PATH [options]\n"
+        "  --out PATH          Grid file to write (required)\n"
+        "  --min X Y Z         Lower corner of the box in metres (default: -0.35 -0.35 0)\n"
+        "  --max X Y Z         Upper corner of the box in metres (default: 0.35 0.35 0.45)\n"
+        "  --step M            Node spacing in metres (default: 0.01)\n"
+        "  --pitch DEG         Tool pitch below horizontal (default: 90, pointing down)\n"
+        "  --roll DEG          S5 angle for every solution (default: 90)\n"
+        "  --threads N         Worker threads, 0 = one per core (default: 0)\n"
+        "  --calibration PATH  Joint ranges of this arm (default: stock mapping)\n"
+        "  --help              Show this message and exit\n";
+
+    const std::string& expect_value(const std::vector<std::string>& tokens, size_t& index) {
+        if (index + 1 >= tokens.size()) {
+            throw std::runtime_error("Missing value for argument: " + tokens[index]);
+        }
+        return tokens[++index];
+    }
+
+    double elapsed_ms(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        IkGridSpec spec;
+        std::string out_path;
+        unsigned threads = 0;
+        CalibrationProfile calibration = DEFAULT_CALIBRATION;
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& token = args[i];
+            if (token == "--help" || token == "-h") {
+                std::cout << kUsage;
+                return 0;
+            } else if (token == "--out") {
+                out_path = expect_value(args, i);
+            } else if (token == "--min" || token == "--max") {
+                std::array<float, 3>& corner = (token == "--min") ? spec.min : spec.max;
+                for (float& value : corner) {
+                    value = std::stof(expect_value(args, i));
+                }
+            } else if (token == "--step") {
+                spec.step = std::stof(expect_value(args, i));
+            } else if (token == "--pitch") {
+                spec.pitch = std::stof(expect_value(args, i));
+            } else if (token == "--roll") {
+                spec.roll = std::stof(expect_value(args, i));
+            } else if (token == "--threads") {
+                threads = static_cast<unsigned>(std::stoul(expect_value(args, i)));
+            } else if (token == "--calibration") {
+                calibration = CalibrationProfile::load(expect_value(args, i));
+            } else {
+                std::cerr << "Unrecognized argument: " << token << "\n\n" << kUsage;
+                return 1;
+            }
+        }
+        if (out_path.empty()) {
+            std::cerr << kUsage;
+            return 1;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        const IkGrid built = IkGrid::build(spec, ArmGeometry(), threads, calibration);
+        const double build_ms = elapsed_ms(start);
+        built.save(out_path);
+
+        start = std::chrono::steady_clock::now();
+        const IkGrid grid = IkGrid::open(out_path, calibration);
+        const double open_ms = elapsed_ms(start);
+
+        const std::array<uint32_t, 3>& dims = grid.dimensions();
+        std::cout << "Grid " << dims[0] << " x " << dims[1] << " x " << dims[2] << ": "
+                  << grid.reachable_count() << " of " << grid.node_count() << " nodes reachable\n";
+        std::cout << "Built in " << build_ms << " ms, mapped in " << open_ms << " ms -> " << out_path << '\n';
+
+        // Spot-check: look up random points that the analytic solver can reach
+        std::mt19937 rng(7);
+        std::uniform_real_distribution<double> ux(spec.min[0], spec.max[0]);
+        std::uniform_real_distribution<double> uy(spec.min[1], spec.max[1]);
+        std::uniform_real_distribution<double> uz(spec.min[2], spec.max[2]);
+        const DofbotKinematics& kinematics = grid.kinematics();
+        size_t tried = 0, found = 0;
+        double lookup_ns = 0.0;
+        for (int i = 0; i < 2000; ++i) {
+            CartesianPose target;
+            target.x = ux(rng);
+            target.y = uy(rng);
+            target.z = uz(rng);
+            target.pitch = spec.pitch;
+            target.roll = spec.roll;
+            std::array<double, 6> reference = {90, 90, 90, 90, 90, 90};
+            if (!kinematics.inverse(target, reference)) {
+                continue;
+            }
+            ++tried;
+            std::array<double, 6> joints = {90, 90, 90, 90, 90, 90};
+            start = std::chrono::steady_clock::now();
+            found += grid.lookup(target.x, target.y, target.z, joints);
+            lookup_ns += elapsed_ms(start) * 1e6;
+        }
+        if (tried > 0) {
+            std::cout << "Lookup: " << found << " of " << tried << " reachable samples solved, "
+                      << lookup_ns / tried << " ns per lookup\n";
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
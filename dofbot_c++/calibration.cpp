@@ -0,0 +1,99 @@
+#include "calibration.h"
+
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace {
+    int read_int(std::istringstream& in, const char* what) {
+        int value = 0;
+        if (!(in >> value)) {
+            throw std::invalid_argument(std::string("expected ") + what);
+        }
+        return value;
+    }
+
+    uint16_t read_position(std::istringstream& in) {
+        const int value = read_int(in, "servo id, position span, range and orientation");
+        if (value < 0 || value > std::numeric_limits<uint16_t>::max()) {
+            throw std::invalid_argument("position " + std::to_string(value) + " is out of range");
+        }
+        return static_cast<uint16_t>(value);
+    }
+
+    int16_t read_offset(std::istringstream& in) {
+        const int value = read_int(in, "offset in servo counts");
+        if (value < std::numeric_limits<int16_t>::min() || value > std::numeric_limits<int16_t>::max()) {
+            throw std::invalid_argument("offset " + std::to_string(value) + " is out of range");
+        }
+        return static_cast<int16_t>(value);
+    }
+
+    std::size_t read_id(std::istringstream& in) {
+        const int id = read_int(in, "servo id");
+        if (id < 1 || id > 6) {
+            throw std::invalid_argument("servo id must be between 1 and 6");
+        }
+        return static_cast<std::size_t>(id - 1);
+    }
+}
+
+CalibrationProfile CalibrationProfile::parse(const std::string& text) {
+    std::array<JointCalibration, 6> joints = DEFAULT_CALIBRATION.joints;
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+
+    while (std::getline(lines, line)) {
+        ++number;
+        const std::size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream in(line);
+        std::string command;
+        if (!(in >> command)) {
+            continue;
+        }
+
+        try {
+            if (command == "joint") {
+                JointCalibration& joint = joints[read_id(in)];
+                joint.pos_min = read_position(in);
+                joint.pos_max = read_position(in);
+                joint.max_angle = read_position(in);
+                std::string orientation;
+                in >> orientation;
+                if (orientation != "normal" && orientation != "mirrored") {
+                    throw std::invalid_argument("expected normal or mirrored");
+                }
+                joint.mirrored = (orientation == "mirrored");
+                in >> std::ws;
+                joint.offset = in.eof() ? 0 : read_offset(in);
+            } else if (command == "offset") {
+                JointCalibration& joint = joints[read_id(in)];
+                joint.offset = read_offset(in);
+            } else {
+                throw std::invalid_argument("unknown command '" + command + "'");
+            }
+
+            std::string extra;
+            if (in >> extra) {
+                throw std::invalid_argument("unexpected '" + extra + "'");
+            }
+        } catch (const std::exception& e) {
+            throw std::invalid_argument("Calibration line " + std::to_string(number) + ": " + e.what());
+        }
+    }
+    return CalibrationProfile(joints);
+}
+
+CalibrationProfile CalibrationProfile::load(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open calibration profile: " + path);
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse(text.str());
+}
@@ -0,0 +1,194 @@
+/**
+ * @file calibration.h
+ * @brief Per-joint mapping between angles and raw servo positions.
+ *
+ * Every conversion between degrees and servo counts goes through a
+ * CalibrationProfile: the stock Dofbot mapping is DEFAULT_CALIBRATION, built
+ * at compile time, and an arm with its own trims can either bake a constexpr
+ * profile into the program or load one at runtime (see parse()).
+ *
+ * The constructor precomputes everything: whole degrees are a table lookup
+ * and fractional angles a multiply-add, so no conversion branches on the
+ * joint or divides. Both round to the nearest count, so 7 and 7.0 degrees
+ * send the same position.
+ *
+ * Profile text, one command per line ('#' starts a comment); joints not
+ * mentioned keep the stock mapping:
+ *   joint ID POS_MIN POS_MAX MAX_ANGLE normal|mirrored [OFFSET]
+ *   offset ID COUNTS                 trim one joint by COUNTS servo counts
+ */
+
+#ifndef DOFBOT_CALIBRATION_H
+#define DOFBOT_CALIBRATION_H
+
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+/**
+ * @brief Servo travel of one joint: raw positions pos_min..pos_max span
+ *        0..max_angle degrees, shifted by offset.
+ */
+struct JointCalibration {
+    uint16_t pos_min = 0;
+    uint16_t pos_max = 0;
+    uint16_t max_angle = 0;   // At most CalibrationProfile::MAX_ANGLE
+    bool mirrored = false;    // Mounted mirrored: angle a is driven as max_angle - a
+    int16_t offset = 0;       // Servo counts added to every position sent and removed from every one read
+};
+
+class CalibrationProfile {
+public:
+    static constexpr int MAX_ANGLE = 270;
+
+    /**
+     * @throws std::invalid_argument if a joint's span is empty, its range is
+     *         not 1..MAX_ANGLE degrees or the offset pushes it outside 0..65535.
+     */
+    constexpr explicit CalibrationProfile(const std::array<JointCalibration, 6>& calibration)
+        : joints(calibration) {
+        for (std::size_t j = 0; j < 6; ++j) {
+            const JointCalibration& c = joints[j];
+            if (c.pos_min >= c.pos_max || c.max_angle < 1 || c.max_angle > MAX_ANGLE ||
+                c.pos_min + c.offset < 0 || c.pos_max + c.offset > 0xFFFF) {
+                throw std::invalid_argument("Invalid calibration for servo " + std::to_string(j + 1) + ".");
+            }
+            const int counts = c.pos_max - c.pos_min;
+            base[j] = c.pos_min + c.offset;
+            origin[j] = c.mirrored ? c.max_angle : 0;
+            sign[j] = c.mirrored ? -1 : 1;
+            counts_per_degree[j] = static_cast<double>(counts) / c.max_angle;
+            degrees_per_count[j] = static_cast<double>(c.max_angle) / counts;
+            // Same arithmetic as the fractional overload, so both agree to the count
+            for (int angle = 0; angle <= c.max_angle; ++angle) {
+                table[j][static_cast<std::size_t>(angle)] = nearest_count(j, angle);
+            }
+        }
+    }
+
+    /**
+     * @brief Parses profile text on top of DEFAULT_CALIBRATION.
+     * @throws std::invalid_argument naming the offending line.
+     */
+    static CalibrationProfile parse(const std::string& text);
+
+    /**
+     * @brief Reads and parses a profile file.
+     * @throws std::runtime_error if the file cannot be read; std::invalid_argument as parse().
+     */
+    static CalibrationProfile load(const std::string& path);
+
+    constexpr const JointCalibration& joint(int id) const { return joints[index(id)]; }
+    constexpr int max_angle(int id) const { return joints[index(id)].max_angle; }
+
+    /**
+     * @brief max_angle() of every joint, S1 first, for range checks on angle arrays.
+     */
+    constexpr std::array<double, 6> max_angles() const {
+        std::array<double, 6> angles{};
+        for (std::size_t j = 0; j < 6; ++j) {
+            angles[j] = joints[j].max_angle;
+        }
+        return angles;
+    }
+
+    /**
+     * @brief Lowest and highest raw position joint @p id (1-6) may be sent.
+     */
+    constexpr uint16_t min_position(int id) const { return static_cast<uint16_t>(base[index(id)]); }
+    constexpr uint16_t max_position(int id) const {
+        return static_cast<uint16_t>(base[index(id)] + joints[index(id)].pos_max - joints[index(id)].pos_min);
+    }
+
+    /**
+     * @brief True if @p angle is inside joint @p id's range (false for NaN).
+     */
+    constexpr bool contains(int id, double angle) const {
+        return angle >= 0.0 && angle <= joints[index(id)].max_angle;
+    }
+
+    /**
+     * @brief Raw position for @p angle whole degrees on servo @p id (1-6), a table
+     *        lookup. No range check: callers validate with contains() beforehand.
+     */
+    constexpr uint16_t angle_to_position(int id, int angle) const {
+        return table[index(id)][static_cast<std::size_t>(angle)];
+    }
+
+    /**
+     * @brief Raw position for a fractional @p angle, rounded to the nearest count
+     *        (about 0.08 degrees). No range check, as above.
+     */
+    constexpr uint16_t angle_to_position(int id, double angle) const {
+        return nearest_count(index(id), angle);
+    }
+
+    /**
+     * @brief Whole-degree angle for raw position @p pos reported by servo @p id,
+     *        or -1 if the position maps outside the joint's range.
+     */
+    int position_to_angle(int id, uint16_t pos) const {
+        const std::size_t j = index(id);
+        const int driven = static_cast<int>(std::lround((pos - base[j]) * degrees_per_count[j]));
+        if (driven < 0 || driven > joints[j].max_angle) {
+            return -1;
+        }
+        return origin[j] + sign[j] * driven;
+    }
+
+    /**
+     * @brief Angle for raw position @p pos without rounding, or -1.0 if the
+     *        position maps outside the joint's range.
+     */
+    double position_to_angle_precise(int id, uint16_t pos) const {
+        const std::size_t j = index(id);
+        const double driven = (pos - base[j]) * degrees_per_count[j];
+        // Same acceptance window as position_to_angle(): anything that rounds into range
+        if (driven < -0.5 || driven >= joints[j].max_angle + 0.5) {
+            return -1.0;
+        }
+        const double clamped = driven < 0.0 ? 0.0 : (driven > joints[j].max_angle ? joints[j].max_angle : driven);
+        return origin[j] + sign[j] * clamped;
+    }
+
+private:
+    std::array<JointCalibration, 6> joints{};
+
+    // Derived per joint: position = base + (origin + sign * angle) * counts_per_degree
+    std::array<int, 6> base{};
+    std::array<int, 6> origin{};
+    std::array<int, 6> sign{};
+    std::array<double, 6> counts_per_degree{};
+    std::array<double, 6> degrees_per_count{};
+    std::array<std::array<uint16_t, MAX_ANGLE + 1>, 6> table{};
+
+    static constexpr std::size_t index(int id) { return static_cast<std::size_t>(id - 1); }
+
+    // Positions of in-range angles are never negative, so adding one half and
+    // truncating rounds to nearest (halves up, like std::lround)
+    constexpr uint16_t nearest_count(std::size_t j, double angle) const {
+        return static_cast<uint16_t>(base[j] + (origin[j] + sign[j] * angle) * counts_per_degree[j] + 0.5);
+    }
+};
+
+/**
+ * @brief The stock Dofbot mapping: joints 2-4 mirrored, servo 5 with the wider span.
+ */
+inline constexpr CalibrationProfile DEFAULT_CALIBRATION({{
+    {900, 3100, 180, false, 0},
+    {900, 3100, 180, true, 0},
+    {900, 3100, 180, true, 0},
+    {900, 3100, 180, true, 0},
+    {380, 3700, 270, false, 0},
+    {900, 3100, 180, false, 0},
+}});
+
+static_assert(DEFAULT_CALIBRATION.angle_to_position(1, 90) == 2000 &&
+              DEFAULT_CALIBRATION.angle_to_position(2, 180) == 900 &&
+              DEFAULT_CALIBRATION.angle_to_position(1, 7) == DEFAULT_CALIBRATION.angle_to_position(1, 7.0),
+              "angle mapping");
+
+#endif // DOFBOT_CALIBRATION_H
@@ -18,9 +18,13 @@ namespace {
         if (!description.empty()) {
             std::cout << description << "\n\n";
         }
-        std::cout << "Usage: " << program << " [--port PATH] [--init-delay SECONDS]\n";
+        std::cout << "Usage: " << program << " [--port PATH] [--init-delay SECONDS] [--record PATH]\n"
+                 "       [--calibration PATH] [--metrics PATH]\n";
         std::cout << "  --port         Serial device path (default: /dev/tty.usbserial-2130)\n";
-        std::cout << "  --init-delay   Seconds to wait after connecting before commands (default: 0.1)\n";
+        std::cout << "  --init-delay   Extra seconds to wait once the board has answered (default: 0)\n";
+        std::cout << "  --record       Capture every command sent to the arm, for dofbot_replay\n";
+        std::cout << "  --calibration  Per-joint calibration profile (see calibration.h)\n";
+        std::cout << "  --metrics      Rewrite this file every second with I/O metrics (Prometheus text)\n";
         std::cout << "  --help         Show this message and exit\n";
     }
 }
@@ -39,12 +43,24 @@ CommonArgs parse_common_args(int argc, char* argv[], const std::string& descript
             args.port = argv[++i];
         } else if (current == "--init-delay" && i + 1 < argc) {
             args.init_delay = std::stod(argv[++i]);
+        } else if (current == "--record" && i + 1 < argc) {
+            args.record_path = argv[++i];
+        } else if (current == "--calibration" && i + 1 < argc) {
+            args.calibration_path = argv[++i];
+        } else if (current == "--metrics" && i + 1 < argc) {
+            args.metrics_path = argv[++i];
         } else {
             std::string value;
             if (matches_prefix(current, "--port=", value)) {
                 args.port = value;
             } else if (matches_prefix(current, "--init-delay=", value)) {
                 args.init_delay = std::stod(value);
+            } else if (matches_prefix(current, "--record=", value)) {
+                args.record_path = value;
+            } else if (matches_prefix(current, "--calibration=", value)) {
+                args.calibration_path = value;
+            } else if (matches_prefix(current, "--metrics=", value)) {
+                args.metrics_path = value;
             } else {
                 if (remaining_args) {
                     remaining_args->push_back(current);
@@ -59,3 +75,13 @@ CommonArgs parse_common_args(int argc, char* argv[], const std::string& descript
 
     return args;
 }
+
+Arm_Options make_arm_options(const CommonArgs& args) {
+    Arm_Options options;
+    options.capture_path = args.record_path;
+    options.metrics_path = args.metrics_path;
+    if (!args.calibration_path.empty()) {
+        options.calibration = CalibrationProfile::load(args.calibration_path);
+    }
+    return options;
+}
@@ -6,19 +6,32 @@
 #ifndef DOFBOT_CLI_ARGS_H
 #define DOFBOT_CLI_ARGS_H
 
+#include "Arm_Lib.h"
+
 #include <string>
 #include <vector>
 
 struct CommonArgs {
     std::string port = "/dev/tty.usbserial-2130";
-    double init_delay = 0.1;
+    double init_delay = 0.0;   // Extra wait after the readiness handshake
+    std::string record_path;   // Capture outgoing frames here (Arm_Options::capture_path)
+    std::string calibration_path; // Calibration profile for Arm_Options::calibration; empty = stock
+    std::string metrics_path;  // Prometheus metrics file (Arm_Options::metrics_path)
 };
 
 /**
- * @brief Parse shared CLI parameters (--port, --init-delay).
+ * @brief Parse shared CLI parameters (--port, --init-delay, --record, --calibration,
+ *        --metrics).
  *        Prints usage and exits when --help is provided.
  */
 CommonArgs parse_common_args(int argc, char* argv[], const std::string& description,
                              std::vector<std::string>* remaining_args = nullptr);
 
+/**
+ * @brief Arm_Options for the shared parameters (--record, --calibration,
+ *        --metrics). Tools set their own switches, such as async_io, afterwards.
+ * @throws std::runtime_error or std::invalid_argument if the calibration profile cannot be loaded.
+ */
+Arm_Options make_arm_options(const CommonArgs& args);
+
 #endif // DOFBOT_CLI_ARGS_H
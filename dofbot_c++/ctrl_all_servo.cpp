@@ -5,6 +5,7 @@
 
 #include "Arm_Lib.h"
 #include "cli_args.h"
+#include "routine.h"
 
 #include <atomic>
 #include <chrono>
@@ -22,12 +23,27 @@ namespace {
         }
     }
 
-    void ctrl_all_servo(Arm_Device& arm, int angle, int move_time_ms) {
-        arm.Arm_serial_servo_write6(angle, 180 - angle, angle, angle, angle, angle, move_time_ms);
-        if (!g_running) {
-            return;
+    void add_sweep_step(Routine& routine, int angle) {
+        routine.pose({{angle, 180 - angle, angle, angle, angle, angle}}, 10).wait(20);
+    }
+
+    // 90 -> 180 once, then 180 -> 0 -> 180 for as long as the demo runs
+    Routine sweep_routine(const CalibrationProfile& calibration) {
+        Routine routine(calibration);
+        routine.echo("Initializing pose...");
+        routine.pose({{90, 90, 90, 90, 90, 90}}, 500).wait(1000);
+        routine.echo("Sweeping servos. Press Ctrl+C to stop.");
+        for (int angle = 91; angle <= 180; ++angle) {
+            add_sweep_step(routine, angle);
+        }
+        routine.loop();
+        for (int angle = 179; angle >= 0; --angle) {
+            add_sweep_step(routine, angle);
         }
-        std::this_thread::sleep_for(std::chrono::milliseconds(move_time_ms));
+        for (int angle = 1; angle <= 180; ++angle) {
+            add_sweep_step(routine, angle);
+        }
+        return routine;
     }
 }
 
@@ -39,37 +55,14 @@ int main(int argc, char* argv[]) {
 
     try {
         const CommonArgs args = parse_common_args(argc, argv, description);
-        Arm_Device arm(args.port);
-
-        std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
-
-        int angle = 90;
-        int dir_state = 1;
-
-        std::cout << "Initializing pose..." << std::endl;
-        arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 500);
-        std::this_thread::sleep_for(std::chrono::seconds(1));
 
-        std::cout << "Sweeping servos. Press Ctrl+C to stop." << std::endl;
-        while (g_running) {
-            if (dir_state == 1) {
-                ++angle;
-                if (angle >= 180) {
-                    dir_state = 0;
-                }
-            } else {
-                --angle;
-                if (angle <= 0) {
-                    dir_state = 1;
-                }
-            }
+        // Only the freshest sweep target matters; never let stale poses queue up
+        Arm_Options options = make_arm_options(args);
+        options.coalesce_motion = true;
+        Arm_Device arm(args.port, options);
 
-            ctrl_all_servo(arm, angle, 10);
-            if (!g_running) {
-                break;
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(10));
-        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
+        RoutineExecutor(arm).run(sweep_routine(arm.Arm_calibration()), &g_running);
 
         std::cout << "\nProgram closed." << std::endl;
     } catch (const std::exception& e) {
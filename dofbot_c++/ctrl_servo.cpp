@@ -24,7 +24,9 @@ namespace {
         "  --angle DEG         Target angle for the selected servo.\n"
         "  --move-time MS      Movement time in milliseconds (default: 800).\n"
         "  --angles S1 S2 S3 S4 S5 S6\n"
-        "                      Command all six servos simultaneously.";
+        "                      Command all six servos simultaneously.\n"
+        "  --low-latency       Tune the port for the fastest feedback replies and\n"
+        "                      report the round trip measured at open.";
 
     const std::array<const char*, 6> kServoNames = {"S1", "S2", "S3", "S4", "S5", "S6"};
 
@@ -34,11 +36,11 @@ namespace {
         }
         return tokens[++index];
     }
-    void validate_single(int servo_id, int angle) {
+    void validate_single(const CalibrationProfile& calibration, int servo_id, int angle) {
         if (servo_id < 1 || servo_id > 6) {
             throw std::runtime_error("Servo ID must be between 1 and 6.");
         }
-        const int max_angle = (servo_id == 5) ? 270 : 180;
+        const int max_angle = calibration.max_angle(servo_id);
         if (angle < 0 || angle > max_angle) {
             std::ostringstream oss;
             oss << "Servo " << servo_id << " angle must be between 0 and " << max_angle << '.';
@@ -46,12 +48,12 @@ namespace {
         }
     }
 
-    void validate_group(const std::array<int, 6>& angles) {
-        const std::array<int, 6> max_angles = {180, 180, 180, 180, 270, 180};
+    void validate_group(const CalibrationProfile& calibration, const std::array<int, 6>& angles) {
         for (size_t idx = 0; idx < angles.size(); ++idx) {
-            if (angles[idx] < 0 || angles[idx] > max_angles[idx]) {
+            const int max_angle = calibration.max_angle(static_cast<int>(idx + 1));
+            if (angles[idx] < 0 || angles[idx] > max_angle) {
                 std::ostringstream oss;
-                oss << "S" << (idx + 1) << " angle must be between 0 and " << max_angles[idx] << '.';
+                oss << "S" << (idx + 1) << " angle must be between 0 and " << max_angle << '.';
                 throw std::runtime_error(oss.str());
             }
         }
@@ -71,6 +73,7 @@ int main(int argc, char* argv[]) {
         int move_time = 800;
         std::array<int, 6> target_angles = {90, 90, 90, 90, 90, 90};
         bool has_group_command = false;
+        bool low_latency = false;
 
         for (size_t i = 0; i < extra_args.size(); ++i) {
             const std::string& token = extra_args[i];
@@ -95,6 +98,8 @@ int main(int argc, char* argv[]) {
                     target_angles[j] = std::stoi(extra_args[++i]);
                 }
                 has_group_command = true;
+            } else if (token == "--low-latency") {
+                low_latency = true;
             } else {
                 std::cerr << "Unrecognized argument: " << token << '\n';
                 return 1;
@@ -115,13 +120,15 @@ int main(int argc, char* argv[]) {
             }
         }
 
-        Arm_Device arm(common.port);
+        Arm_Options options = make_arm_options(common);
+        options.low_latency = low_latency;
+        Arm_Device arm(common.port, options);
         std::this_thread::sleep_for(std::chrono::duration<double>(common.init_delay));
 
         const double wait_seconds = std::max(move_time > 0 ? move_time / 1000.0 : 0.0, 0.1);
 
         if (has_group_command) {
-            validate_group(target_angles);
+            validate_group(arm.Arm_calibration(), target_angles);
             arm.Arm_serial_set_torque(1);
             arm.Arm_serial_servo_write6(
                 target_angles[0],
@@ -134,10 +141,7 @@ int main(int argc, char* argv[]) {
             );
             std::this_thread::sleep_for(std::chrono::duration<double>(wait_seconds));
 
-            std::array<int, 6> feedback{};
-            for (int id = 1; id <= 6; ++id) {
-                feedback[id - 1] = arm.Arm_serial_servo_read(id);
-            }
+            const std::array<int, 6> feedback = arm.Arm_serial_servo_read6().angles;
 
             std::cout << "Commanded angles: ";
             for (size_t idx = 0; idx < target_angles.size(); ++idx) {
@@ -150,7 +154,7 @@ int main(int argc, char* argv[]) {
             std::cout << std::endl;
 
         } else {
-            validate_single(servo_id, angle);
+            validate_single(arm.Arm_calibration(), servo_id, angle);
             const int ping_response = arm.Arm_ping_servo(servo_id);
             std::cout << "Ping response for servo " << servo_id << ": " << ping_response << std::endl;
 
@@ -5,19 +5,91 @@
 
 #include "Arm_Lib.h"
 #include "cli_args.h"
+#include "routine.h"
 
 #include <atomic>
 #include <chrono>
 #include <csignal>
 #include <exception>
 #include <iostream>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace {
-    constexpr int TIME_1 = 500;
-    constexpr int TIME_2 = 1000;
-    constexpr double TIME_SLEEP = 0.5;
-    constexpr double STEP_DELAY = 0.001;
+    const char* kUsageSuffix =
+        "\nAdditional parameters:\n"
+        "  --routine PATH      Play a routine file instead of the built-in dance (format: routine.h).";
+
+    // Joints 2-4 fold through a series of poses, then the wrist and gripper perform.
+    // Moves on one line group used to be sent 1 ms apart; they now share an
+    // instant and go out as a single write6 frame.
+    const char* kDance = R"(
+pose 90 90 90 90 90 90 500
+wait 1000
+loop
+move 2 60 500
+move 3 120 500
+move 4 60 500
+wait 500
+move 2 45 500
+move 3 135 500
+move 4 45 500
+wait 500
+move 2 60 500
+move 3 120 500
+move 4 60 500
+wait 500
+move 2 90 500
+move 3 90 500
+move 4 90 500
+wait 500
+move 2 100 500
+move 3 80 500
+move 4 80 500
+wait 500
+move 2 120 500
+move 3 60 500
+move 4 60 500
+wait 500
+move 2 135 500
+move 3 45 500
+move 4 45 500
+wait 500
+move 2 90 500
+move 3 90 500
+move 4 90 500
+wait 500
+move 4 20 500
+move 6 150 500
+wait 500
+move 4 90 500
+move 6 90 500
+wait 500
+move 4 20 500
+move 6 150 500
+wait 500
+move 4 90 500
+move 6 90 500
+move 1 0 500
+move 5 0 500
+wait 500
+move 3 180 500
+move 4 0 500
+wait 500
+move 6 180 500
+wait 500
+move 6 0 1000
+wait 500
+move 6 90 1000
+move 1 90 500
+move 5 90 500
+wait 500
+move 3 90 500
+move 4 90 500
+wait 500
+echo END OF LINE!
+)";
 
     std::atomic<bool> g_running(true);
 
@@ -26,182 +98,39 @@ namespace {
             g_running = false;
         }
     }
-
-    void sleep_seconds(double seconds) {
-        std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
-    }
-
-    void run_routine(Arm_Device& arm) {
-        arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 500);
-        sleep_seconds(1.0);
-
-        while (g_running) {
-            arm.Arm_serial_servo_write(2, 180 - 120, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 120, TIME_1);
-            if (!g_running) break;
-            sleep_seconds(STEP_DELAY);
-            arm.Arm_serial_servo_write(4, 60, TIME_1);
-            if (!g_running) break;
-            sleep_seconds(TIME_SLEEP);
-
-            arm.Arm_serial_servo_write(2, 180 - 135, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 135, TIME_1);
-            if (!g_running) break;
-            sleep_seconds(STEP_DELAY);
-            arm.Arm_serial_servo_write(4, 45, TIME_1);
-            if (!g_running) break;
-            sleep_seconds(TIME_SLEEP);
-
-            arm.Arm_serial_servo_write(2, 180 - 120, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 120, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 60, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(2, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 90, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(2, 180 - 80, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 80, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 80, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(2, 180 - 60, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 60, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 60, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(2, 180 - 45, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 45, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 45, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(2, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(3, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(4, 20, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(6, 150, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(4, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(6, 90, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(4, 20, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(6, 150, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(4, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(6, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(1, 0, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(5, 0, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(3, 180, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 0, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(6, 180, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(6, 0, TIME_2);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(6, 90, TIME_2);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(1, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(5, 90, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(3, 90, TIME_1);
-            sleep_seconds(STEP_DELAY);
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 90, TIME_1);
-            sleep_seconds(TIME_SLEEP);
-
-            std::cout << "END OF LINE!" << std::endl;
-        }
-    }
 }
 
 int main(int argc, char* argv[]) {
     const std::string description =
-        "Looping dance routine that moves multiple joints for demonstration purposes.";
+        "Looping dance routine that moves multiple joints for demonstration purposes." + std::string(kUsageSuffix);
 
     std::signal(SIGINT, handle_signal);
 
     try {
-        const CommonArgs args = parse_common_args(argc, argv, description);
-        Arm_Device arm(args.port);
+        std::vector<std::string> extra_args;
+        const CommonArgs args = parse_common_args(argc, argv, description, &extra_args);
+
+        std::string routine_path;
+        for (size_t i = 0; i < extra_args.size(); ++i) {
+            const std::string& token = extra_args[i];
+            if (token == "--routine" && i + 1 < extra_args.size()) {
+                routine_path = extra_args[++i];
+            } else if (token.rfind("--routine=", 0) == 0) {
+                routine_path = token.substr(10);
+            } else {
+                std::cerr << "Unrecognized argument: " << token << '\n';
+                return 1;
+            }
+        }
+        const Arm_Options options = make_arm_options(args);
+
+        // Parse before touching the arm so a bad file fails fast
+        const Routine routine = routine_path.empty() ? Routine::parse(kDance, options.calibration)
+                                                     : Routine::load(routine_path, options.calibration);
+        Arm_Device arm(args.port, options);
 
         std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
-        run_routine(arm);
+        RoutineExecutor(arm).run(routine, &g_running);
 
         std::cout << "Program closed." << std::endl;
 
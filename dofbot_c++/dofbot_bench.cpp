@@ -0,0 +1,548 @@
+/**
+ * @file dofbot_bench.cpp
+ * @brief Protocol throughput and latency benchmarks with JSON output.
+ *
+ * Every case is timed in samples of one or more operations; the JSON report
+ * carries per-operation mean and percentiles so runs can be compared over
+ * time. Cases that need a board talk to a SimulatedPort, a LoopbackTransport
+ * or a raw pseudo-terminal preloaded with canned reply frames, so no arm is needed.
+ */
+
+#include "Arm_Lib.h"
+#include "joint_trajectory.h"
+#include "multi_arm.h"
+#include "servo_sim.h"
+#include "trajectory_streamer.h"
+#include "transport.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <exception>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    const char* kUsage =
+        "Benchmark the Dofbot protocol stack against a simulated board.\n\n"
+        "Usage: dofbot_bench [options]\n"
+        "  --out PATH          JSON report path (default: dofbot_bench.json)\n"
+        "  --filter TEXT       Only run cases whose name contains TEXT\n"
+        "  --quick             Fewer samples, for smoke runs in CI\n"
+        "  --help              Show this message and exit\n";
+
+    using Clock = std::chrono::steady_clock;
+
+    // Hides @p value from the optimiser so the work that produced or consumes it stays in the timed loop
+    template <typename T>
+    inline void do_not_optimize(T& value) {
+#if defined(__GNUC__)
+        asm volatile("" : "+m"(value) : : "memory");
+#else
+        volatile T sink = value;
+        (void)sink;
+#endif
+    }
+
+    struct Result {
+        std::string name;
+        std::string group;
+        size_t samples = 0;
+        size_t ops_per_sample = 0;
+        double mean_ns = 0.0;
+        double p50_ns = 0.0;
+        double p90_ns = 0.0;
+        double p99_ns = 0.0;
+        double max_ns = 0.0;
+        double ops_per_second = 0.0;
+        double bytes_per_op = 0.0;
+    };
+
+    struct Options {
+        std::string filter;
+        size_t scale = 10; // Sample count multiplier; --quick sets 1
+    };
+
+    double percentile(const std::vector<double>& sorted, double fraction) {
+        const size_t index = std::min(sorted.size() - 1, static_cast<size_t>(fraction * (sorted.size() - 1) + 0.5));
+        return sorted[index];
+    }
+
+    /**
+     * @brief Times @p samples runs of @p body, each doing @p batch operations.
+     *        @p setup runs before every sample, outside the timed region.
+     */
+    template <typename Setup, typename Body>
+    Result measure(const std::string& group, const std::string& name, size_t samples, size_t batch,
+                   Setup&& setup, Body&& body) {
+        // Warm-up sample: faults in pages, lazily opened streams, caches
+        setup();
+        for (size_t i = 0; i < batch; ++i) {
+            body(i);
+        }
+
+        std::vector<double> per_op(samples);
+        double total_ns = 0.0;
+        for (size_t s = 0; s < samples; ++s) {
+            setup();
+            const auto start = Clock::now();
+            for (size_t i = 0; i < batch; ++i) {
+                body(i);
+            }
+            const double ns = std::chrono::duration<double, std::nano>(Clock::now() - start).count();
+            per_op[s] = ns / batch;
+            total_ns += ns;
+        }
+        std::sort(per_op.begin(), per_op.end());
+
+        Result result;
+        result.group = group;
+        result.name = name;
+        result.samples = samples;
+        result.ops_per_sample = batch;
+        result.mean_ns = total_ns / static_cast<double>(samples * batch);
+        result.p50_ns = percentile(per_op, 0.50);
+        result.p90_ns = percentile(per_op, 0.90);
+        result.p99_ns = percentile(per_op, 0.99);
+        result.max_ns = per_op.back();
+        result.ops_per_second = 1e9 / result.mean_ns;
+        return result;
+    }
+
+    template <typename Body>
+    Result measure(const std::string& group, const std::string& name, size_t samples, size_t batch, Body&& body) {
+        return measure(group, name, samples, batch, [] {}, std::forward<Body>(body));
+    }
+
+    /**
+     * @brief Converts a streamer run into a Result whose per-operation figures
+     *        are per-tick wake-up lateness; percentiles are read off the jitter
+     *        histogram as bucket upper edges.
+     */
+    Result jitter_result(const std::string& group, const std::string& name, const StreamerReport& report,
+                         double elapsed_s) {
+        const auto histogram_percentile = [&report](double fraction) {
+            const double wanted = fraction * static_cast<double>(report.ticks);
+            uint64_t seen = 0;
+            for (size_t i = 0; i + 1 < report.jitter_histogram.size(); ++i) {
+                seen += report.jitter_histogram[i];
+                if (static_cast<double>(seen) >= wanted) {
+                    return std::min(report.max_jitter_us, (i + 1) * report.bucket_width_us) * 1000.0;
+                }
+            }
+            return report.max_jitter_us * 1000.0;
+        };
+        Result result;
+        result.group = group;
+        result.name = name;
+        result.samples = report.ticks;
+        result.ops_per_sample = 1;
+        result.mean_ns = report.mean_jitter_us * 1000.0;
+        result.p50_ns = histogram_percentile(0.50);
+        result.p90_ns = histogram_percentile(0.90);
+        result.p99_ns = histogram_percentile(0.99);
+        result.max_ns = report.max_jitter_us * 1000.0;
+        result.ops_per_second = static_cast<double>(report.ticks) / elapsed_s;
+        return result;
+    }
+
+    // Raw pty pair with no responder: the benchmark writes canned replies itself
+    struct CannedPort {
+        int master_fd = -1;
+        std::string slave_name;
+
+        CannedPort() {
+            master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+            if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0) {
+                throw std::runtime_error("Failed to allocate a pseudo-terminal.");
+            }
+            slave_name = ptsname(master_fd);
+        }
+        ~CannedPort() { close(master_fd); }
+
+        void write_all(const std::vector<uint8_t>& bytes) const {
+            size_t sent = 0;
+            while (sent < bytes.size()) {
+                const ssize_t n = ::write(master_fd, bytes.data() + sent, bytes.size() - sent);
+                if (n <= 0) {
+                    throw std::runtime_error("Failed to preload canned replies.");
+                }
+                sent += static_cast<size_t>(n);
+            }
+        }
+
+        // Discards the requests Arm_Device wrote since the last call
+        void drain() const {
+            uint8_t sink[1024];
+            const int flags = fcntl(master_fd, F_GETFL);
+            fcntl(master_fd, F_SETFL, flags | O_NONBLOCK);
+            while (::read(master_fd, sink, sizeof(sink)) > 0) {
+            }
+            fcntl(master_fd, F_SETFL, flags);
+        }
+    };
+
+    // 0x0A reply for servo @p id, optionally preceded by line noise
+    void append_read_reply(std::vector<uint8_t>& stream, int id, uint16_t pos, bool noisy) {
+        if (noisy) {
+            const uint8_t garbage[] = {0x00, 0xAA, 0xFF, 0x13};
+            stream.insert(stream.end(), garbage, garbage + sizeof(garbage));
+        }
+        const uint8_t data[] = {arm_protocol::high_byte(pos), arm_protocol::low_byte(pos),
+                                static_cast<uint8_t>(arm_protocol::CMD_SERVO_READ_BASE + id)};
+        const uint8_t ext_len = sizeof(data) + 3;
+        unsigned int sum = ext_len + arm_protocol::REPLY_SERVO;
+        stream.push_back(arm_protocol::HEAD);
+        stream.push_back(static_cast<uint8_t>(arm_protocol::DEVICE_ID - 1));
+        stream.push_back(ext_len);
+        stream.push_back(arm_protocol::REPLY_SERVO);
+        for (uint8_t value : data) {
+            stream.push_back(value);
+            sum += value;
+        }
+        stream.push_back(static_cast<uint8_t>(sum & 0xFF));
+    }
+
+    void print_result(const Result& r) {
+        std::printf("%-32s %10.1f ns/op  p50 %10.1f  p99 %10.1f  %12.0f ops/s\n",
+                    r.name.c_str(), r.mean_ns, r.p50_ns, r.p99_ns, r.ops_per_second);
+    }
+
+    std::string json_escape(const std::string& text) {
+        std::string out;
+        for (char c : text) {
+            if (c == '"' || c == '\\') {
+                out += '\\';
+            }
+            out += c;
+        }
+        return out;
+    }
+
+    void write_json(const std::string& path, const std::vector<Result>& results) {
+        std::ofstream out(path);
+        if (!out) {
+            throw std::runtime_error("Failed to create " + path);
+        }
+        char date[32];
+        const std::time_t now = std::time(nullptr);
+        std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+        out << "{\n  \"context\": {\n";
+        out << "    \"date\": \"" << date << "\",\n";
+#if defined(__VERSION__)
+        out << "    \"compiler\": \"" << json_escape(__VERSION__) << "\",\n";
+#endif
+#if defined(__OPTIMIZE__)
+        out << "    \"optimized\": true\n";
+#else
+        out << "    \"optimized\": false\n";
+#endif
+        out << "  },\n  \"benchmarks\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            out << "    {\"name\": \"" << json_escape(r.name) << "\", \"group\": \"" << r.group << "\""
+                << ", \"samples\": " << r.samples << ", \"ops_per_sample\": " << r.ops_per_sample
+                << ", \"mean_ns\": " << r.mean_ns << ", \"p50_ns\": " << r.p50_ns
+                << ", \"p90_ns\": " << r.p90_ns << ", \"p99_ns\": " << r.p99_ns
+                << ", \"max_ns\": " << r.max_ns << ", \"ops_per_second\": " << r.ops_per_second;
+            if (r.bytes_per_op > 0.0) {
+                out << ", \"bytes_per_second\": " << r.bytes_per_op * r.ops_per_second;
+            }
+            out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        out << "  ]\n}\n";
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        Options options;
+        std::string out_path = "dofbot_bench.json";
+        for (size_t i = 0; i < args.size(); ++i) {
+            if (args[i] == "--help" || args[i] == "-h") {
+                std::cout << kUsage;
+                return 0;
+            } else if (args[i] == "--out" && i + 1 < args.size()) {
+                out_path = args[++i];
+            } else if (args[i] == "--filter" && i + 1 < args.size()) {
+                options.filter = args[++i];
+            } else if (args[i] == "--quick") {
+                options.scale = 1;
+            } else {
+                std::cerr << "Unrecognized argument: " << args[i] << "\n\n" << kUsage;
+                return 1;
+            }
+        }
+
+        std::vector<Result> results;
+        const auto wanted = [&](const std::string& name) {
+            return options.filter.empty() || name.find(options.filter) != std::string::npos;
+        };
+        const auto record = [&](Result result) {
+            print_result(result);
+            results.push_back(std::move(result));
+        };
+        const size_t micro_samples = 100 * options.scale;
+        const size_t micro_batch = 1000;
+
+        // --- Encoding: one frame per operation, inputs laundered so nothing folds ---
+        uint16_t pos = 2000;
+        uint16_t time_ms = 500;
+        if (wanted("encode_servo_write6")) {
+            record(measure("encode", "encode_servo_write6", micro_samples, micro_batch, [&](size_t) {
+                do_not_optimize(pos);
+                auto frame = arm_protocol::encode_servo_write6(pos, pos, pos, pos, pos, pos, time_ms);
+                do_not_optimize(frame);
+            }));
+        }
+        if (wanted("encode_servo_write")) {
+            record(measure("encode", "encode_servo_write", micro_samples, micro_batch, [&](size_t i) {
+                do_not_optimize(pos);
+                auto frame = arm_protocol::encode_servo_write(static_cast<uint8_t>(1 + i % 6), pos, time_ms);
+                do_not_optimize(frame);
+            }));
+        }
+        if (wanted("encode_servo_read")) {
+            record(measure("encode", "encode_servo_read", micro_samples, micro_batch, [&](size_t i) {
+                auto frame = arm_protocol::encode_servo_read(static_cast<uint8_t>(1 + i % 6));
+                do_not_optimize(frame);
+            }));
+        }
+        if (wanted("encode_torque")) {
+            record(measure("encode", "encode_torque", micro_samples, micro_batch, [&](size_t i) {
+                auto frame = arm_protocol::encode_torque((i & 1) != 0);
+                do_not_optimize(frame);
+            }));
+        }
+        if (wanted("encode_ping")) {
+            record(measure("encode", "encode_ping", micro_samples, micro_batch, [&](size_t i) {
+                auto frame = arm_protocol::encode_ping(static_cast<uint8_t>(1 + i % 6));
+                do_not_optimize(frame);
+            }));
+        }
+        if (wanted("encode_buzzer")) {
+            record(measure("encode", "encode_buzzer", micro_samples, micro_batch, [&](size_t i) {
+                auto frame = arm_protocol::encode_buzzer(static_cast<uint8_t>(i));
+                do_not_optimize(frame);
+            }));
+        }
+
+        // --- Checksum over the longest frame body ---
+        if (wanted("checksum_18_bytes")) {
+            uint8_t body[arm_protocol::MAX_FRAME_SIZE - 1] = {};
+            for (size_t i = 0; i < sizeof(body); ++i) {
+                body[i] = static_cast<uint8_t>(i * 37);
+            }
+            Result r = measure("checksum", "checksum_18_bytes", micro_samples, micro_batch, [&](size_t) {
+                uint8_t* data = body;
+                do_not_optimize(data);
+                uint8_t sum = arm_protocol::checksum(data, sizeof(body));
+                do_not_optimize(sum);
+            });
+            r.bytes_per_op = sizeof(body);
+            record(r);
+        }
+
+        // --- Reply decoding in memory: no syscalls, just the frame parser ---
+        for (const bool noisy : {false, true}) {
+            const std::string name = noisy ? "decode_stream_noisy" : "decode_stream_clean";
+            if (!wanted(name)) {
+                continue;
+            }
+            constexpr size_t kFramesPerChunk = 32;
+            std::vector<uint8_t> stream;
+            for (size_t i = 0; i < kFramesPerChunk; ++i) {
+                append_read_reply(stream, static_cast<int>(1 + i % 6), static_cast<uint16_t>(900 + 50 * i), noisy);
+            }
+            arm_protocol::FrameDecoder decoder;
+            Result r = measure("parse", name, micro_samples, kFramesPerChunk,
+                               [&] {
+                                   decoder.reset();
+                                   std::memcpy(decoder.write_ptr(), stream.data(), stream.size());
+                                   decoder.commit(stream.size());
+                               },
+                               [&](size_t) {
+                                   uint8_t type = 0;
+                                   arm_protocol::PayloadView payload;
+                                   bool found = decoder.next(type, payload);
+                                   do_not_optimize(found);
+                                   do_not_optimize(payload);
+                               });
+            r.bytes_per_op = static_cast<double>(stream.size()) / kFramesPerChunk;
+            record(r);
+        }
+
+        // --- Reply parsing: replies are already queued, so a read is request write + parse ---
+        for (const bool noisy : {false, true}) {
+            const std::string name = noisy ? "parse_read_reply_noisy" : "parse_read_reply_clean";
+            if (!wanted(name)) {
+                continue;
+            }
+            CannedPort port;
+            Arm_Options arm_options;
+            arm_options.ready_timeout_ms = 0;   // Nothing answers the handshake
+            Arm_Device arm(port.slave_name, arm_options);
+            constexpr size_t kRepliesPerSample = 32;
+            std::vector<uint8_t> stream;
+            for (size_t i = 0; i < kRepliesPerSample; ++i) {
+                append_read_reply(stream, 1, static_cast<uint16_t>(900 + 50 * i), noisy);
+            }
+            Result r = measure("parse", name, 20 * options.scale, kRepliesPerSample,
+                               [&] {
+                                   port.drain();
+                                   port.write_all(stream);
+                               },
+                               [&](size_t) {
+                                   int angle = arm.Arm_serial_servo_read(1);
+                                   do_not_optimize(angle);
+                               });
+            r.bytes_per_op = static_cast<double>(stream.size()) / kRepliesPerSample;
+            record(r);
+        }
+
+        // --- Round trips against the simulator, one operation per sample ---
+        if (wanted("roundtrip_ping") || wanted("roundtrip_servo_read") || wanted("roundtrip_servo_read6")) {
+            SimulatedPort port;
+            Arm_Device arm(port.path());
+            const size_t samples = 100 * options.scale;
+            if (wanted("roundtrip_ping")) {
+                record(measure("roundtrip", "roundtrip_ping", samples, 1, [&](size_t) {
+                    int reply = arm.Arm_ping_servo(1);
+                    do_not_optimize(reply);
+                }));
+            }
+            if (wanted("roundtrip_servo_read")) {
+                record(measure("roundtrip", "roundtrip_servo_read", samples, 1, [&](size_t) {
+                    int angle = arm.Arm_serial_servo_read(3);
+                    do_not_optimize(angle);
+                }));
+            }
+            if (wanted("roundtrip_servo_read6")) {
+                record(measure("roundtrip", "roundtrip_servo_read6", samples, 1, [&](size_t) {
+                    Arm_ServoReadings readings = arm.Arm_serial_servo_read6();
+                    do_not_optimize(readings);
+                }));
+            }
+        }
+
+        // --- Sustained write6: back-to-back commands drained by the simulator ---
+        for (const bool async : {false, true}) {
+            const std::string name = async ? "sustained_write6_async" : "sustained_write6";
+            if (!wanted(name)) {
+                continue;
+            }
+            SimulatedPort port;
+            Arm_Options arm_options;
+            arm_options.async_io = async;
+            arm_options.queue_capacity = 4096;
+            Arm_Device arm(port.path(), arm_options);
+            Result r = measure("write", name, 20 * options.scale, 500,
+                               [&] { arm.Arm_flush(); },
+                               [&](size_t i) {
+                                   const int angle = 60 + static_cast<int>(i % 60);
+                                   arm.Arm_serial_servo_write6(angle, angle, angle, angle, angle, angle, 20);
+                               });
+            arm.Arm_flush();
+            r.bytes_per_op = arm_protocol::encode_servo_write6(0, 0, 0, 0, 0, 0, 0).size();
+            record(r);
+        }
+
+        // --- Motion cycles on the in-process loopback: no syscalls, virtual time ---
+        if (wanted("loopback_motion_cycle")) {
+            LoopbackTransport* loopback = new LoopbackTransport();
+            Arm_Device arm{std::unique_ptr<Transport>(loopback)};
+            record(measure("loopback", "loopback_motion_cycle", 20 * options.scale, 100, [&](size_t i) {
+                const int angle = 60 + static_cast<int>(i % 60);
+                arm.Arm_serial_servo_write6(angle, angle, angle, angle, angle, angle, 20);
+                loopback->advance(std::chrono::milliseconds(20));
+                Arm_ServoReadings readings = arm.Arm_serial_servo_read6();
+                do_not_optimize(readings);
+            }));
+        }
+
+        // --- Fixed-rate streaming on the loopback: figures are wake-up lateness, not cost ---
+        for (const bool precomputed : {false, true}) {
+            const std::string name = precomputed ? "loopback_stream_table" : "loopback_stream_polynomial";
+            if (!wanted(name)) {
+                continue;
+            }
+            LoopbackTransport* loopback = new LoopbackTransport();
+            Arm_Device arm{std::unique_ptr<Transport>(loopback)};
+            std::vector<Waypoint> waypoints(4);
+            waypoints[0].angles = {90.0, 90.0, 90.0, 90.0, 90.0, 90.0};
+            waypoints[1].angles = {45.0, 60.0, 120.0, 70.0, 200.0, 120.0};
+            waypoints[2].angles = {135.0, 120.0, 60.0, 110.0, 70.0, 150.0};
+            waypoints[3].angles = waypoints[0].angles;
+            const InterpolatedTrajectory trajectory(waypoints, InterpolationMode::Quintic, JointLimits(),
+                                                    arm.Arm_calibration());
+
+            StreamerOptions stream_options;
+            stream_options.rate_hz = 200.0;
+            const SampleTable table = trajectory.precompute(stream_options.rate_hz);
+            const JointTrajectory source = precomputed ? table.streamer_source() : trajectory.streamer_source();
+            // Repeat the move until half a second per --quick unit has been streamed
+            const double total_s = 0.5 * static_cast<double>(options.scale);
+            const double period_s = trajectory.duration();
+            const JointTrajectory looped = [&](double t, std::array<double, 6>& pose) {
+                return t < total_s && source(std::fmod(t, period_s), pose);
+            };
+
+            const auto start = Clock::now();
+            const StreamerReport report = TrajectoryStreamer(arm, stream_options).play(looped);
+            const double elapsed_s = std::chrono::duration<double>(Clock::now() - start).count();
+            if (report.missed_deadlines > 0) {
+                std::cerr << name << ": " << report.missed_deadlines << " deadlines missed" << std::endl;
+            }
+            Result r = jitter_result("stream", name, report, elapsed_s);
+            r.bytes_per_op = arm_protocol::encode_servo_write6(0, 0, 0, 0, 0, 0, 0).size();
+            record(r);
+        }
+
+        // --- Synchronised group moves: one event loop driving several simulated boards ---
+        if (wanted("multi_arm_group_write6")) {
+            constexpr size_t kArms = 8;
+            std::vector<std::unique_ptr<SimulatedPort>> boards;
+            std::vector<std::string> paths;
+            for (size_t i = 0; i < kArms; ++i) {
+                boards.emplace_back(new SimulatedPort());
+                paths.push_back(boards.back()->path());
+            }
+            MultiArmController controller(paths);
+            std::vector<GroupTarget> targets(kArms);
+            size_t missed = 0;
+            Result r = measure("multi_arm", "multi_arm_group_write6", 20 * options.scale, 100,
+                               [&] { controller.flush(); },
+                               [&](size_t i) {
+                                   for (size_t a = 0; a < kArms; ++a) {
+                                       targets[a].arm = a;
+                                       targets[a].angles.fill(60 + static_cast<int>((i + a) % 60));
+                                   }
+                                   missed += controller.group_write6(targets, 20).size();
+                               });
+            controller.flush();
+            if (missed > 0) {
+                std::cerr << "multi_arm_group_write6: " << missed << " arm frames missed their tick" << std::endl;
+            }
+            r.bytes_per_op = static_cast<double>(kArms * arm_protocol::encode_servo_write6(0, 0, 0, 0, 0, 0, 0).size());
+            record(r);
+        }
+
+        write_json(out_path, results);
+        std::cout << "Wrote " << results.size() << " results to " << out_path << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,104 @@
+/**
+ * @file dofbot_replay.cpp
+ * @brief Replays a capture recorded with --record, optionally time-scaled.
+ */
+
+#include "motion_capture.h"
+#include "serial_port.h"
+
+#include <atomic>
+#include <csignal>
+#include <exception>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    const char* kUsage =
+        "Re-send the frames of a capture file with their recorded timing.\n\n"
+        "Usage: dofbot_replay CAPTURE --port PATH [options]\n"
+        "  --port PATH         Serial device to replay to (required)\n"
+        "  --speed X           Playback speed factor, e.g. 10 for 10x (default: 1)\n"
+        "  --keep-move-time    Send move times as recorded instead of dividing them by the speed\n"
+        "  --include-queries   Also resend servo reads and pings (skipped by default)\n"
+        "  --help              Show this message and exit\n";
+
+    std::atomic<bool> g_running(true);
+
+    void handle_signal(int signum) {
+        if (signum == SIGINT || signum == SIGTERM) {
+            g_running = false;
+        }
+    }
+
+    const std::string& expect_value(const std::vector<std::string>& tokens, size_t& index) {
+        if (index + 1 >= tokens.size()) {
+            throw std::runtime_error("Missing value for argument: " + tokens[index]);
+        }
+        return tokens[++index];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        std::string capture_path;
+        std::string port;
+        ReplayOptions options;
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& token = args[i];
+            if (token == "--help" || token == "-h") {
+                std::cout << kUsage;
+                return 0;
+            } else if (token == "--port") {
+                port = expect_value(args, i);
+            } else if (token == "--speed") {
+                options.speed = std::stod(expect_value(args, i));
+            } else if (token == "--keep-move-time") {
+                options.scale_move_time = false;
+            } else if (token == "--include-queries") {
+                options.include_queries = true;
+            } else if (capture_path.empty() && token.rfind("--", 0) != 0) {
+                capture_path = token;
+            } else {
+                std::cerr << "Unrecognized argument: " << token << "\n\n" << kUsage;
+                return 1;
+            }
+        }
+        if (capture_path.empty() || port.empty()) {
+            std::cerr << kUsage;
+            return 1;
+        }
+
+        const FrameCapture capture = FrameCapture::load(capture_path);
+        std::cout << "Loaded " << capture.frames().size() << " frames spanning " << std::fixed
+                  << std::setprecision(3) << capture.duration_ns() * 1e-9 << " s; replaying at "
+                  << options.speed << "x." << std::endl;
+
+        const int fd = open_serial_port(port);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+
+        ReplayReport report;
+        try {
+            report = replay_capture(fd, capture, options, &g_running);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+        close(fd);
+
+        std::cout << (g_running ? "Replayed " : "Stopped after ") << report.frames_sent << " frames ("
+                  << report.frames_skipped << " queries skipped); lateness mean "
+                  << std::setprecision(1) << report.mean_lateness_us << " us, max "
+                  << report.max_lateness_us << " us." << std::endl;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
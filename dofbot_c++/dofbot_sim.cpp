@@ -0,0 +1,144 @@
+/**
+ * @file dofbot_sim.cpp
+ * @brief Simulated DOFBOT on a pseudo-terminal, for running demos without the arm.
+ *
+ * Prints the slave device path (and optionally symlinks it to a fixed name);
+ * point any demo at it with --port. Replies are held back by --latency-ms and
+ * both directions pass through the drop/corruption model of ServoSimulator.
+ */
+
+#include "servo_sim.h"
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    const char* kUsage =
+        "Simulate a DOFBOT expansion board on a pseudo-terminal.\n\n"
+        "Usage: dofbot_sim [options]\n"
+        "  --latency-ms MS     Delay before each reply is sent (default: 0)\n"
+        "  --drop-rate P       Probability each byte is lost, 0-1 (default: 0)\n"
+        "  --corrupt-rate P    Probability each byte has a bit flipped, 0-1 (default: 0)\n"
+        "  --seed N            Seed for the fault generator (default: 1)\n"
+        "  --link PATH         Also expose the device as a symlink at PATH\n"
+        "  --verbose           Print the servo positions whenever new commands arrive\n"
+        "  --help              Show this message and exit\n";
+
+    std::atomic<bool> g_running(true);
+
+    void handle_signal(int signum) {
+        if (signum == SIGINT || signum == SIGTERM) {
+            g_running = false;
+        }
+    }
+
+    const std::string& expect_value(const std::vector<std::string>& tokens, size_t& index) {
+        if (index + 1 >= tokens.size()) {
+            throw std::runtime_error("Missing value for argument: " + tokens[index]);
+        }
+        return tokens[++index];
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        SimulatorOptions options;
+        std::string link_path;
+        bool verbose = false;
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& token = args[i];
+            if (token == "--help" || token == "-h") {
+                std::cout << kUsage;
+                return 0;
+            } else if (token == "--latency-ms") {
+                options.latency_ms = std::stod(expect_value(args, i));
+            } else if (token == "--drop-rate") {
+                options.drop_rate = std::stod(expect_value(args, i));
+            } else if (token == "--corrupt-rate") {
+                options.corrupt_rate = std::stod(expect_value(args, i));
+            } else if (token == "--seed") {
+                options.seed = static_cast<uint32_t>(std::stoul(expect_value(args, i)));
+            } else if (token == "--link") {
+                link_path = expect_value(args, i);
+            } else if (token == "--verbose") {
+                verbose = true;
+            } else {
+                std::cerr << "Unrecognized argument: " << token << "\n\n" << kUsage;
+                return 1;
+            }
+        }
+        if (options.latency_ms < 0.0 || options.drop_rate < 0.0 || options.drop_rate > 1.0 ||
+            options.corrupt_rate < 0.0 || options.corrupt_rate > 1.0) {
+            throw std::runtime_error("Latency must be >= 0 and rates between 0 and 1.");
+        }
+
+        SimulatedPort port(options);
+
+        if (!link_path.empty()) {
+            unlink(link_path.c_str());
+            if (symlink(port.path().c_str(), link_path.c_str()) != 0) {
+                throw std::runtime_error("Failed to create " + link_path + ": " + strerror(errno));
+            }
+        }
+
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::cout << "Simulated DOFBOT on " << port.path();
+        if (!link_path.empty()) {
+            std::cout << " (" << link_path << ")";
+        }
+        std::cout << "\nRun a demo with --port " << (link_path.empty() ? port.path() : link_path)
+                  << "; Ctrl+C to stop." << std::endl;
+
+        uint64_t last_frames = 0;
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            if (!verbose) {
+                continue;
+            }
+            port.inspect([&](const ServoSimulator& simulator) {
+                const SimulatorStats& stats = simulator.stats();
+                if (stats.frames == last_frames) {
+                    return;
+                }
+                last_frames = stats.frames;
+                const double now = std::chrono::duration<double>(
+                    std::chrono::steady_clock::now().time_since_epoch()).count();
+                std::cout << "frames=" << stats.frames << " replies=" << stats.replies
+                          << " bad_checksums=" << stats.bad_checksums
+                          << " torque=" << simulator.torque_enabled() << " pos=";
+                for (int id = 1; id <= 6; ++id) {
+                    std::cout << simulator.position(id, now) << (id < 6 ? "," : "\n");
+                }
+                std::cout.flush();
+            });
+        }
+
+        port.inspect([](const ServoSimulator& simulator) {
+            const SimulatorStats& stats = simulator.stats();
+            std::cout << "\nExecuted " << stats.frames << " frames, sent " << stats.replies
+                      << " replies, rejected " << stats.bad_checksums << " bad checksums; dropped "
+                      << stats.dropped_bytes << " and corrupted " << stats.corrupted_bytes << " bytes."
+                      << std::endl;
+        });
+        if (!link_path.empty()) {
+            unlink(link_path.c_str());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,270 @@
+/**
+ * @file dofbot_tests.cpp
+ * @brief Regression tests run by ctest; no board or pseudo-terminal needed.
+ *
+ * Covers the pieces that are easy to break silently: reply framing after
+ * line noise, the order in which queued commands reach the wire, the
+ * angle/count mapping and the kinematics round trip. Arm_Device cases run on
+ * a LoopbackTransport. Each test prints one line and the exit status is the
+ * number of failed checks.
+ */
+
+#include "Arm_Lib.h"
+#include "calibration.h"
+#include "frame_decoder.h"
+#include "kinematics.h"
+#include "transport.h"
+
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    int g_failures = 0;
+    std::ostringstream g_log; // Messages of the test that is running
+
+#define CHECK(condition)                                                                  \
+    do {                                                                                  \
+        if (!(condition)) {                                                               \
+            ++g_failures;                                                                 \
+            g_log << "  " << __FILE__ << ":" << __LINE__ << ": CHECK(" #condition ") failed\n"; \
+        }                                                                                 \
+    } while (0)
+
+    void run(const char* name, const std::function<void()>& test) {
+        const int before = g_failures;
+        g_log.str("");
+        try {
+            test();
+        } catch (const std::exception& e) {
+            ++g_failures;
+            g_log << "  unexpected exception: " << e.what() << "\n";
+        }
+        std::cout << (g_failures == before ? "PASS " : "FAIL ") << name << "\n" << g_log.str();
+    }
+
+    // Board reply as the firmware frames it: 0xFF 0xFB <len> <type> <data...> <sum>
+    std::vector<uint8_t> reply_frame(uint8_t type, const std::vector<uint8_t>& data) {
+        const uint8_t len = static_cast<uint8_t>(data.size() + 3);
+        std::vector<uint8_t> frame = {arm_protocol::HEAD, 0xFB, len, type};
+        unsigned int sum = len + type;
+        for (uint8_t byte : data) {
+            frame.push_back(byte);
+            sum += byte;
+        }
+        frame.push_back(static_cast<uint8_t>(sum & 0xFF));
+        return frame;
+    }
+
+    struct Decoded {
+        uint8_t type;
+        std::vector<uint8_t> payload;
+    };
+
+    // Feeds @p stream to a decoder @p chunk bytes at a time and collects every frame
+    std::vector<Decoded> decode(const std::vector<uint8_t>& stream, std::size_t chunk,
+                                arm_protocol::FrameDecoder& decoder) {
+        std::vector<Decoded> frames;
+        for (std::size_t offset = 0; offset < stream.size(); offset += chunk) {
+            const std::size_t n = std::min(chunk, stream.size() - offset);
+            std::memcpy(decoder.write_ptr(), stream.data() + offset, n);
+            decoder.commit(n);
+            uint8_t type = 0;
+            arm_protocol::PayloadView payload;
+            while (decoder.next(type, payload)) {
+                frames.push_back({type, std::vector<uint8_t>(payload.data, payload.data + payload.size)});
+            }
+        }
+        return frames;
+    }
+
+    void test_decoder_resync() {
+        const std::vector<uint8_t> first = reply_frame(arm_protocol::REPLY_SERVO, {0x07, 0xD0, 0x31});
+        const std::vector<uint8_t> second = reply_frame(arm_protocol::CMD_PING, {0xDA});
+        std::vector<uint8_t> corrupt = reply_frame(arm_protocol::REPLY_SERVO, {0x01, 0x02, 0x33});
+        corrupt.back() ^= 0x40;
+
+        // Noise with a lone header byte, a good frame, a frame with a bad
+        // checksum, a truncated header and another good frame
+        std::vector<uint8_t> stream = {0x00, 0x13, arm_protocol::HEAD, 0x42, 0x99};
+        stream.insert(stream.end(), first.begin(), first.end());
+        stream.insert(stream.end(), corrupt.begin(), corrupt.end());
+        stream.push_back(arm_protocol::HEAD);
+        stream.insert(stream.end(), second.begin(), second.end());
+
+        for (const std::size_t chunk : {stream.size(), std::size_t(1), std::size_t(5)}) {
+            arm_protocol::FrameDecoder decoder;
+            const std::vector<Decoded> frames = decode(stream, chunk, decoder);
+            CHECK(frames.size() == 2);
+            if (frames.size() != 2) {
+                continue;
+            }
+            CHECK(frames[0].type == arm_protocol::REPLY_SERVO);
+            CHECK((frames[0].payload == std::vector<uint8_t>{0x07, 0xD0, 0x31}));
+            CHECK(frames[1].type == arm_protocol::CMD_PING);
+            CHECK((frames[1].payload == std::vector<uint8_t>{0xDA}));
+            CHECK(decoder.checksum_errors() == 1);
+        }
+    }
+
+    // Loopback whose writes take a while and are recorded frame by frame, so
+    // commands pile up behind the I/O thread the way they do on a real port
+    class RecordingLoopback : public LoopbackTransport {
+    public:
+        explicit RecordingLoopback(std::vector<std::vector<uint8_t>>& frames) : frames(frames) {}
+
+        std::size_t write(const uint8_t* data, std::size_t len) override {
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+            for (std::size_t i = 0; i + 3 < len; i += data[i + 2] + 2u) {
+                frames.emplace_back(data + i, data + std::min(len, i + data[i + 2] + 2u));
+            }
+            return LoopbackTransport::write(data, len);
+        }
+
+    private:
+        std::vector<std::vector<uint8_t>>& frames;
+    };
+
+    bool is_motion(const std::vector<uint8_t>& frame) {
+        const uint8_t cmd = frame[3];
+        return cmd == arm_protocol::CMD_SERVO_WRITE6 ||
+               (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6);
+    }
+
+    // Position a motion frame sends to servo 1 (a write6 carries all six)
+    uint16_t servo1_position(const std::vector<uint8_t>& frame) {
+        return static_cast<uint16_t>((frame[4] << 8) | frame[5]);
+    }
+
+    void test_command_ordering() {
+        const auto pose = [](Arm_Device& arm, int angle) {
+            arm.Arm_serial_servo_write6(angle, angle, angle, angle, angle, angle, 100);
+        };
+        const auto position = [](int angle) { return DEFAULT_CALIBRATION.angle_to_position(1, angle); };
+
+        // Coalesced, then plain async with a queue small enough to overflow into the motion slots
+        for (const bool coalesce : {true, false}) {
+            std::vector<std::vector<uint8_t>> frames;
+            RecordingLoopback* loopback = new RecordingLoopback(frames);
+            Arm_Options options;
+            options.coalesce_motion = coalesce;
+            options.queue_capacity = 4;
+            {
+                Arm_Device arm{std::unique_ptr<Transport>(loopback), options};
+                frames.clear(); // Handshake
+                for (int angle = 10; angle <= 40; ++angle) {
+                    pose(arm, angle);
+                }
+                arm.Arm_Buzzer_On(3);
+                for (int angle = 50; angle <= 80; ++angle) {
+                    pose(arm, angle);
+                }
+                arm.Arm_serial_servo_read(1);
+                // Torque off may discard targets still waiting, but never precedes one it lets through
+                pose(arm, 90);
+                arm.Arm_serial_set_torque(0);
+                arm.Arm_flush();
+                loopback->inspect([](const ServoSimulator& sim, double) { CHECK(!sim.torque_enabled()); });
+            }
+
+            // The newest target before a buzzer or read reaches the wire before it,
+            // and motion never overtakes itself or anything queued after it
+            std::size_t buzzer = frames.size();
+            std::size_t read = frames.size();
+            std::size_t torque = frames.size();
+            uint16_t last = 0;
+            for (std::size_t i = 0; i < frames.size(); ++i) {
+                const uint8_t cmd = frames[i][3];
+                if (cmd == arm_protocol::CMD_BUZZER) {
+                    buzzer = std::min(buzzer, i);
+                } else if (cmd == arm_protocol::CMD_SERVO_READ_BASE + 1) {
+                    read = std::min(read, i);
+                } else if (cmd == arm_protocol::CMD_TORQUE) {
+                    torque = i;
+                } else if (is_motion(frames[i])) {
+                    CHECK(servo1_position(frames[i]) >= last);
+                    last = servo1_position(frames[i]);
+                }
+            }
+            CHECK(buzzer > 0 && buzzer < read && read < torque && torque == frames.size() - 1);
+            if (!(buzzer > 0 && buzzer < read && read < torque && torque < frames.size())) {
+                continue;
+            }
+            CHECK(is_motion(frames[buzzer - 1]) && servo1_position(frames[buzzer - 1]) == position(40));
+            CHECK(is_motion(frames[read - 1]) && servo1_position(frames[read - 1]) == position(80));
+            for (std::size_t i = buzzer + 1; i < read; ++i) {
+                CHECK(is_motion(frames[i]) && servo1_position(frames[i]) >= position(50));
+            }
+        }
+    }
+
+    void test_calibration_round_trip() {
+        const CalibrationProfile trimmed = CalibrationProfile::parse(
+            "joint 2 1200 2800 150 mirrored 40\n"
+            "offset 1 -25\n");
+        for (const CalibrationProfile* profile : {&DEFAULT_CALIBRATION, &trimmed}) {
+            for (int id = 1; id <= 6; ++id) {
+                for (int angle = 0; angle <= profile->max_angle(id); ++angle) {
+                    const uint16_t pos = profile->angle_to_position(id, angle);
+                    CHECK(pos >= profile->min_position(id) && pos <= profile->max_position(id));
+                    CHECK(profile->position_to_angle(id, pos) == angle);
+                    CHECK(std::fabs(profile->position_to_angle_precise(id, pos) - angle) < 0.5);
+                    // Whole and fractional angles map to the same count
+                    CHECK(profile->angle_to_position(id, static_cast<double>(angle)) == pos);
+                }
+            }
+        }
+        CHECK(trimmed.max_angle(2) == 150);
+        CHECK(!trimmed.contains(2, 151.0));
+    }
+
+    void test_kinematics_round_trip() {
+        const DofbotKinematics kinematics;
+        std::mt19937 rng(21);
+        std::uniform_real_distribution<double> unit(0.0, 1.0);
+        const std::array<double, 6>& limits = kinematics.max_angles();
+
+        int solved = 0;
+        for (int i = 0; i < 2000; ++i) {
+            std::array<double, 6> joints{};
+            for (int j = 0; j < 6; ++j) {
+                joints[j] = unit(rng) * limits[j];
+            }
+            const CartesianPose target = kinematics.forward(joints);
+            std::array<double, 6> solution = {0.0, 0.0, 0.0, 0.0, 0.0, joints[5]};
+            if (!kinematics.inverse(target, solution)) {
+                continue; // Poses whose other elbow branch is out of range
+            }
+            ++solved;
+            CHECK(kinematics.within_limits(solution));
+            const CartesianPose reached = kinematics.forward(solution);
+            const double error = std::hypot(std::hypot(reached.x - target.x, reached.y - target.y),
+                                            reached.z - target.z);
+            CHECK(error < 1e-6);
+            CHECK(std::fabs(reached.pitch - target.pitch) < 1e-4);
+            CHECK(std::fabs(solution[5] - joints[5]) < 1e-9);
+        }
+        // Forward of an in-range pose is nearly always solvable
+        CHECK(solved > 1800);
+    }
+}
+
+int main() {
+    run("decoder_resync", test_decoder_resync);
+    run("command_ordering", test_command_ordering);
+    run("calibration_round_trip", test_calibration_round_trip);
+    run("kinematics_round_trip", test_kinematics_round_trip);
+
+    if (g_failures > 0) {
+        std::cout << g_failures << " check(s) failed" << std::endl;
+    }
+    return g_failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,98 @@
+/**
+ * @file dofbotctl.cpp
+ * @brief One-shot command-line client for dofbotd, for shell scripts.
+ *
+ * Sends one request line to the daemon and prints the reply values; "pose"
+ * reads the shared-memory status instead and never touches the socket.
+ */
+
+#include "arm_daemon.h"
+
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    const char* kUsage =
+        "Send one command to dofbotd.\n\n"
+        "Usage: dofbotctl [options] COMMAND [ARGS...]\n"
+        "  --socket PATH       Daemon socket (default: /tmp/dofbotd.sock)\n"
+        "  --shm NAME          Daemon shared-memory segment, for pose (default: /dofbotd)\n"
+        "  --help              Show this message and exit\n\n"
+        "Commands: ping ID | write ID ANGLE TIME | write6 A1..A6 TIME | read ID | read6\n"
+        "          torque on|off | buzzer [DELAY|off] | status | pose\n";
+
+    const std::string& expect_value(const std::vector<std::string>& tokens, size_t& index) {
+        if (index + 1 >= tokens.size()) {
+            throw std::runtime_error("Missing value for argument: " + tokens[index]);
+        }
+        return tokens[++index];
+    }
+
+    void print_pose(const char* label, const std::array<double, 6>& angles, int64_t at_ns) {
+        std::cout << label;
+        for (double angle : angles) {
+            std::cout << ' ' << angle;
+        }
+        if (at_ns != 0) {
+            const auto now = std::chrono::steady_clock::now().time_since_epoch();
+            std::cout << "  (" << std::chrono::duration<double>(now - std::chrono::nanoseconds(at_ns)).count()
+                      << " s ago)";
+        }
+        std::cout << '\n';
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        std::string socket_path = DAEMON_SOCKET_PATH;
+        std::string shm_name = DAEMON_SHM_NAME;
+        std::string line;
+
+        size_t i = 0;
+        for (; i < args.size() && args[i].rfind("--", 0) == 0; ++i) {
+            if (args[i] == "--help" || args[i] == "-h") {
+                std::cout << kUsage;
+                return 0;
+            } else if (args[i] == "--socket") {
+                socket_path = expect_value(args, i);
+            } else if (args[i] == "--shm") {
+                shm_name = expect_value(args, i);
+            } else {
+                std::cerr << "Unrecognized argument: " << args[i] << "\n\n" << kUsage;
+                return 1;
+            }
+        }
+        for (; i < args.size(); ++i) {
+            line += (line.empty() ? "" : " ") + args[i];
+        }
+        if (line.empty()) {
+            std::cerr << kUsage;
+            return 1;
+        }
+
+        if (line == "pose") {
+            const ArmPose pose = SharedPoseReader(daemon_pose_shm_name(shm_name)).read();
+            print_pose("commanded", pose.commanded, pose.commanded_ns);
+            print_pose("measured ", pose.measured, pose.measured_ns);
+            const DaemonStatus status = DaemonStatusReader(shm_name).read();
+            std::cout << "torque " << status.torque << ", " << status.clients << " clients, "
+                      << status.requests << " requests, " << status.polls << " polls\n";
+            return 0;
+        }
+
+        DaemonClient client(socket_path);
+        const std::string reply = client.request(line);
+        if (!reply.empty()) {
+            std::cout << reply << '\n';
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,91 @@
+/**
+ * @file dofbotd.cpp
+ * @brief Daemon that keeps the arm's serial port open and serves local clients.
+ *
+ * Start it once; dofbotctl, scripts and programs using DaemonClient then send
+ * commands over its Unix socket without paying the port setup of a fresh
+ * Arm_Device, and any number of them can share the arm. The latest pose and
+ * counters are published in shared memory (see arm_daemon.h).
+ */
+
+#include "arm_daemon.h"
+#include "cli_args.h"
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <exception>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    std::atomic<bool> g_running(true);
+
+    void handle_signal(int signum) {
+        if (signum == SIGINT || signum == SIGTERM) {
+            g_running = false;
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    const std::string description =
+        "Serve the Dofbot arm to local clients over a Unix socket and shared memory.\n"
+        "Extra options:\n"
+        "  --socket PATH   Unix socket to listen on (default: /tmp/dofbotd.sock)\n"
+        "  --shm NAME      Shared-memory status segment, '' to disable; the pose goes\n"
+        "                  in NAME.pose (default: /dofbotd)\n"
+        "  --poll-hz HZ    Rate of the background read6 that refreshes the measured pose,\n"
+        "                  0 to disable (default: 10)";
+
+    try {
+        std::vector<std::string> extra;
+        const CommonArgs args = parse_common_args(argc, argv, description, &extra);
+        DaemonOptions daemon_options;
+        for (size_t i = 0; i < extra.size(); ++i) {
+            if (i + 1 >= extra.size()) {
+                throw std::runtime_error("Missing value for argument: " + extra[i]);
+            }
+            if (extra[i] == "--socket") {
+                daemon_options.socket_path = extra[++i];
+            } else if (extra[i] == "--shm") {
+                daemon_options.shm_name = extra[++i];
+            } else if (extra[i] == "--poll-hz") {
+                daemon_options.poll_hz = std::stod(extra[++i]);
+            } else {
+                throw std::runtime_error("Unrecognized argument: " + extra[i]);
+            }
+        }
+
+        Arm_Options options = make_arm_options(args);
+        options.async_io = true;   // Clients share the arm from their own threads
+        if (!daemon_options.shm_name.empty()) {
+            options.pose_shm_name = daemon_pose_shm_name(daemon_options.shm_name);
+        }
+        Arm_Device arm(args.port, options);
+
+        std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
+
+        DaemonServer server(arm, daemon_options);
+        std::signal(SIGINT, handle_signal);
+        std::signal(SIGTERM, handle_signal);
+        std::cout << "dofbotd serving " << args.port << " on " << daemon_options.socket_path;
+        if (!daemon_options.shm_name.empty()) {
+            std::cout << " (pose and status in shared memory " << options.pose_shm_name << ", "
+                      << daemon_options.shm_name << ")";
+        }
+        std::cout << "; Ctrl+C to stop." << std::endl;
+
+        while (g_running) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,63 @@
+#include "frame_decoder.h"
+
+#include <cstring>
+
+namespace arm_protocol {
+
+namespace {
+    constexpr uint8_t kReplyDeviceId = DEVICE_ID - 1;
+    // ext_len counts itself, ext_type, the data and the checksum
+    constexpr uint8_t kMinExtLen = 3;
+}
+
+uint8_t* FrameDecoder::write_ptr() {
+    if (head > 0) {
+        std::memmove(buffer.data(), buffer.data() + head, tail - head);
+        tail -= head;
+        head = 0;
+    }
+    if (tail == CAPACITY) {
+        // Only possible if the stream never contains a frame; keep the newest half
+        discarded += CAPACITY / 2;
+        std::memmove(buffer.data(), buffer.data() + CAPACITY / 2, CAPACITY / 2);
+        tail = CAPACITY / 2;
+    }
+    return buffer.data() + tail;
+}
+
+bool FrameDecoder::next(uint8_t& ext_type, PayloadView& payload) {
+    while (tail - head >= 4) {
+        const uint8_t* frame = buffer.data() + head;
+        if (frame[0] != HEAD || frame[1] != kReplyDeviceId || frame[2] < kMinExtLen) {
+            ++head;
+            ++discarded;
+            continue;
+        }
+
+        const std::size_t frame_len = static_cast<std::size_t>(frame[2]) + 2;
+        if (tail - head < frame_len) {
+            return false; // Rest of the frame has not arrived yet
+        }
+
+        unsigned int sum = 0;
+        for (std::size_t i = 2; i < frame_len - 1; ++i) {
+            sum += frame[i];
+        }
+        if (static_cast<uint8_t>(sum & 0xFF) != frame[frame_len - 1]) {
+            // Resync one byte on: the real frame may start inside this one
+            ++bad_checksums;
+            ++head;
+            ++discarded;
+            continue;
+        }
+
+        ext_type = frame[3];
+        payload.data = frame + 4;
+        payload.size = frame_len - 5;
+        head += frame_len;
+        return true;
+    }
+    return false;
+}
+
+} // namespace arm_protocol
@@ -0,0 +1,71 @@
+/**
+ * @file frame_decoder.h
+ * @brief Streaming parser for reply frames read from the board.
+ *
+ * Replies have the layout
+ *   0xFF 0xFB <ext_len> <ext_type> <data...> <checksum>
+ * where ext_len - 2 counts the data bytes plus the checksum, and the checksum
+ * is the low byte of ext_len + ext_type + data. The decoder owns a fixed
+ * receive buffer: callers read whatever the port has straight into
+ * write_ptr() with one syscall, commit() it, then pull out as many complete
+ * frames as next() finds. Partial frames stay buffered for the next read, and
+ * a bad header or checksum drops a single byte so a valid frame that starts
+ * inside the damaged one is still found.
+ */
+
+#ifndef DOFBOT_FRAME_DECODER_H
+#define DOFBOT_FRAME_DECODER_H
+
+#include "Arm_Protocol.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+namespace arm_protocol {
+
+class FrameDecoder {
+public:
+    // Two maximum-length frames, so a full frame always fits behind a partial one
+    static constexpr std::size_t CAPACITY = 512;
+
+    /**
+     * @brief Free space at the end of the buffer; already parsed bytes are
+     *        compacted away first. Invalidates payloads returned by next().
+     */
+    uint8_t* write_ptr();
+    std::size_t write_space() const { return CAPACITY - tail; }
+
+    /**
+     * @brief Marks @p count bytes written at write_ptr() as received.
+     */
+    void commit(std::size_t count) { tail += count; }
+
+    /**
+     * @brief Extracts the next complete frame with a valid checksum.
+     * @param payload Set to the data bytes (checksum excluded); it points into
+     *        the decoder and stays valid until the next write_ptr() or reset().
+     * @return false when no complete frame is buffered.
+     */
+    bool next(uint8_t& ext_type, PayloadView& payload);
+
+    /**
+     * @brief Discards everything buffered.
+     */
+    void reset() { head = tail = 0; }
+
+    std::size_t buffered() const { return tail - head; }
+    uint64_t checksum_errors() const { return bad_checksums; }
+    uint64_t discarded_bytes() const { return discarded; }
+
+private:
+    std::array<uint8_t, CAPACITY> buffer{};
+    std::size_t head = 0;  // First unparsed byte
+    std::size_t tail = 0;  // One past the last received byte
+    uint64_t bad_checksums = 0;
+    uint64_t discarded = 0;
+};
+
+} // namespace arm_protocol
+
+#endif // DOFBOT_FRAME_DECODER_H
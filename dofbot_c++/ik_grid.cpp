@@ -0,0 +1,345 @@
+#include "ik_grid.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    constexpr char kMagic[8] = {'D', 'O', 'F', 'I', 'K', 'G', 'R', 0};
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kByteOrder = 0x01020304;
+    constexpr int kLanes = 4;                 // S1-S4; S5 is the spec roll, S6 the caller's gripper
+    constexpr uint16_t kUnreachable = 0xFFFF;
+    constexpr double kCentidegrees = 100.0;
+    constexpr size_t kMaxNodes = size_t(1) << 28;
+    // Corners further apart than this sit on different IK branches; interpolating
+    // between them would land in neither, so the nearest corner seeds refine() instead
+    constexpr double kMaxSpread = 20.0;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t dims[3];
+        uint32_t reserved0;
+        float min[3];
+        float max[3];
+        float step;
+        float pitch;
+        float roll;
+        uint32_t reserved1;
+        double geometry[4]; // base_height, upper_arm, forearm, tool_length
+        uint64_t node_count;
+        uint8_t padding[16];
+    };
+    static_assert(sizeof(FileHeader) == 128, "Grid file header must stay 128 bytes");
+
+    uint32_t axis_nodes(float lo, float hi, float step) {
+        return static_cast<uint32_t>(std::floor((hi - lo) / step + 0.5f)) + 1;
+    }
+
+    uint16_t encode_angle(float degrees) {
+        const long value = std::lround(degrees * kCentidegrees);
+        return static_cast<uint16_t>(std::min(std::max(value, 0L), static_cast<long>(CalibrationProfile::MAX_ANGLE * kCentidegrees)));
+    }
+}
+
+IkGrid::IkGrid(const IkGridSpec& spec, const ArmGeometry& geometry, const CalibrationProfile& calibration)
+    : grid_spec(spec), solver(geometry, calibration) {}
+
+IkGrid::IkGrid(IkGrid&& other) noexcept
+    : grid_spec(other.grid_spec), solver(other.solver), dims(other.dims),
+      nodes(other.nodes), owned(std::move(other.owned)),
+      mapping(other.mapping), mapping_size(other.mapping_size) {
+    other.nodes = nullptr;
+    other.mapping = nullptr;
+    other.mapping_size = 0;
+}
+
+IkGrid& IkGrid::operator=(IkGrid&& other) noexcept {
+    if (this != &other) {
+        if (mapping) {
+            munmap(mapping, mapping_size);
+        }
+        grid_spec = other.grid_spec;
+        solver = other.solver;
+        dims = other.dims;
+        nodes = other.nodes;
+        owned = std::move(other.owned);
+        mapping = other.mapping;
+        mapping_size = other.mapping_size;
+        other.nodes = nullptr;
+        other.mapping = nullptr;
+        other.mapping_size = 0;
+    }
+    return *this;
+}
+
+IkGrid::~IkGrid() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+IkGrid IkGrid::build(const IkGridSpec& spec, const ArmGeometry& geometry, unsigned threads,
+                     const CalibrationProfile& calibration) {
+    if (!(spec.step > 0.0f)) {
+        throw std::invalid_argument("Grid step must be positive.");
+    }
+    for (int axis = 0; axis < 3; ++axis) {
+        if (!(spec.max[axis] > spec.min[axis])) {
+            throw std::invalid_argument("Grid box must have a positive extent on every axis.");
+        }
+    }
+
+    IkGrid grid(spec, geometry, calibration);
+    for (int axis = 0; axis < 3; ++axis) {
+        grid.dims[axis] = std::max<uint32_t>(2, axis_nodes(spec.min[axis], spec.max[axis], spec.step));
+    }
+    if (grid.node_count() > kMaxNodes) {
+        throw std::invalid_argument("Grid is too large; increase the step or shrink the box.");
+    }
+    grid.owned.assign(grid.node_count() * kLanes, kUnreachable);
+    grid.nodes = grid.owned.data();
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min<unsigned>(threads, grid.dims[2]);
+
+    // Workers claim whole z slices and run the batch solver over each one
+    const uint32_t nx = grid.dims[0];
+    const uint32_t ny = grid.dims[1];
+    std::atomic<uint32_t> next_slice(0);
+    uint16_t* out = grid.owned.data();
+    const DofbotKinematics& solver = grid.solver;
+    const auto worker = [&]() {
+        CartesianBatch targets;
+        JointBatch solutions;
+        targets.resize(static_cast<size_t>(nx) * ny);
+        for (size_t i = 0; i < targets.size(); ++i) {
+            targets.x[i] = spec.min[0] + spec.step * static_cast<float>(i % nx);
+            targets.y[i] = spec.min[1] + spec.step * static_cast<float>(i / nx);
+            targets.pitch[i] = spec.pitch;
+            targets.roll[i] = spec.roll;
+        }
+
+        for (uint32_t iz = next_slice++; iz < grid.dims[2]; iz = next_slice++) {
+            std::fill(targets.z.begin(), targets.z.end(), spec.min[2] + spec.step * static_cast<float>(iz));
+            solver.inverse_batch(targets, solutions);
+
+            uint16_t* slice = out + static_cast<size_t>(iz) * targets.size() * kLanes;
+            for (size_t i = 0; i < targets.size(); ++i) {
+                if (!solutions.reachable[i]) {
+                    continue;
+                }
+                for (int lane = 0; lane < kLanes; ++lane) {
+                    slice[i * kLanes + lane] = encode_angle(solutions.angles[lane][i]);
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; ++t) {
+        pool.emplace_back(worker);
+    }
+    worker();
+    for (std::thread& thread : pool) {
+        thread.join();
+    }
+    return grid;
+}
+
+IkGrid IkGrid::open(const std::string& path, const CalibrationProfile& calibration) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open IK grid: " + path + " - " + strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat IK grid: " + path + " - " + strerror(error));
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    if (size < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("IK grid file is truncated: " + path);
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Failed to map IK grid: " + path + " - " + strerror(errno));
+    }
+
+    FileHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    const uint64_t expected_nodes = static_cast<uint64_t>(header.dims[0]) * header.dims[1] * header.dims[2];
+    const bool valid = std::memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+                       header.version == kVersion && header.byte_order == kByteOrder &&
+                       header.dims[0] >= 2 && header.dims[1] >= 2 && header.dims[2] >= 2 &&
+                       header.step > 0.0f && header.node_count == expected_nodes &&
+                       expected_nodes <= kMaxNodes &&
+                       size == sizeof(FileHeader) + expected_nodes * kLanes * sizeof(uint16_t);
+    if (!valid) {
+        munmap(mapped, size);
+        throw std::runtime_error("Not a valid IK grid file (or built on another byte order): " + path);
+    }
+
+    IkGridSpec spec;
+    for (int axis = 0; axis < 3; ++axis) {
+        spec.min[axis] = header.min[axis];
+        spec.max[axis] = header.max[axis];
+    }
+    spec.step = header.step;
+    spec.pitch = header.pitch;
+    spec.roll = header.roll;
+
+    ArmGeometry geometry;
+    geometry.base_height = header.geometry[0];
+    geometry.upper_arm = header.geometry[1];
+    geometry.forearm = header.geometry[2];
+    geometry.tool_length = header.geometry[3];
+
+    IkGrid grid(spec, geometry, calibration);
+    grid.dims = {header.dims[0], header.dims[1], header.dims[2]};
+    grid.mapping = mapped;
+    grid.mapping_size = size;
+    grid.nodes = reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(mapped) + sizeof(FileHeader));
+    return grid;
+}
+
+void IkGrid::save(const std::string& path) const {
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    for (int axis = 0; axis < 3; ++axis) {
+        header.dims[axis] = dims[axis];
+        header.min[axis] = grid_spec.min[axis];
+        header.max[axis] = grid_spec.max[axis];
+    }
+    header.step = grid_spec.step;
+    header.pitch = grid_spec.pitch;
+    header.roll = grid_spec.roll;
+    const ArmGeometry& geometry = solver.geometry();
+    header.geometry[0] = geometry.base_height;
+    header.geometry[1] = geometry.upper_arm;
+    header.geometry[2] = geometry.forearm;
+    header.geometry[3] = geometry.tool_length;
+    header.node_count = node_count();
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file) {
+        throw std::runtime_error("Failed to create IK grid: " + path);
+    }
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    file.write(reinterpret_cast<const char*>(nodes),
+               static_cast<std::streamsize>(node_count() * kLanes * sizeof(uint16_t)));
+    if (!file.flush()) {
+        throw std::runtime_error("Failed to write IK grid: " + path);
+    }
+}
+
+size_t IkGrid::reachable_count() const {
+    size_t count = 0;
+    for (size_t i = 0; i < node_count(); ++i) {
+        count += nodes[i * kLanes] != kUnreachable;
+    }
+    return count;
+}
+
+bool IkGrid::lookup(double x, double y, double z, std::array<double, 6>& joints,
+                    int refine_iterations) const {
+    const double point[3] = {x, y, z};
+    uint32_t base[3];
+    double frac[3];
+    for (int axis = 0; axis < 3; ++axis) {
+        const double f = (point[axis] - grid_spec.min[axis]) / grid_spec.step;
+        if (!(f >= 0.0) || f > static_cast<double>(dims[axis] - 1)) {
+            return false;
+        }
+        base[axis] = std::min(static_cast<uint32_t>(f), dims[axis] - 2);
+        frac[axis] = f - base[axis];
+    }
+
+    // Gather the eight corners of the cell
+    const size_t row = dims[0];
+    const size_t slice = row * dims[1];
+    const size_t origin = base[2] * slice + base[1] * row + base[0];
+    std::array<double, kLanes> blended{};
+    std::array<double, kLanes> low, high;
+    low.fill(1e9);
+    high.fill(-1e9);
+    bool all_valid = true;
+    int nearest = -1;
+    double nearest_distance = 1e9;
+    for (int corner = 0; corner < 8; ++corner) {
+        const int cx = corner & 1, cy = (corner >> 1) & 1, cz = corner >> 2;
+        const uint16_t* node = nodes + (origin + cz * slice + cy * row + cx) * kLanes;
+        if (node[0] == kUnreachable) {
+            all_valid = false;
+            continue;
+        }
+        const double wx = cx ? frac[0] : 1.0 - frac[0];
+        const double wy = cy ? frac[1] : 1.0 - frac[1];
+        const double wz = cz ? frac[2] : 1.0 - frac[2];
+        const double distance = (1.0 - wx) + (1.0 - wy) + (1.0 - wz);
+        if (distance < nearest_distance) {
+            nearest_distance = distance;
+            nearest = corner;
+        }
+        for (int lane = 0; lane < kLanes; ++lane) {
+            const double angle = node[lane] / kCentidegrees;
+            blended[lane] += wx * wy * wz * angle;
+            low[lane] = std::min(low[lane], angle);
+            high[lane] = std::max(high[lane], angle);
+        }
+    }
+
+    CartesianPose target;
+    target.x = x;
+    target.y = y;
+    target.z = z;
+    target.pitch = grid_spec.pitch;
+    target.roll = grid_spec.roll;
+    if (nearest < 0) {
+        // Cell outside the tabulated region; only the analytic solver can tell
+        return refine_iterations > 0 && solver.inverse(target, joints);
+    }
+
+    bool consistent = all_valid;
+    for (int lane = 0; lane < kLanes && consistent; ++lane) {
+        consistent = high[lane] - low[lane] <= kMaxSpread;
+    }
+    if (!consistent) {
+        const int cx = nearest & 1, cy = (nearest >> 1) & 1, cz = nearest >> 2;
+        const uint16_t* node = nodes + (origin + cz * slice + cy * row + cx) * kLanes;
+        for (int lane = 0; lane < kLanes; ++lane) {
+            blended[lane] = node[lane] / kCentidegrees;
+        }
+    }
+
+    std::array<double, 6> candidate = {blended[0], blended[1], blended[2], blended[3],
+                                       static_cast<double>(grid_spec.roll), joints[5]};
+    if (refine_iterations > 0) {
+        if (!solver.refine(target, candidate, refine_iterations)) {
+            // Edge of the reachable region, where the corners straddle the limits
+            return solver.inverse(target, joints);
+        }
+    } else if (!consistent || !solver.within_limits(candidate)) {
+        return false;
+    }
+    joints = candidate;
+    return true;
+}
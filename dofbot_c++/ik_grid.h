@@ -0,0 +1,104 @@
+/**
+ * @file ik_grid.h
+ * @brief Precomputed Cartesian-to-joint lookup grid with a memory-mapped file cache.
+ *
+ * The grid samples a box of the workspace at a fixed tool pitch and roll and
+ * stores S1-S4 for every node as 16-bit centidegrees (0xFFFF marks a node with
+ * no solution inside the servo limits). A query interpolates the eight nodes
+ * around the target and polishes the result with DofbotKinematics::refine(),
+ * so its cost does not depend on the grid size.
+ *
+ * File layout (native byte order): a 128-byte header followed by the
+ * node array, x fastest, then y, then z, four lanes per node.
+ */
+
+#ifndef DOFBOT_IK_GRID_H
+#define DOFBOT_IK_GRID_H
+
+#include "kinematics.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Workspace box, resolution and tool orientation of a grid.
+ */
+struct IkGridSpec {
+    std::array<float, 3> min = {-0.35f, -0.35f, 0.0f};  // Metres
+    std::array<float, 3> max = {0.35f, 0.35f, 0.45f};
+    float step = 0.01f;                                 // Node spacing in metres
+    float pitch = 90.0f;                                // Tool pitch below horizontal (90 = pointing down)
+    float roll = 90.0f;                                 // S5 written with every solution
+};
+
+class IkGrid {
+public:
+    /**
+     * @brief Solves every node of @p spec, splitting the z slices over @p threads
+     *        workers (0 = one per core).
+     * @throws std::invalid_argument if the box is empty or the step is not positive.
+     */
+    static IkGrid build(const IkGridSpec& spec, const ArmGeometry& geometry = ArmGeometry(),
+                        unsigned threads = 0, const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    /**
+     * @brief Maps a grid file written by save() read-only into memory.
+     * @param calibration Bounds lookups; pass the profile the grid was built with.
+     * @throws std::runtime_error if the file cannot be opened or is not a valid grid.
+     */
+    static IkGrid open(const std::string& path, const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    IkGrid(IkGrid&& other) noexcept;
+    IkGrid& operator=(IkGrid&& other) noexcept;
+    IkGrid(const IkGrid&) = delete;
+    IkGrid& operator=(const IkGrid&) = delete;
+    ~IkGrid();
+
+    /**
+     * @brief Writes the grid to @p path.
+     * @throws std::runtime_error on I/O failure.
+     */
+    void save(const std::string& path) const;
+
+    /**
+     * @brief Joint angles that put the gripper tip at (@p x, @p y, @p z) with the
+     *        grid's pitch and roll.
+     * @param joints In: joints[5] is the gripper angle to keep. Out: S1-S6 on success.
+     * @param refine_iterations Damped least-squares steps after interpolation. Cells
+     *        whose refinement misses (the edge of the reachable region) fall back to
+     *        DofbotKinematics::inverse(). 0 returns the raw interpolation and fails
+     *        on such cells instead.
+     * @return false if the point is outside the grid box or has no solution inside
+     *         the servo limits; @p joints is untouched then.
+     */
+    bool lookup(double x, double y, double z, std::array<double, 6>& joints,
+                int refine_iterations = 3) const;
+
+    const IkGridSpec& spec() const { return grid_spec; }
+    const DofbotKinematics& kinematics() const { return solver; }
+
+    /**
+     * @brief Nodes along x, y and z.
+     */
+    const std::array<uint32_t, 3>& dimensions() const { return dims; }
+
+    size_t node_count() const { return static_cast<size_t>(dims[0]) * dims[1] * dims[2]; }
+    size_t reachable_count() const;
+
+private:
+    IkGrid(const IkGridSpec& spec, const ArmGeometry& geometry, const CalibrationProfile& calibration);
+
+    IkGridSpec grid_spec;
+    DofbotKinematics solver;
+    std::array<uint32_t, 3> dims{};
+
+    const uint16_t* nodes = nullptr;  // Points into owned or into the mapping
+    std::vector<uint16_t> owned;
+    void* mapping = nullptr;
+    size_t mapping_size = 0;
+};
+
+#endif // DOFBOT_IK_GRID_H
@@ -0,0 +1,305 @@
+#include "joint_trajectory.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+namespace {
+    constexpr int kJoints = 6;
+    // Samples per segment used to find the peak velocity/acceleration of a blend
+    constexpr int kPeakSamples = 32;
+    constexpr int kMaxRefinements = 50;
+
+    // Shortest time a single joint needs to travel @p distance from rest to rest
+    double min_travel_time(double distance, double vmax, double amax) {
+        distance = std::fabs(distance);
+        if (distance <= 0.0) {
+            return 0.0;
+        }
+        if (distance >= vmax * vmax / amax) {
+            return distance / vmax + vmax / amax; // Reaches cruise speed
+        }
+        return 2.0 * std::sqrt(distance / amax);  // Triangular profile
+    }
+
+    double velocity_at(const std::array<std::array<double, 6>, 6>& c, int j, double tau) {
+        return c[1][j] + tau * (2.0 * c[2][j] + tau * (3.0 * c[3][j] + tau * (4.0 * c[4][j] + tau * 5.0 * c[5][j])));
+    }
+
+    double acceleration_at(const std::array<std::array<double, 6>, 6>& c, int j, double tau) {
+        return 2.0 * c[2][j] + tau * (6.0 * c[3][j] + tau * (12.0 * c[4][j] + tau * 20.0 * c[5][j]));
+    }
+}
+
+void SampleTable::pose(size_t index, std::array<double, 6>& out) const {
+    for (int j = 0; j < kJoints; ++j) {
+        out[j] = std::min(std::max(static_cast<double>(joints[j][index]), 0.0), max_angle[j]);
+    }
+}
+
+JointTrajectory SampleTable::streamer_source() const {
+    const SampleTable* table = this;
+    return [table](double t, std::array<double, 6>& out) {
+        const double index = std::round(t * table->rate_hz);
+        if (index < 0.0 || index >= static_cast<double>(table->size())) {
+            return false;
+        }
+        table->pose(static_cast<size_t>(index), out);
+        return true;
+    };
+}
+
+InterpolatedTrajectory::InterpolatedTrajectory(const std::vector<Waypoint>& waypoints,
+                                               InterpolationMode mode, const JointLimits& limits,
+                                               const CalibrationProfile& calibration)
+    : max_angle(calibration.max_angles()) {
+    if (waypoints.size() < 2) {
+        throw std::invalid_argument("A trajectory needs at least two waypoints.");
+    }
+    for (int j = 0; j < kJoints; ++j) {
+        if (!(limits.max_velocity[j] > 0.0) || !(limits.max_acceleration[j] > 0.0)) {
+            throw std::invalid_argument("Joint velocity and acceleration limits must be positive.");
+        }
+    }
+    for (const Waypoint& waypoint : waypoints) {
+        for (int j = 0; j < kJoints; ++j) {
+            if (waypoint.angles[j] < 0.0 || waypoint.angles[j] > max_angle[j]) {
+                throw std::out_of_range("Waypoint angle is out of range.");
+            }
+        }
+    }
+
+    const size_t count = waypoints.size() - 1;
+
+    // Start from the time the slowest joint needs for a rest-to-rest move
+    std::vector<double> durations(count);
+    for (size_t s = 0; s < count; ++s) {
+        double duration = waypoints[s + 1].min_duration;
+        for (int j = 0; j < kJoints; ++j) {
+            const double distance = waypoints[s + 1].angles[j] - waypoints[s].angles[j];
+            duration = std::max(duration, min_travel_time(distance, limits.max_velocity[j],
+                                                          limits.max_acceleration[j]));
+        }
+        durations[s] = std::max(duration, 1e-3);
+    }
+
+    if (mode == InterpolationMode::Trapezoidal) {
+        double start = 0.0;
+        for (size_t s = 0; s < count; ++s) {
+            std::array<double, 6> distance{};
+            for (int j = 0; j < kJoints; ++j) {
+                distance[j] = waypoints[s + 1].angles[j] - waypoints[s].angles[j];
+            }
+
+            // All joints share the blend time so they start and stop together.
+            // Pick the longest blend that keeps every joint under its speed limit,
+            // then stretch the segment until the accelerations fit too.
+            double total = durations[s];
+            double blend = 0.0;
+            for (int attempt = 0; attempt < kMaxRefinements; ++attempt) {
+                blend = total / 2.0;
+                for (int j = 0; j < kJoints; ++j) {
+                    blend = std::min(blend, total - std::fabs(distance[j]) / limits.max_velocity[j]);
+                }
+                bool feasible = blend > 0.0;
+                for (int j = 0; j < kJoints && feasible; ++j) {
+                    feasible = std::fabs(distance[j]) <= limits.max_acceleration[j] * blend * (total - blend) * (1.0 + 1e-9);
+                }
+                if (feasible) {
+                    break;
+                }
+                total *= 1.05;
+            }
+
+            const double cruise = total - 2.0 * blend;
+            Segment accel, steady, decel;
+            accel.start = start;
+            accel.duration = blend;
+            steady.start = start + blend;
+            steady.duration = cruise;
+            decel.start = start + blend + cruise;
+            decel.duration = blend;
+            for (int j = 0; j < kJoints; ++j) {
+                const double q0 = waypoints[s].angles[j];
+                const double v = distance[j] / (total - blend);
+                const double a = v / blend;
+                accel.coeffs[0][j] = q0;
+                accel.coeffs[2][j] = 0.5 * a;
+                steady.coeffs[0][j] = q0 + 0.5 * a * blend * blend;
+                steady.coeffs[1][j] = v;
+                decel.coeffs[0][j] = steady.coeffs[0][j] + v * cruise;
+                decel.coeffs[1][j] = v;
+                decel.coeffs[2][j] = -0.5 * a;
+            }
+            segments.push_back(accel);
+            if (cruise > 0.0) {
+                segments.push_back(steady);
+            }
+            segments.push_back(decel);
+            start += total;
+        }
+        return;
+    }
+
+    // Cubic / quintic blends: fit, measure the peaks, stretch offending segments, repeat.
+    for (int attempt = 0; attempt < kMaxRefinements; ++attempt) {
+        // Waypoint velocities: mean of the neighbouring slopes, zero at the ends
+        // and wherever the joint reverses direction.
+        std::vector<std::array<double, 6>> velocity(waypoints.size());
+        for (size_t k = 1; k < count; ++k) {
+            for (int j = 0; j < kJoints; ++j) {
+                const double before = (waypoints[k].angles[j] - waypoints[k - 1].angles[j]) / durations[k - 1];
+                const double after = (waypoints[k + 1].angles[j] - waypoints[k].angles[j]) / durations[k];
+                velocity[k][j] = (before * after > 0.0) ? 0.5 * (before + after) : 0.0;
+            }
+        }
+
+        segments.assign(count, Segment());
+        bool within_limits = true;
+        double start = 0.0;
+        for (size_t s = 0; s < count; ++s) {
+            Segment& segment = segments[s];
+            const double h = durations[s];
+            segment.start = start;
+            segment.duration = h;
+            for (int j = 0; j < kJoints; ++j) {
+                const double q0 = waypoints[s].angles[j];
+                const double delta = waypoints[s + 1].angles[j] - q0;
+                const double v0 = velocity[s][j];
+                const double v1 = velocity[s + 1][j];
+                segment.coeffs[0][j] = q0;
+                segment.coeffs[1][j] = v0;
+                if (mode == InterpolationMode::Cubic) {
+                    segment.coeffs[2][j] = (3.0 * delta / h - 2.0 * v0 - v1) / h;
+                    segment.coeffs[3][j] = (-2.0 * delta / h + v0 + v1) / (h * h);
+                } else {
+                    segment.coeffs[3][j] = (20.0 * delta - (8.0 * v1 + 12.0 * v0) * h) / (2.0 * h * h * h);
+                    segment.coeffs[4][j] = (-30.0 * delta + (14.0 * v1 + 16.0 * v0) * h) / (2.0 * h * h * h * h);
+                    segment.coeffs[5][j] = (12.0 * delta - 6.0 * (v1 + v0) * h) / (2.0 * h * h * h * h * h);
+                }
+            }
+
+            double stretch = 1.0;
+            for (int i = 0; i <= kPeakSamples; ++i) {
+                const double tau = h * i / kPeakSamples;
+                for (int j = 0; j < kJoints; ++j) {
+                    const double v_ratio = std::fabs(velocity_at(segment.coeffs, j, tau)) / limits.max_velocity[j];
+                    const double a_ratio = std::fabs(acceleration_at(segment.coeffs, j, tau)) / limits.max_acceleration[j];
+                    stretch = std::max(stretch, std::max(v_ratio, std::sqrt(a_ratio)));
+                }
+            }
+            if (stretch > 1.0 + 1e-6) {
+                // Velocity scales with 1/k and acceleration with 1/k^2 when time stretches by k
+                durations[s] = h * stretch * 1.01;
+                within_limits = false;
+            }
+            start += h;
+        }
+
+        if (within_limits) {
+            break;
+        }
+    }
+}
+
+double InterpolatedTrajectory::duration() const {
+    const Segment& last = segments.back();
+    return last.start + last.duration;
+}
+
+size_t InterpolatedTrajectory::find_segment(double t) const {
+    // First segment whose end lies beyond t
+    size_t lo = 0;
+    size_t hi = segments.size() - 1;
+    while (lo < hi) {
+        const size_t mid = (lo + hi) / 2;
+        if (t < segments[mid].start + segments[mid].duration) {
+            hi = mid;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return lo;
+}
+
+void InterpolatedTrajectory::sample(double t, std::array<double, 6>& pose) const {
+    t = std::min(std::max(t, 0.0), duration());
+    const Segment& segment = segments[find_segment(t)];
+    const double tau = std::min(t - segment.start, segment.duration);
+    const auto& c = segment.coeffs;
+    for (int j = 0; j < kJoints; ++j) {
+        pose[j] = c[0][j] + tau * (c[1][j] + tau * (c[2][j] + tau * (c[3][j] + tau * (c[4][j] + tau * c[5][j]))));
+    }
+}
+
+void InterpolatedTrajectory::sample_batch(const double* times, size_t count,
+                                          const std::array<float*, 6>& out) const {
+    const double end = duration();
+    std::vector<double> tau(count);
+
+    size_t i = 0;
+    while (i < count) {
+        const size_t index = find_segment(std::min(std::max(times[i], 0.0), end));
+        const Segment& segment = segments[index];
+        const double segment_end = (index + 1 == segments.size()) ? end : segment.start + segment.duration;
+
+        // Gather the run of instants that fall into this segment
+        size_t run_end = i;
+        while (run_end < count && (times[run_end] < segment_end || index + 1 == segments.size())) {
+            const double t = std::min(std::max(times[run_end], 0.0), end);
+            tau[run_end] = std::min(t - segment.start, segment.duration);
+            ++run_end;
+        }
+
+        // Same Horner polynomial for every instant of the run: vectorises over time
+        const auto& c = segment.coeffs;
+        for (int j = 0; j < kJoints; ++j) {
+            const double c0 = c[0][j], c1 = c[1][j], c2 = c[2][j], c3 = c[3][j], c4 = c[4][j], c5 = c[5][j];
+            float* dst = out[j];
+            const double* x = tau.data();
+            for (size_t k = i; k < run_end; ++k) {
+                const double s = x[k];
+                dst[k] = static_cast<float>(c0 + s * (c1 + s * (c2 + s * (c3 + s * (c4 + s * c5)))));
+            }
+        }
+        i = run_end;
+    }
+}
+
+SampleTable InterpolatedTrajectory::precompute(double rate_hz) const {
+    if (!(rate_hz > 0.0)) {
+        throw std::invalid_argument("Sample rate must be positive.");
+    }
+
+    SampleTable table;
+    table.rate_hz = rate_hz;
+    table.max_angle = max_angle;
+    const size_t count = static_cast<size_t>(std::ceil(duration() * rate_hz)) + 1;
+
+    std::vector<double> times(count);
+    for (size_t i = 0; i < count; ++i) {
+        times[i] = static_cast<double>(i) / rate_hz;
+    }
+
+    std::array<float*, 6> out{};
+    for (int j = 0; j < kJoints; ++j) {
+        table.joints[j].resize(count);
+        out[j] = table.joints[j].data();
+    }
+    sample_batch(times.data(), count, out);
+    return table;
+}
+
+JointTrajectory InterpolatedTrajectory::streamer_source() const {
+    const InterpolatedTrajectory* trajectory = this;
+    return [trajectory](double t, std::array<double, 6>& out) {
+        if (t > trajectory->duration()) {
+            return false;
+        }
+        trajectory->sample(t, out);
+        for (int j = 0; j < kJoints; ++j) {
+            out[j] = std::min(std::max(out[j], 0.0), trajectory->max_angle[j]);
+        }
+        return true;
+    };
+}
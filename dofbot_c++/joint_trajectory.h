@@ -0,0 +1,119 @@
+/**
+ * @file joint_trajectory.h
+ * @brief Joint-space interpolation through waypoints with velocity/acceleration limits.
+ *
+ * A trajectory is stored as a list of polynomial segments whose coefficients
+ * are laid out structure-of-arrays (coeffs[power][joint]), so evaluating one
+ * instant touches six adjacent lanes and evaluating many instants runs the
+ * same Horner loop over contiguous time samples. Trapezoidal profiles are
+ * stored as three quadratic pieces, cubic and quintic blends as one piece per
+ * waypoint pair.
+ */
+
+#ifndef DOFBOT_JOINT_TRAJECTORY_H
+#define DOFBOT_JOINT_TRAJECTORY_H
+
+#include "calibration.h"
+#include "trajectory_streamer.h"
+
+#include <array>
+#include <cstddef>
+#include <vector>
+
+enum class InterpolationMode {
+    Cubic,       // C1 blend, velocities chosen from neighbouring slopes
+    Quintic,     // Same velocities plus zero acceleration at every waypoint
+    Trapezoidal  // Synchronised constant-acceleration / cruise / deceleration per segment
+};
+
+/**
+ * @brief Target pose (degrees, S1-S6) and the shortest time allowed to reach it
+ *        from the previous waypoint. The first waypoint's duration is ignored.
+ */
+struct Waypoint {
+    std::array<double, 6> angles{};
+    double min_duration = 0.0; // Seconds; the planner stretches segments to respect limits
+};
+
+/**
+ * @brief Per-joint limits in degrees per second and degrees per second squared.
+ */
+struct JointLimits {
+    std::array<double, 6> max_velocity = {180.0, 180.0, 180.0, 180.0, 270.0, 180.0};
+    std::array<double, 6> max_acceleration = {720.0, 720.0, 720.0, 720.0, 1080.0, 720.0};
+};
+
+/**
+ * @brief A trajectory sampled at a fixed rate, one contiguous array per joint.
+ */
+struct SampleTable {
+    double rate_hz = 0.0;
+    std::array<std::vector<float>, 6> joints;
+    std::array<double, 6> max_angle = DEFAULT_CALIBRATION.max_angles();   // Joint ranges pose() clamps to
+
+    size_t size() const { return joints[0].size(); }
+
+    /**
+     * @brief Sample @p index clamped to the joint ranges for Arm_serial_servo_write6().
+     */
+    void pose(size_t index, std::array<double, 6>& out) const;
+
+    /**
+     * @brief Adapter for TrajectoryStreamer: each tick is a table lookup.
+     */
+    JointTrajectory streamer_source() const;
+};
+
+class InterpolatedTrajectory {
+public:
+    /**
+     * @brief Plans a trajectory through @p waypoints.
+     * @param calibration Profile of the arm that will play it (e.g.
+     *        Arm_Device::Arm_calibration()); waypoints and samples stay inside its joint ranges.
+     * @throws std::invalid_argument if fewer than two waypoints or non-positive limits are given.
+     * @throws std::out_of_range if a waypoint is outside the joint ranges.
+     */
+    InterpolatedTrajectory(const std::vector<Waypoint>& waypoints, InterpolationMode mode,
+                           const JointLimits& limits = JointLimits(),
+                           const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    /**
+     * @brief Total duration in seconds.
+     */
+    double duration() const;
+
+    /**
+     * @brief Evaluates all six joints at time @p t (clamped to [0, duration]).
+     */
+    void sample(double t, std::array<double, 6>& pose) const;
+
+    /**
+     * @brief Evaluates @p count ascending instants into six joint-major arrays.
+     */
+    void sample_batch(const double* times, size_t count, const std::array<float*, 6>& out) const;
+
+    /**
+     * @brief Samples the whole trajectory at @p rate_hz ahead of time.
+     */
+    SampleTable precompute(double rate_hz) const;
+
+    /**
+     * @brief Adapter for TrajectoryStreamer that evaluates the polynomials every tick.
+     */
+    JointTrajectory streamer_source() const;
+
+private:
+    struct Segment {
+        double start = 0.0;
+        double duration = 0.0;
+        // coeffs[k][j]: coefficient of tau^k for joint j, tau = t - start
+        std::array<std::array<double, 6>, 6> coeffs{};
+    };
+
+    std::vector<Segment> segments;
+    std::array<double, 6> max_angle;
+
+    size_t find_segment(double t) const;
+};
+
+#endif // DOFBOT_JOINT_TRAJECTORY_H
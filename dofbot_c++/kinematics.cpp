@@ -0,0 +1,355 @@
+#include "kinematics.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+namespace {
+    constexpr double kPi = 3.14159265358979323846;
+    constexpr double kDeg = 180.0 / kPi;
+    constexpr double kRad = kPi / 180.0;
+
+    // Wraps an angle in degrees into (-180, 180]
+    double wrap_degrees(double angle) {
+        angle = std::fmod(angle, 360.0);
+        if (angle > 180.0) {
+            angle -= 360.0;
+        } else if (angle <= -180.0) {
+            angle += 360.0;
+        }
+        return angle;
+    }
+
+    // Bitwise select: no branch for the compiler to keep, so loops stay vectorisable
+    inline float select(bool condition, float if_true, float if_false) {
+        uint32_t a, b;
+        std::memcpy(&a, &if_true, sizeof(a));
+        std::memcpy(&b, &if_false, sizeof(b));
+        const uint32_t mask = 0u - static_cast<uint32_t>(condition);
+        const uint32_t bits = (a & mask) | (b & ~mask);
+        float result;
+        std::memcpy(&result, &bits, sizeof(result));
+        return result;
+    }
+
+    // atan2 with a minimax polynomial (|error| < 1e-5 rad). Written with
+    // selects instead of branches so loops calling it vectorise.
+    inline float fast_atan2f(float y, float x) {
+        const float ax = std::fabs(x);
+        const float ay = std::fabs(y);
+        const float lo = std::min(ax, ay);
+        const float hi = std::max(ax, ay);
+        const float a = lo / (hi + 1e-30f);
+        const float s = a * a;
+        float r = ((-0.0464964749f * s + 0.15931422f) * s - 0.327622764f) * s * a + a;
+        r = select(ay > ax, 1.57079637f - r, r);
+        r = select(x < 0.0f, 3.14159274f - r, r);
+        return select(y < 0.0f, -r, r);
+    }
+
+    // floor() for floats that fit in an int, without the libm call that SSE2
+    // targets would otherwise emit and that blocks vectorisation
+    inline float floor_small(float value) {
+        const float truncated = static_cast<float>(static_cast<int>(value));
+        return truncated - select(truncated > value, 1.0f, 0.0f);
+    }
+
+    // sin and cos of an angle in radians from Taylor polynomials on
+    // [-pi/2, pi/2] (|error| < 1e-7), branch-free for the batch loop.
+    inline void fast_sincosf(float angle, float& sin_out, float& cos_out) {
+        // Reduce to [-pi, pi), then fold into [-pi/2, pi/2] where sin is unchanged and cos flips
+        float x = angle - 6.28318531f * floor_small((angle + 3.14159265f) / 6.28318531f);
+        const bool fold = std::fabs(x) > 1.57079633f;
+        x = select(fold, select(x > 0.0f, 3.14159265f, -3.14159265f) - x, x);
+        const float x2 = x * x;
+        const float s = x * (1.0f + x2 * (-1.0f / 6 + x2 * (1.0f / 120 + x2 * (-1.0f / 5040 + x2 * (1.0f / 362880 - x2 / 39916800)))));
+        const float c = 1.0f + x2 * (-0.5f + x2 * (1.0f / 24 + x2 * (-1.0f / 720 + x2 * (1.0f / 40320 + x2 * (-1.0f / 3628800 + x2 / 479001600)))));
+        sin_out = s;
+        cos_out = select(fold, -c, c);
+    }
+
+    // Branch-free wrap of degrees into [-180, 180)
+    inline float wrap_degreesf(float angle) {
+        return angle - 360.0f * floor_small((angle + 180.0f) / 360.0f);
+    }
+
+    // Solves the planar S2-S4 chain for one elbow branch; angles in degrees.
+    // Returns false if the wrist point is out of reach.
+    bool solve_planar(const ArmGeometry& g, double r, double z, double pitch, double elbow_sign,
+                      double& s2, double& s3, double& s4) {
+        const double tool_angle = (pitch + 90.0) * kRad; // Tool direction from vertical
+        const double wr = r - g.tool_length * std::sin(tool_angle);
+        const double wz = z - g.base_height - g.tool_length * std::cos(tool_angle);
+
+        const double c3 = (wr * wr + wz * wz - g.upper_arm * g.upper_arm - g.forearm * g.forearm) /
+                          (2.0 * g.upper_arm * g.forearm);
+        if (c3 < -1.0 || c3 > 1.0) {
+            return false;
+        }
+        const double lean3 = elbow_sign * std::acos(c3);
+        const double lean2 = std::atan2(wr, wz) -
+                             std::atan2(g.forearm * std::sin(lean3), g.upper_arm + g.forearm * std::cos(lean3));
+        const double lean4 = tool_angle - lean2 - lean3;
+
+        s2 = 90.0 - wrap_degrees(lean2 * kDeg);
+        s3 = 90.0 - wrap_degrees(lean3 * kDeg);
+        s4 = 90.0 - wrap_degrees(lean4 * kDeg);
+        return true;
+    }
+
+    // Solves the 4x4 system a * x = b in place (Gaussian elimination, partial pivoting)
+    bool solve4(std::array<std::array<double, 4>, 4>& a, std::array<double, 4>& b) {
+        for (int col = 0; col < 4; ++col) {
+            int pivot = col;
+            for (int row = col + 1; row < 4; ++row) {
+                if (std::fabs(a[row][col]) > std::fabs(a[pivot][col])) {
+                    pivot = row;
+                }
+            }
+            if (std::fabs(a[pivot][col]) < 1e-12) {
+                return false;
+            }
+            std::swap(a[col], a[pivot]);
+            std::swap(b[col], b[pivot]);
+            for (int row = col + 1; row < 4; ++row) {
+                const double factor = a[row][col] / a[col][col];
+                for (int k = col; k < 4; ++k) {
+                    a[row][k] -= factor * a[col][k];
+                }
+                b[row] -= factor * b[col];
+            }
+        }
+        for (int row = 3; row >= 0; --row) {
+            for (int k = row + 1; k < 4; ++k) {
+                b[row] -= a[row][k] * b[k];
+            }
+            b[row] /= a[row][row];
+        }
+        return true;
+    }
+}
+
+void CartesianBatch::resize(size_t count) {
+    x.resize(count);
+    y.resize(count);
+    z.resize(count);
+    pitch.resize(count);
+    roll.resize(count, 90.0f);
+}
+
+void JointBatch::resize(size_t count) {
+    for (std::vector<float>& lane : angles) {
+        lane.resize(count);
+    }
+    reachable.resize(count);
+}
+
+DofbotKinematics::DofbotKinematics(const ArmGeometry& geometry, const CalibrationProfile& calibration)
+    : geom(geometry), max_angle(calibration.max_angles()) {}
+
+bool DofbotKinematics::within_limits(const std::array<double, 6>& joints) const {
+    for (size_t i = 0; i < joints.size(); ++i) {
+        if (!(joints[i] >= 0.0 && joints[i] <= max_angle[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+CartesianPose DofbotKinematics::forward(const std::array<double, 6>& joints) const {
+    const double a2 = (90.0 - joints[1]) * kRad;
+    const double a3 = a2 + (90.0 - joints[2]) * kRad;
+    const double a4 = a3 + (90.0 - joints[3]) * kRad;
+
+    const double r = geom.upper_arm * std::sin(a2) + geom.forearm * std::sin(a3) + geom.tool_length * std::sin(a4);
+    const double heading = (joints[0] - 90.0) * kRad;
+
+    CartesianPose pose;
+    pose.x = r * std::cos(heading);
+    pose.y = r * std::sin(heading);
+    pose.z = geom.base_height + geom.upper_arm * std::cos(a2) + geom.forearm * std::cos(a3) +
+             geom.tool_length * std::cos(a4);
+    pose.pitch = wrap_degrees(a4 * kDeg - 90.0);
+    pose.roll = joints[4];
+    return pose;
+}
+
+bool DofbotKinematics::inverse(const CartesianPose& target, std::array<double, 6>& joints) const {
+    const double heading = std::atan2(target.y, target.x) * kDeg;
+    const double r = std::hypot(target.x, target.y);
+
+    // Facing the target, or turned away from it and reaching back over the top
+    const double bases[2][2] = {
+        {90.0 + heading, r},
+        {90.0 + heading + (heading > 0.0 ? -180.0 : 180.0), -r}
+    };
+
+    for (const auto& base : bases) {
+        for (double elbow : {1.0, -1.0}) {
+            std::array<double, 6> candidate = {base[0], 0.0, 0.0, 0.0, target.roll, joints[5]};
+            if (!solve_planar(geom, base[1], target.z, target.pitch, elbow,
+                              candidate[1], candidate[2], candidate[3])) {
+                continue;
+            }
+            if (within_limits(candidate)) {
+                joints = candidate;
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+bool DofbotKinematics::refine(const CartesianPose& target, std::array<double, 6>& joints, int iterations) const {
+    // Residuals are in metres; one degree of pitch error weighs like 1 mm
+    constexpr double kPitchWeight = 0.001;
+    constexpr double kDamping = 1e-9; // J^T J entries are ~1e-5 (m/deg)^2
+    constexpr double kStep = 1e-3; // Finite-difference step in degrees
+
+    const auto residual = [&](const std::array<double, 6>& q, std::array<double, 4>& e) {
+        const CartesianPose p = forward(q);
+        e[0] = target.x - p.x;
+        e[1] = target.y - p.y;
+        e[2] = target.z - p.z;
+        e[3] = wrap_degrees(target.pitch - p.pitch) * kPitchWeight;
+    };
+
+    std::array<double, 6> q = joints;
+    q[4] = target.roll;
+    std::array<double, 4> error{};
+    for (int it = 0; it < iterations; ++it) {
+        residual(q, error);
+
+        // Jacobian of the residual w.r.t. S1-S4 by forward differences
+        std::array<std::array<double, 4>, 4> jac{};
+        for (int k = 0; k < 4; ++k) {
+            std::array<double, 6> shifted = q;
+            shifted[k] += kStep;
+            std::array<double, 4> moved{};
+            residual(shifted, moved);
+            for (int row = 0; row < 4; ++row) {
+                jac[row][k] = (error[row] - moved[row]) / kStep;
+            }
+        }
+
+        // (J^T J + lambda^2 I) delta = J^T e
+        std::array<std::array<double, 4>, 4> normal{};
+        std::array<double, 4> rhs{};
+        for (int i = 0; i < 4; ++i) {
+            for (int k = 0; k < 4; ++k) {
+                for (int row = 0; row < 4; ++row) {
+                    normal[i][k] += jac[row][i] * jac[row][k];
+                }
+            }
+            normal[i][i] += kDamping;
+            for (int row = 0; row < 4; ++row) {
+                rhs[i] += jac[row][i] * error[row];
+            }
+        }
+        if (!solve4(normal, rhs)) {
+            break;
+        }
+        for (int k = 0; k < 4; ++k) {
+            q[k] += rhs[k];
+        }
+    }
+
+    residual(q, error);
+    const double position_error = std::sqrt(error[0] * error[0] + error[1] * error[1] + error[2] * error[2]);
+    const double pitch_error = std::fabs(error[3]) / kPitchWeight;
+    if (position_error > 1e-4 || pitch_error > 0.05 || !within_limits(q)) {
+        return false;
+    }
+    joints = q;
+    return true;
+}
+
+size_t DofbotKinematics::inverse_batch(const CartesianBatch& targets, JointBatch& out, float gripper) const {
+    const size_t count = targets.size();
+    out.resize(count);
+
+    const float h = static_cast<float>(geom.base_height);
+    const float l2 = static_cast<float>(geom.upper_arm);
+    const float l3 = static_cast<float>(geom.forearm);
+    const float l4 = static_cast<float>(geom.tool_length);
+    const float deg = static_cast<float>(kDeg);
+    const float rad = static_cast<float>(kRad);
+    const float max1 = static_cast<float>(max_angle[0]);
+    const float max2 = static_cast<float>(max_angle[1]);
+    const float max3 = static_cast<float>(max_angle[2]);
+    const float max4 = static_cast<float>(max_angle[3]);
+    const float max5 = static_cast<float>(max_angle[4]);
+
+    const float* __restrict tx = targets.x.data();
+    const float* __restrict ty = targets.y.data();
+    const float* __restrict tz = targets.z.data();
+    const float* __restrict tp = targets.pitch.data();
+    const float* __restrict troll = targets.roll.data();
+    float* __restrict s1 = out.angles[0].data();
+    float* __restrict s2 = out.angles[1].data();
+    float* __restrict s3 = out.angles[2].data();
+    float* __restrict s4 = out.angles[3].data();
+    float* __restrict s5 = out.angles[4].data();
+    float* __restrict s6 = out.angles[5].data();
+    uint8_t* __restrict ok = out.reachable.data();
+
+    for (size_t i = 0; i < count; ++i) {
+        // Base: face the target, or turn away and reach back when it is behind
+        const float heading = fast_atan2f(ty[i], tx[i]) * deg;
+        const bool behind = tx[i] < 0.0f;
+        const float base = 90.0f + heading + select(behind, select(heading > 0.0f, -180.0f, 180.0f), 0.0f);
+        const float radial = std::sqrt(tx[i] * tx[i] + ty[i] * ty[i]) * select(behind, -1.0f, 1.0f);
+
+        // Wrist centre in the arm plane
+        const float tool = (tp[i] + 90.0f) * rad;
+        float tool_sin, tool_cos;
+        fast_sincosf(tool, tool_sin, tool_cos);
+        const float wr = radial - l4 * tool_sin;
+        const float wz = tz[i] - h - l4 * tool_cos;
+
+        const float c3 = (wr * wr + wz * wz - l2 * l2 - l3 * l3) / (2.0f * l2 * l3);
+        const bool in_reach = (c3 >= -1.0f) & (c3 <= 1.0f);
+        const float c3c = std::min(std::max(c3, -1.0f), 1.0f);
+        const float sin3 = std::sqrt(1.0f - c3c * c3c);
+        const float lean3 = fast_atan2f(sin3, c3c); // acos(c3c), elbow branch A
+        const float toward = fast_atan2f(wr, wz);
+
+        // Elbow branch A (+lean3) and B (-lean3)
+        const float lean2a = toward - fast_atan2f(l3 * sin3, l2 + l3 * c3c);
+        const float lean2b = toward - fast_atan2f(-l3 * sin3, l2 + l3 * c3c);
+        const float a2 = 90.0f - wrap_degreesf(lean2a * deg);
+        const float a3 = 90.0f - lean3 * deg;
+        const float a4 = 90.0f - wrap_degreesf((tool - lean2a - lean3) * deg);
+        const float b2 = 90.0f - wrap_degreesf(lean2b * deg);
+        const float b3 = 90.0f + lean3 * deg;
+        const float b4 = 90.0f - wrap_degreesf((tool - lean2b + lean3) * deg);
+
+        const bool base_ok = (base >= 0.0f) & (base <= max1);
+        const bool roll_ok = (troll[i] >= 0.0f) & (troll[i] <= max5);
+        const bool a_ok = (a2 >= 0.0f) & (a2 <= max2) & (a3 >= 0.0f) & (a3 <= max3) & (a4 >= 0.0f) & (a4 <= max4);
+        const bool b_ok = (b2 >= 0.0f) & (b2 <= max2) & (b3 >= 0.0f) & (b3 <= max3) & (b4 >= 0.0f) & (b4 <= max4);
+
+        s1[i] = base;
+        s2[i] = select(a_ok, a2, b2);
+        s3[i] = select(a_ok, a3, b3);
+        s4[i] = select(a_ok, a4, b4);
+        s5[i] = troll[i];
+        s6[i] = gripper;
+        ok[i] = static_cast<uint8_t>(in_reach & base_ok & roll_ok & (a_ok | b_ok));
+    }
+
+    size_t reachable = 0;
+    for (size_t i = 0; i < count; ++i) {
+        reachable += ok[i];
+    }
+    return reachable;
+}
+
+std::array<int, 6> DofbotKinematics::to_servo_angles(const std::array<double, 6>& joints) const {
+    std::array<int, 6> angles{};
+    for (size_t i = 0; i < joints.size(); ++i) {
+        const double clamped = std::min(std::max(joints[i], 0.0), max_angle[i]);
+        angles[i] = static_cast<int>(std::lround(clamped));
+    }
+    return angles;
+}
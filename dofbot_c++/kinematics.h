@@ -0,0 +1,129 @@
+/**
+ * @file kinematics.h
+ * @brief Forward and inverse kinematics for the DOFBOT-SE arm.
+ *
+ * Angles are the same servo degrees Arm_Device takes (S1-S6, 90 = straight up
+ * for the pitch joints); the 180-minus inversion of joints 2-4 stays inside
+ * Arm_Device. Conventions:
+ *  - x points forward when S1 = 90, y to the left, z up, all in metres from
+ *    the centre of the base on the table.
+ *  - S1 yaws the arm: heading = S1 - 90 degrees.
+ *  - S2-S4 pitch the arm: each joint leans its link forward by (90 - Sn)
+ *    degrees relative to the previous link.
+ *  - Tool pitch is measured below the horizontal (0 = pointing forward,
+ *    90 = pointing straight down); roll is S5. S6 (gripper) passes through.
+ */
+
+#ifndef DOFBOT_KINEMATICS_H
+#define DOFBOT_KINEMATICS_H
+
+#include "calibration.h"
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+/**
+ * @brief Link lengths in metres. Defaults are the nominal DOFBOT-SE dimensions;
+ *        measure your arm and override them for best accuracy.
+ */
+struct ArmGeometry {
+    double base_height = 0.1075;  // Table to the S2 axis
+    double upper_arm = 0.08285;   // S2 axis to S3 axis
+    double forearm = 0.08285;     // S3 axis to S4 axis
+    double tool_length = 0.17;    // S4 axis to the gripper tip
+};
+
+/**
+ * @brief Gripper tip position (m) and orientation (degrees).
+ */
+struct CartesianPose {
+    double x = 0.0;
+    double y = 0.0;
+    double z = 0.0;
+    double pitch = 0.0;
+    double roll = 90.0;
+};
+
+/**
+ * @brief Structure-of-arrays batch of Cartesian targets.
+ */
+struct CartesianBatch {
+    std::vector<float> x, y, z, pitch, roll;
+
+    size_t size() const { return x.size(); }
+    void resize(size_t count);
+};
+
+/**
+ * @brief Structure-of-arrays batch of joint solutions, one array per servo.
+ *        reachable[i] is 1 when target i has a solution inside the servo limits.
+ */
+struct JointBatch {
+    std::array<std::vector<float>, 6> angles;
+    std::vector<uint8_t> reachable;
+
+    size_t size() const { return reachable.size(); }
+    void resize(size_t count);
+};
+
+class DofbotKinematics {
+public:
+    /**
+     * @param calibration Profile of the arm, whose joint ranges bound every
+     *        solution (usually Arm_Device::Arm_calibration()).
+     */
+    explicit DofbotKinematics(const ArmGeometry& geometry = ArmGeometry(),
+                              const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    /**
+     * @brief Gripper tip pose for the given servo angles.
+     */
+    CartesianPose forward(const std::array<double, 6>& joints) const;
+
+    /**
+     * @brief Analytic inverse kinematics.
+     * @param joints In: joints[5] is the gripper angle to keep. Out: S1-S6 on success.
+     * @return false if the target is out of reach or needs angles outside the
+     *         calibrated joint ranges; @p joints is untouched then.
+     */
+    bool inverse(const CartesianPose& target, std::array<double, 6>& joints) const;
+
+    /**
+     * @brief Numeric refinement (damped least squares on S1-S4) of a nearby guess.
+     * @return true if the residual ended below 0.1 mm / 0.05 degrees within the limits.
+     */
+    bool refine(const CartesianPose& target, std::array<double, 6>& joints, int iterations = 8) const;
+
+    /**
+     * @brief Solves every target of @p targets at once.
+     *
+     * The loop is branch-free float arithmetic over contiguous arrays with
+     * polynomial atan2/sin/cos instead of libm calls. Both elbow branches are
+     * evaluated and the first one inside the servo limits is kept.
+     * @param gripper Value written to the S6 lane of every solution.
+     * @return Number of reachable targets.
+     */
+    size_t inverse_batch(const CartesianBatch& targets, JointBatch& out, float gripper = 90.0f) const;
+
+    /**
+     * @brief True if every angle is inside the calibrated joint ranges.
+     */
+    bool within_limits(const std::array<double, 6>& joints) const;
+
+    /**
+     * @brief Clamps a solution to the joint ranges and rounds it to whole
+     *        degrees for Arm_serial_servo_write6().
+     */
+    std::array<int, 6> to_servo_angles(const std::array<double, 6>& joints) const;
+
+    const ArmGeometry& geometry() const { return geom; }
+    const std::array<double, 6>& max_angles() const { return max_angle; }
+
+private:
+    ArmGeometry geom;
+    std::array<double, 6> max_angle;   // From the calibration profile, S1 first
+};
+
+#endif // DOFBOT_KINEMATICS_H
@@ -5,6 +5,7 @@
 
 #include "Arm_Lib.h"
 #include "cli_args.h"
+#include "routine.h"
 
 #include <atomic>
 #include <chrono>
@@ -14,6 +15,23 @@
 #include <thread>
 
 namespace {
+    // Elbow and wrist swing out together, the base sweeps right then left, and
+    // the arm returns to its neutral pose before the next pass
+    const char* kSweep = R"(
+pose 90 90 90 90 90 90 500
+wait 1000
+loop
+move 3 0 1000
+move 4 180 1000
+wait 1000
+move 1 180 500
+wait 500
+move 1 0 1000
+wait 1000
+pose 90 90 90 90 90 90 1000
+wait 1500
+)";
+
     std::atomic<bool> g_running(true);
 
     void handle_signal(int signum) {
@@ -21,11 +39,6 @@ namespace {
             g_running = false;
         }
     }
-
-    void reset_pose(Arm_Device& arm) {
-        arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 500);
-        std::this_thread::sleep_for(std::chrono::seconds(1));
-    }
 }
 
 int main(int argc, char* argv[]) {
@@ -36,35 +49,13 @@ int main(int argc, char* argv[]) {
 
     try {
         const CommonArgs args = parse_common_args(argc, argv, description);
-        Arm_Device arm(args.port);
+        Arm_Device arm(args.port, make_arm_options(args));
 
+        const Routine routine = Routine::parse(kSweep, arm.Arm_calibration());
         std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
-        reset_pose(arm);
 
         std::cout << "Running sweep. Press Ctrl+C to stop." << std::endl;
-        while (g_running) {
-            arm.Arm_serial_servo_write(3, 0, 1000);
-            if (!g_running) break;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(4, 180, 1000);
-            if (!g_running) break;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write(1, 180, 500);
-            if (!g_running) break;
-            std::this_thread::sleep_for(std::chrono::milliseconds(500));
-            if (!g_running) break;
-            arm.Arm_serial_servo_write(1, 0, 1000);
-            if (!g_running) break;
-            std::this_thread::sleep_for(std::chrono::seconds(1));
-            if (!g_running) break;
-
-            arm.Arm_serial_servo_write6(90, 90, 90, 90, 90, 90, 1000);
-            if (!g_running) break;
-            std::this_thread::sleep_for(std::chrono::milliseconds(1500));
-        }
+        RoutineExecutor(arm).run(routine, &g_running);
 
         std::cout << "\nProgram closed." << std::endl;
 
@@ -0,0 +1,356 @@
+#include "metrics.h"
+
+#include "Arm_Protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <poll.h>
+#include <sstream>
+#include <stdexcept>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    // Histogram bounds exported to Prometheus, in seconds
+    constexpr std::array<double, 14> kPrometheusBuckets = {
+        50e-6, 100e-6, 250e-6, 500e-6, 1e-3, 2.5e-3, 5e-3, 10e-3, 25e-3, 50e-3, 100e-3, 250e-3, 500e-3, 1.0};
+
+    struct Counter {
+        const char* name;
+        const char* help;
+        uint64_t MetricsSnapshot::*field;
+    };
+
+    const std::array<Counter, 9> kCounters = {{
+        {"bytes_tx", "Bytes written to the serial port", &MetricsSnapshot::bytes_tx},
+        {"bytes_rx", "Bytes read from the serial port", &MetricsSnapshot::bytes_rx},
+        {"frames_tx", "Command frames written", &MetricsSnapshot::frames_tx},
+        {"frames_rx", "Reply frames decoded", &MetricsSnapshot::frames_rx},
+        {"timeouts", "Queries that got no reply in time", &MetricsSnapshot::timeouts},
+        {"retries", "Queries sent a second time", &MetricsSnapshot::retries},
+        {"checksum_errors", "Reply frames dropped for a bad checksum", &MetricsSnapshot::checksum_errors},
+        {"partial_writes", "Writes the port accepted only part of", &MetricsSnapshot::partial_writes},
+        {"write_errors", "Writes that failed", &MetricsSnapshot::write_errors},
+    }};
+
+    std::string format_bound(double seconds) {
+        std::ostringstream text;
+        text << seconds;
+        return text.str();
+    }
+
+    std::string label(const std::string& instance, const std::string& extra = std::string()) {
+        std::string labels;
+        if (!instance.empty()) {
+            labels = "instance=\"" + instance + "\"";
+        }
+        if (!extra.empty()) {
+            labels += (labels.empty() ? "" : ",") + extra;
+        }
+        return labels.empty() ? labels : "{" + labels + "}";
+    }
+
+    void write_prometheus(std::ostream& out, const MetricsSnapshot& snapshot, const std::string& instance) {
+        for (const Counter& counter : kCounters) {
+            out << "# HELP dofbot_" << counter.name << "_total " << counter.help << "\n"
+                << "# TYPE dofbot_" << counter.name << "_total counter\n"
+                << "dofbot_" << counter.name << "_total" << label(instance) << ' ' << snapshot.*counter.field << "\n";
+        }
+        out << "# HELP dofbot_time_to_ready_seconds Time from opening the port to the first handshake reply\n"
+            << "# TYPE dofbot_time_to_ready_seconds gauge\n"
+            << "dofbot_time_to_ready_seconds" << label(instance) << ' '
+            << static_cast<double>(snapshot.time_to_ready_ns) / 1e9 << "\n";
+
+        out << "# HELP dofbot_command_latency_seconds Serial write or query round-trip time per command\n"
+            << "# TYPE dofbot_command_latency_seconds histogram\n";
+        for (std::size_t c = 0; c < METRIC_COMMAND_COUNT; ++c) {
+            const HistogramSnapshot& h = snapshot.latency[c];
+            if (h.count == 0) {
+                continue;
+            }
+            const std::string command = std::string("command=\"") +
+                                        metric_command_name(static_cast<MetricCommand>(c)) + "\"";
+            for (double le : kPrometheusBuckets) {
+                out << "dofbot_command_latency_seconds_bucket"
+                    << label(instance, command + ",le=\"" + format_bound(le) + "\"")
+                    << ' ' << h.count_below(static_cast<uint64_t>(std::llround(le * 1e9))) << "\n";
+            }
+            out << "dofbot_command_latency_seconds_bucket" << label(instance, command + ",le=\"+Inf\"")
+                << ' ' << h.count << "\n"
+                << "dofbot_command_latency_seconds_sum" << label(instance, command) << ' '
+                << static_cast<double>(h.sum_ns) / 1e9 << "\n"
+                << "dofbot_command_latency_seconds_count" << label(instance, command) << ' ' << h.count << "\n";
+        }
+    }
+
+    void write_text(std::ostream& out, const MetricsSnapshot& snapshot) {
+        const std::streamsize precision = out.precision();
+        for (const Counter& counter : kCounters) {
+            out << std::left << std::setw(16) << counter.name << std::right << snapshot.*counter.field << "\n";
+        }
+        out << std::left << std::setw(16) << "time_to_ready_us" << std::right
+            << snapshot.time_to_ready_ns / 1000 << "\n";
+        out << "\n" << std::left << std::setw(9) << "command" << std::right << std::setw(10) << "count"
+            << std::setw(11) << "mean_us" << std::setw(11) << "p50_us" << std::setw(11) << "p99_us"
+            << std::setw(11) << "max_us" << "\n";
+        out << std::fixed << std::setprecision(1);
+        for (std::size_t c = 0; c < METRIC_COMMAND_COUNT; ++c) {
+            const HistogramSnapshot& h = snapshot.latency[c];
+            if (h.count == 0) {
+                continue;
+            }
+            out << std::left << std::setw(9) << metric_command_name(static_cast<MetricCommand>(c)) << std::right
+                << std::setw(10) << h.count << std::setw(11) << h.mean_ns() / 1e3
+                << std::setw(11) << h.percentile_ns(0.50) / 1e3 << std::setw(11) << h.percentile_ns(0.99) / 1e3
+                << std::setw(11) << h.max_ns / 1e3 << "\n";
+        }
+        out.unsetf(std::ios::floatfield);
+        out.precision(precision);
+    }
+
+    // A client that hangs up early must not raise SIGPIPE in the host program
+    void send_all(int fd, const std::string& text) {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+        const int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        const char* data = text.data();
+        std::size_t left = text.size();
+        while (left > 0) {
+            const ssize_t n = ::send(fd, data, left, flags);
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+            if (n <= 0) {
+                return;   // The reader went away; nothing to recover
+            }
+            data += n;
+            left -= static_cast<std::size_t>(n);
+        }
+    }
+}
+
+const char* metric_command_name(MetricCommand command) {
+    switch (command) {
+    case MetricCommand::Write6: return "write6";
+    case MetricCommand::Write: return "write";
+    case MetricCommand::Torque: return "torque";
+    case MetricCommand::Buzzer: return "buzzer";
+    case MetricCommand::Ping: return "ping";
+    case MetricCommand::Read: return "read";
+    case MetricCommand::Read6: return "read6";
+    case MetricCommand::Other: break;
+    }
+    return "other";
+}
+
+MetricCommand metric_command_for(uint8_t cmd) {
+    if (cmd == arm_protocol::CMD_SERVO_WRITE6) {
+        return MetricCommand::Write6;
+    }
+    if (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6) {
+        return MetricCommand::Write;
+    }
+    if (cmd > arm_protocol::CMD_SERVO_READ_BASE && cmd <= arm_protocol::CMD_SERVO_READ_BASE + 6) {
+        return MetricCommand::Read;
+    }
+    switch (cmd) {
+    case arm_protocol::CMD_TORQUE: return MetricCommand::Torque;
+    case arm_protocol::CMD_BUZZER: return MetricCommand::Buzzer;
+    case arm_protocol::CMD_PING: return MetricCommand::Ping;
+    default: return MetricCommand::Other;
+    }
+}
+
+uint64_t HistogramSnapshot::bucket_lower(std::size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket;
+    }
+    const int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+    return static_cast<uint64_t>(SUB_BUCKETS + bucket % SUB_BUCKETS) << shift;
+}
+
+uint64_t HistogramSnapshot::bucket_upper(std::size_t bucket) {
+    if (bucket < SUB_BUCKETS) {
+        return bucket + 1;
+    }
+    const int shift = static_cast<int>(bucket / SUB_BUCKETS) - 1;
+    return bucket_lower(bucket) + (1ull << shift);
+}
+
+uint64_t HistogramSnapshot::percentile_ns(double q) const {
+    if (count == 0) {
+        return 0;
+    }
+    const uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * static_cast<double>(count))));
+    uint64_t seen = 0;
+    for (std::size_t b = 0; b < BUCKETS; ++b) {
+        seen += counts[b];
+        if (seen >= rank) {
+            return std::min(bucket_upper(b), max_ns);
+        }
+    }
+    return max_ns;
+}
+
+uint64_t HistogramSnapshot::count_below(uint64_t ns) const {
+    uint64_t below = 0;
+    for (std::size_t b = 0; b < BUCKETS && bucket_upper(b) <= ns; ++b) {
+        below += counts[b];
+    }
+    return below;
+}
+
+#if DOFBOT_METRICS
+
+void LatencyHistogram::snapshot(HistogramSnapshot& out) const {
+    for (std::size_t b = 0; b < HistogramSnapshot::BUCKETS; ++b) {
+        out.counts[b] = counts[b].load(std::memory_order_relaxed);
+    }
+    out.count = total.load(std::memory_order_relaxed);
+    out.sum_ns = sum.load(std::memory_order_relaxed);
+    out.max_ns = max.load(std::memory_order_relaxed);
+}
+
+MetricsSnapshot MetricsRegistry::snapshot() const {
+    MetricsSnapshot out;
+    out.bytes_tx = bytes_tx.load(std::memory_order_relaxed);
+    out.bytes_rx = bytes_rx.load(std::memory_order_relaxed);
+    out.frames_tx = frames_tx.load(std::memory_order_relaxed);
+    out.frames_rx = frames_rx.load(std::memory_order_relaxed);
+    out.timeouts = timeouts.load(std::memory_order_relaxed);
+    out.retries = retries.load(std::memory_order_relaxed);
+    out.checksum_errors = checksum_errors.load(std::memory_order_relaxed);
+    out.partial_writes = partial_writes.load(std::memory_order_relaxed);
+    out.write_errors = write_errors.load(std::memory_order_relaxed);
+    out.time_to_ready_ns = time_to_ready.load(std::memory_order_relaxed);
+    for (std::size_t c = 0; c < METRIC_COMMAND_COUNT; ++c) {
+        latency[c].snapshot(out.latency[c]);
+    }
+    return out;
+}
+
+#endif // DOFBOT_METRICS
+
+void write_metrics(std::ostream& out, const MetricsSnapshot& snapshot, MetricsFormat format,
+                   const std::string& instance) {
+    if (format == MetricsFormat::Prometheus) {
+        write_prometheus(out, snapshot, instance);
+    } else {
+        write_text(out, snapshot);
+    }
+}
+
+MetricsExporter::MetricsExporter(std::function<MetricsSnapshot()> source, const MetricsExporterOptions& options)
+    : source(std::move(source)), options(options) {
+    if (options.interval.count() <= 0) {
+        throw std::invalid_argument("Metrics export interval must be positive.");
+    }
+    if (pipe(wake_pipe.data()) != 0) {
+        throw std::runtime_error("Failed to create wake-up pipe: " + std::string(strerror(errno)));
+    }
+
+    if (!options.socket_path.empty()) {
+        sockaddr_un addr{};
+        addr.sun_family = AF_UNIX;
+        if (options.socket_path.size() >= sizeof(addr.sun_path)) {
+            close(wake_pipe[0]);
+            close(wake_pipe[1]);
+            throw std::runtime_error("Metrics socket path is too long: " + options.socket_path);
+        }
+        std::strncpy(addr.sun_path, options.socket_path.c_str(), sizeof(addr.sun_path) - 1);
+        ::unlink(options.socket_path.c_str());   // A stale socket from a previous run
+        listen_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listen_fd < 0 || ::bind(listen_fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+            ::listen(listen_fd, 8) != 0) {
+            const std::string error = strerror(errno);
+            if (listen_fd >= 0) {
+                close(listen_fd);
+            }
+            close(wake_pipe[0]);
+            close(wake_pipe[1]);
+            throw std::runtime_error("Failed to listen on metrics socket " + options.socket_path + " - " + error);
+        }
+    }
+
+    thread = std::thread(&MetricsExporter::run, this);
+}
+
+MetricsExporter::~MetricsExporter() {
+    const char byte = 0;
+    if (::write(wake_pipe[1], &byte, 1) < 0) {
+        std::cerr << "Failed to stop the metrics exporter cleanly." << std::endl;
+    }
+    thread.join();
+    export_file();
+    if (listen_fd >= 0) {
+        close(listen_fd);
+        ::unlink(options.socket_path.c_str());
+    }
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+}
+
+std::string MetricsExporter::render() const {
+    std::ostringstream text;
+    write_metrics(text, source(), options.format, options.instance);
+    return text.str();
+}
+
+void MetricsExporter::export_file() const {
+    if (options.file_path.empty()) {
+        return;
+    }
+    // Scrapers never see a half-written file
+    const std::string temp = options.file_path + ".tmp";
+    {
+        std::ofstream file(temp, std::ios::trunc);
+        file << render();
+        if (!file) {
+            std::cerr << "Failed to write metrics file: " << temp << std::endl;
+            return;
+        }
+    }
+    if (std::rename(temp.c_str(), options.file_path.c_str()) != 0) {
+        std::cerr << "Failed to replace metrics file: " << options.file_path << " - " << strerror(errno) << std::endl;
+    }
+}
+
+void MetricsExporter::run() {
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point next_export = Clock::now() + options.interval;
+    for (;;) {
+        const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(next_export - Clock::now());
+        std::array<pollfd, 2> fds = {{{wake_pipe[0], POLLIN, 0}, {listen_fd, POLLIN, 0}}};
+        const int ready = ::poll(fds.data(), listen_fd >= 0 ? 2 : 1,
+                                 static_cast<int>(std::max<int64_t>(0, wait.count())));
+        if (ready < 0 && errno != EINTR) {
+            std::cerr << "Metrics exporter poll error: " << strerror(errno) << std::endl;
+            return;
+        }
+        if (ready > 0 && (fds[0].revents & POLLIN)) {
+            return;
+        }
+        if (ready > 0 && (fds[1].revents & POLLIN)) {
+            const int client = ::accept(listen_fd, nullptr, nullptr);
+            if (client >= 0) {
+                send_all(client, render());
+                close(client);
+            }
+        }
+        if (Clock::now() >= next_export) {
+            export_file();
+            next_export += options.interval;
+        }
+    }
+}
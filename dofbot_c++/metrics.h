@@ -0,0 +1,276 @@
+/**
+ * @file metrics.h
+ * @brief Low-overhead I/O counters and per-command latency histograms.
+ *
+ * Arm_Device owns a MetricsRegistry and updates it from the serial hot path
+ * with relaxed atomic increments only; Arm_metrics() copies it into a
+ * MetricsSnapshot. MetricsExporter periodically renders snapshots as text or
+ * Prometheus exposition into a file and/or serves them on a Unix socket.
+ *
+ * Latency means the write() call for motion, torque and buzzer commands, and
+ * query-to-reply (or timeout) for pings and reads.
+ *
+ * Building with DOFBOT_METRICS=0 (CMake option DOFBOT_METRICS=OFF) turns the
+ * registry into an empty type whose methods compile away, so the hot path
+ * does not even read the clock; snapshots are then all zero.
+ */
+
+#ifndef DOFBOT_METRICS_H
+#define DOFBOT_METRICS_H
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+
+#ifndef DOFBOT_METRICS
+#define DOFBOT_METRICS 1
+#endif
+
+enum class MetricCommand : uint8_t { Write6, Write, Torque, Buzzer, Ping, Read, Read6, Other };
+
+constexpr std::size_t METRIC_COMMAND_COUNT = 8;
+
+/**
+ * @brief Lower-case name of @p command, as used in exported labels.
+ */
+const char* metric_command_name(MetricCommand command);
+
+/**
+ * @brief Command type of the frame whose command byte is @p cmd.
+ */
+MetricCommand metric_command_for(uint8_t cmd);
+
+/**
+ * @brief Copy of a LatencyHistogram. Values are nanoseconds.
+ */
+struct HistogramSnapshot {
+    // 16 linear sub-buckets per power of two: any value is off by at most 1/16
+    static constexpr int SUB_BUCKET_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static constexpr int MAX_BITS = 40;   // Values are clamped below 2^40 ns (~18 minutes)
+    static constexpr std::size_t BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    std::array<uint64_t, BUCKETS> counts{};
+    uint64_t count = 0;
+    uint64_t sum_ns = 0;
+    uint64_t max_ns = 0;
+
+    static std::size_t bucket_for(uint64_t ns) {
+        if (ns >= (1ull << MAX_BITS)) {
+            ns = (1ull << MAX_BITS) - 1;
+        }
+        if (ns < SUB_BUCKETS) {
+            return static_cast<std::size_t>(ns);
+        }
+#if defined(__GNUC__) || defined(__clang__)
+        const int top = 63 - __builtin_clzll(ns);
+#else
+        int top = MAX_BITS - 1;
+        while (!(ns >> top)) {
+            --top;
+        }
+#endif
+        const int shift = top - SUB_BUCKET_BITS;
+        return static_cast<std::size_t>((shift + 1) * SUB_BUCKETS) + ((ns >> shift) & (SUB_BUCKETS - 1));
+    }
+    static uint64_t bucket_lower(std::size_t bucket);
+    static uint64_t bucket_upper(std::size_t bucket);  // Exclusive
+
+    double mean_ns() const { return count == 0 ? 0.0 : static_cast<double>(sum_ns) / count; }
+
+    /**
+     * @brief Upper bound of the bucket holding quantile @p q (0-1); 0 when empty.
+     */
+    uint64_t percentile_ns(double q) const;
+
+    /**
+     * @brief Samples below @p ns, counting whole buckets only.
+     */
+    uint64_t count_below(uint64_t ns) const;
+};
+
+struct MetricsSnapshot {
+    uint64_t bytes_tx = 0;
+    uint64_t bytes_rx = 0;
+    uint64_t frames_tx = 0;
+    uint64_t frames_rx = 0;
+    uint64_t timeouts = 0;        // Queries that got no reply before their deadline
+    uint64_t retries = 0;         // Queries sent a second time
+    uint64_t checksum_errors = 0; // Reply frames dropped for a bad checksum
+    uint64_t partial_writes = 0;  // write() calls that took fewer bytes than offered
+    uint64_t write_errors = 0;    // write() calls that failed outright
+    uint64_t time_to_ready_ns = 0; // Open to first handshake reply; 0 if skipped or unanswered
+    std::array<HistogramSnapshot, METRIC_COMMAND_COUNT> latency;
+
+    const HistogramSnapshot& latency_of(MetricCommand command) const {
+        return latency[static_cast<std::size_t>(command)];
+    }
+};
+
+#if DOFBOT_METRICS
+
+class LatencyHistogram {
+public:
+    void record(uint64_t ns) {
+        counts[HistogramSnapshot::bucket_for(ns)].fetch_add(1, std::memory_order_relaxed);
+        total.fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(ns, std::memory_order_relaxed);
+        uint64_t seen = max.load(std::memory_order_relaxed);
+        while (ns > seen && !max.compare_exchange_weak(seen, ns, std::memory_order_relaxed)) {
+        }
+    }
+
+    void snapshot(HistogramSnapshot& out) const;
+
+private:
+    std::array<std::atomic<uint64_t>, HistogramSnapshot::BUCKETS> counts{};
+    std::atomic<uint64_t> total{0};
+    std::atomic<uint64_t> sum{0};
+    std::atomic<uint64_t> max{0};
+};
+
+class MetricsRegistry {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Counts the bytes of one write() and the complete frames among them.
+     */
+    void add_tx(const uint8_t* data, std::size_t len) {
+        std::size_t frames = 0;
+        for (std::size_t offset = 0; offset + 3 <= len;) {
+            const std::size_t frame_len = static_cast<std::size_t>(data[offset + 2]) + 2;
+            if (offset + frame_len > len) {
+                break;
+            }
+            ++frames;
+            offset += frame_len;
+        }
+        bytes_tx.fetch_add(len, std::memory_order_relaxed);
+        frames_tx.fetch_add(frames, std::memory_order_relaxed);
+    }
+    void add_rx(std::size_t bytes) { bytes_rx.fetch_add(bytes, std::memory_order_relaxed); }
+    void add_frame_rx() { frames_rx.fetch_add(1, std::memory_order_relaxed); }
+    void add_timeout() { timeouts.fetch_add(1, std::memory_order_relaxed); }
+    void add_retry() { retries.fetch_add(1, std::memory_order_relaxed); }
+    void add_checksum_errors(uint64_t n) { checksum_errors.fetch_add(n, std::memory_order_relaxed); }
+    void add_partial_write() { partial_writes.fetch_add(1, std::memory_order_relaxed); }
+    void add_write_error() { write_errors.fetch_add(1, std::memory_order_relaxed); }
+    void set_time_to_ready(uint64_t ns) { time_to_ready.store(ns, std::memory_order_relaxed); }
+
+    Clock::time_point start() const { return Clock::now(); }
+    void record_latency(MetricCommand command, Clock::time_point started) {
+        const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - started);
+        latency[static_cast<std::size_t>(command)].record(static_cast<uint64_t>(elapsed.count()));
+    }
+
+    /**
+     * @brief Records the write() of a command frame; queries are timed by
+     *        their caller up to the reply instead.
+     */
+    void record_write(const uint8_t* frame, Clock::time_point started) {
+        const MetricCommand command = metric_command_for(frame[3]);
+        if (command != MetricCommand::Ping && command != MetricCommand::Read) {
+            record_latency(command, started);
+        }
+    }
+
+    MetricsSnapshot snapshot() const;
+
+private:
+    std::atomic<uint64_t> bytes_tx{0};
+    std::atomic<uint64_t> bytes_rx{0};
+    std::atomic<uint64_t> frames_tx{0};
+    std::atomic<uint64_t> frames_rx{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> retries{0};
+    std::atomic<uint64_t> checksum_errors{0};
+    std::atomic<uint64_t> partial_writes{0};
+    std::atomic<uint64_t> write_errors{0};
+    std::atomic<uint64_t> time_to_ready{0};
+    std::array<LatencyHistogram, METRIC_COMMAND_COUNT> latency;
+};
+
+#else
+
+class MetricsRegistry {
+public:
+    struct Clock {
+        struct time_point {};
+    };
+
+    void add_tx(const uint8_t*, std::size_t) {}
+    void add_rx(std::size_t) {}
+    void add_frame_rx() {}
+    void add_timeout() {}
+    void add_retry() {}
+    void add_checksum_errors(uint64_t) {}
+    void add_partial_write() {}
+    void add_write_error() {}
+    void set_time_to_ready(uint64_t) {}
+
+    Clock::time_point start() const { return {}; }
+    void record_latency(MetricCommand, Clock::time_point) {}
+    void record_write(const uint8_t*, Clock::time_point) {}
+
+    MetricsSnapshot snapshot() const { return MetricsSnapshot(); }
+};
+
+#endif // DOFBOT_METRICS
+
+enum class MetricsFormat : uint8_t {
+    Text,       // Human-readable summary
+    Prometheus  // Prometheus text exposition format 0.0.4
+};
+
+/**
+ * @brief Writes @p snapshot in @p format. @p instance labels every Prometheus
+ *        sample (e.g. the serial port), so several arms can share a scrape.
+ */
+void write_metrics(std::ostream& out, const MetricsSnapshot& snapshot, MetricsFormat format,
+                   const std::string& instance = std::string());
+
+struct MetricsExporterOptions {
+    std::string file_path;      // Rewritten atomically (write + rename) every interval
+    std::string socket_path;    // Unix stream socket; each connection gets one snapshot
+    MetricsFormat format = MetricsFormat::Prometheus;
+    std::chrono::milliseconds interval{1000};
+    std::string instance;
+};
+
+class MetricsExporter {
+public:
+    /**
+     * @brief Starts the exporter thread, which calls @p source for every export.
+     * @throws std::invalid_argument if the interval is not positive.
+     * @throws std::runtime_error if the socket cannot be created.
+     */
+    MetricsExporter(std::function<MetricsSnapshot()> source, const MetricsExporterOptions& options);
+
+    /**
+     * @brief Writes the file one last time, then stops the thread and removes the socket.
+     */
+    ~MetricsExporter();
+
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+private:
+    std::function<MetricsSnapshot()> source;
+    MetricsExporterOptions options;
+    int listen_fd = -1;
+    std::array<int, 2> wake_pipe{{-1, -1}};
+    std::thread thread;
+
+    void run();
+    std::string render() const;
+    void export_file() const;
+};
+
+#endif // DOFBOT_METRICS_H
@@ -0,0 +1,210 @@
+#include "motion_capture.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+namespace {
+    constexpr char kMagic[8] = {'D', 'O', 'F', 'C', 'A', 'P', 'T', 0};
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kByteOrder = 0x01020304;
+    // Longest uninterrupted sleep, so a cancelled replay stops promptly
+    constexpr auto kMaxSleep = std::chrono::milliseconds(50);
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint64_t wall_start_ns;
+        uint64_t reserved;
+    };
+    static_assert(sizeof(FileHeader) == 32, "Capture file header must stay 32 bytes");
+
+    void write_all(int fd, const uint8_t* data, std::size_t len) {
+        while (len > 0) {
+            const ssize_t n = ::write(fd, data, len);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                throw std::runtime_error("Serial write error: " + std::string(strerror(errno)));
+            }
+            data += n;
+            len -= static_cast<std::size_t>(n);
+        }
+    }
+
+    // Rewrites the move time of a motion frame and fixes up its checksum
+    void scale_move_time(CapturedFrame& frame, double speed) {
+        const std::size_t time_at = frame.len - 3;
+        const unsigned int time = (frame.bytes[time_at] << 8) | frame.bytes[time_at + 1];
+        const long scaled = std::lround(time / speed);
+        const unsigned int clamped = static_cast<unsigned int>(std::min(std::max(scaled, 0L), 0xFFFFL));
+        frame.bytes[time_at] = arm_protocol::high_byte(clamped);
+        frame.bytes[time_at + 1] = arm_protocol::low_byte(clamped);
+        frame.bytes[frame.len - 1] = arm_protocol::checksum(frame.bytes.data(), frame.len - 1);
+    }
+}
+
+bool CapturedFrame::is_motion() const {
+    const uint8_t cmd = command();
+    return cmd == arm_protocol::CMD_SERVO_WRITE6 ||
+           (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6);
+}
+
+bool CapturedFrame::is_query() const {
+    const uint8_t cmd = command();
+    return cmd == arm_protocol::CMD_PING ||
+           (cmd > arm_protocol::CMD_SERVO_READ_BASE && cmd <= arm_protocol::CMD_SERVO_READ_BASE + 6);
+}
+
+FrameRecorder::FrameRecorder(const std::string& path)
+    : path(path), start(std::chrono::steady_clock::now()) {
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) {
+        throw std::runtime_error("Failed to create capture file: " + path + " - " + strerror(errno));
+    }
+    // Large stdio buffer: a routine's worth of frames is written in a handful of syscalls
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 16);
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.wall_start_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    if (std::fwrite(&header, sizeof(header), 1, file) != 1) {
+        std::fclose(file);
+        throw std::runtime_error("Failed to write capture file: " + path);
+    }
+}
+
+FrameRecorder::~FrameRecorder() {
+    if (std::fclose(file) != 0 && !failed) {
+        std::cerr << "Failed to finish capture file: " << path << std::endl;
+    }
+}
+
+void FrameRecorder::record(const uint8_t* data, std::size_t len) {
+    if (failed) {
+        return;
+    }
+    const uint64_t time_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+
+    // Split the write into frames by their length byte; a batch of reads is several frames
+    std::size_t offset = 0;
+    while (offset + 3 <= len) {
+        const std::size_t frame_len = static_cast<std::size_t>(data[offset + 2]) + 2;
+        if (frame_len > arm_protocol::MAX_FRAME_SIZE || offset + frame_len > len) {
+            break;
+        }
+        const uint8_t size = static_cast<uint8_t>(frame_len);
+        if (std::fwrite(&time_ns, sizeof(time_ns), 1, file) != 1 ||
+            std::fwrite(&size, 1, 1, file) != 1 ||
+            std::fwrite(data + offset, 1, frame_len, file) != frame_len) {
+            std::cerr << "Failed to write capture file: " << path << "; capture stopped." << std::endl;
+            failed = true;
+            return;
+        }
+        ++frame_count;
+        offset += frame_len;
+    }
+}
+
+FrameCapture FrameCapture::load(const std::string& path) {
+    std::FILE* file = std::fopen(path.c_str(), "rb");
+    if (!file) {
+        throw std::runtime_error("Failed to open capture file: " + path + " - " + strerror(errno));
+    }
+
+    FileHeader header;
+    if (std::fread(&header, sizeof(header), 1, file) != 1 ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 ||
+        header.version != kVersion || header.byte_order != kByteOrder) {
+        std::fclose(file);
+        throw std::runtime_error("Not a valid capture file (or recorded on another byte order): " + path);
+    }
+
+    FrameCapture capture;
+    CapturedFrame frame;
+    // A record cut short by a crash ends the capture
+    while (std::fread(&frame.time_ns, sizeof(frame.time_ns), 1, file) == 1 &&
+           std::fread(&frame.len, 1, 1, file) == 1) {
+        if (frame.len < 5 || frame.len > arm_protocol::MAX_FRAME_SIZE ||
+            std::fread(frame.bytes.data(), 1, frame.len, file) != frame.len) {
+            break;
+        }
+        capture.captured.push_back(frame);
+    }
+    std::fclose(file);
+    return capture;
+}
+
+ReplayReport replay_capture(int fd, const FrameCapture& capture, const ReplayOptions& options,
+                            const std::atomic<bool>* keep_running) {
+    if (!(options.speed > 0.0)) {
+        throw std::invalid_argument("Replay speed must be positive.");
+    }
+
+    using Clock = std::chrono::steady_clock;
+    ReplayReport report;
+    const std::vector<CapturedFrame>& frames = capture.frames();
+    std::array<uint8_t, 16 * arm_protocol::MAX_FRAME_SIZE> batch{};
+    double lateness_sum_us = 0.0;
+    uint64_t wakeups = 0;
+
+    const Clock::time_point start = Clock::now();
+    std::size_t next = 0;
+    while (next < frames.size()) {
+        const auto offset = std::chrono::nanoseconds(
+            static_cast<int64_t>(static_cast<double>(frames[next].time_ns) / options.speed));
+        const Clock::time_point deadline = start + std::chrono::duration_cast<Clock::duration>(offset);
+
+        // Absolute deadlines: a late frame never delays the ones after it
+        for (;;) {
+            if (keep_running && !keep_running->load()) {
+                return report;
+            }
+            const Clock::time_point now = Clock::now();
+            if (now >= deadline) {
+                break;
+            }
+            std::this_thread::sleep_until(std::min(deadline, now + kMaxSleep));
+        }
+        const double lateness_us =
+            std::chrono::duration<double, std::micro>(Clock::now() - deadline).count();
+        lateness_sum_us += lateness_us;
+        report.max_lateness_us = std::max(report.max_lateness_us, lateness_us);
+        ++wakeups;
+
+        // Everything recorded at this timestamp goes out in a single write
+        std::size_t batch_len = 0;
+        const uint64_t due_ns = frames[next].time_ns;
+        while (next < frames.size() && frames[next].time_ns == due_ns &&
+               batch_len + frames[next].len <= batch.size()) {
+            CapturedFrame frame = frames[next++];
+            if (frame.is_query() && !options.include_queries) {
+                ++report.frames_skipped;
+                continue;
+            }
+            if (frame.is_motion() && options.scale_move_time && options.speed != 1.0) {
+                scale_move_time(frame, options.speed);
+            }
+            std::copy(frame.bytes.begin(), frame.bytes.begin() + frame.len, batch.begin() + batch_len);
+            batch_len += frame.len;
+            ++report.frames_sent;
+        }
+        write_all(fd, batch.data(), batch_len);
+    }
+
+    if (wakeups > 0) {
+        report.mean_lateness_us = lateness_sum_us / static_cast<double>(wakeups);
+    }
+    return report;
+}
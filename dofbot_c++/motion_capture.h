@@ -0,0 +1,122 @@
+/**
+ * @file motion_capture.h
+ * @brief Records every command frame sent to the board and replays it on schedule.
+ *
+ * Arm_Device hands each write to a FrameRecorder when Arm_Options::capture_path
+ * is set, so any demo run becomes a capture file. replay_capture() re-emits
+ * the frames on absolute deadlines measured from the start of the replay,
+ * optionally faster or slower than recorded.
+ *
+ * File layout (native byte order): a 32-byte header, then one record per
+ * frame: uint64 nanoseconds since the capture started, uint8 frame length,
+ * the frame bytes.
+ */
+
+#ifndef DOFBOT_MOTION_CAPTURE_H
+#define DOFBOT_MOTION_CAPTURE_H
+
+#include "Arm_Protocol.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+/**
+ * @brief One command frame and the time it was written.
+ */
+struct CapturedFrame {
+    uint64_t time_ns = 0;   // Since the capture started
+    uint8_t len = 0;
+    std::array<uint8_t, arm_protocol::MAX_FRAME_SIZE> bytes{};
+
+    uint8_t command() const { return bytes[3]; }
+
+    /**
+     * @brief True for write6 and per-joint writes, the frames that carry a move time.
+     */
+    bool is_motion() const;
+
+    /**
+     * @brief True for reads and pings, which only make sense with someone listening.
+     */
+    bool is_query() const;
+};
+
+class FrameRecorder {
+public:
+    /**
+     * @brief Creates (truncates) @p path and writes the header.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    explicit FrameRecorder(const std::string& path);
+    ~FrameRecorder();
+
+    FrameRecorder(const FrameRecorder&) = delete;
+    FrameRecorder& operator=(const FrameRecorder&) = delete;
+
+    /**
+     * @brief Records the frames in one write to the port; @p data may hold
+     *        several back-to-back frames. Not thread-safe: call it from the
+     *        thread that owns the port.
+     */
+    void record(const uint8_t* data, std::size_t len);
+
+    uint64_t frames() const { return frame_count; }
+
+private:
+    std::FILE* file = nullptr;
+    std::string path;
+    std::chrono::steady_clock::time_point start;
+    uint64_t frame_count = 0;
+    bool failed = false;
+};
+
+class FrameCapture {
+public:
+    /**
+     * @brief Reads a capture file into memory.
+     * @throws std::runtime_error if the file cannot be read or is not a capture.
+     */
+    static FrameCapture load(const std::string& path);
+
+    const std::vector<CapturedFrame>& frames() const { return captured; }
+    bool empty() const { return captured.empty(); }
+
+    /**
+     * @brief Time of the last frame, in nanoseconds.
+     */
+    uint64_t duration_ns() const { return captured.empty() ? 0 : captured.back().time_ns; }
+
+private:
+    std::vector<CapturedFrame> captured;
+};
+
+struct ReplayOptions {
+    double speed = 1.0;             // 2.0 replays twice as fast
+    bool include_queries = false;   // Also resend reads and pings
+    bool scale_move_time = true;    // Divide move times by speed so poses keep pace with the schedule
+};
+
+struct ReplayReport {
+    uint64_t frames_sent = 0;
+    uint64_t frames_skipped = 0;    // Queries left out by include_queries = false
+    double mean_lateness_us = 0.0;
+    double max_lateness_us = 0.0;
+};
+
+/**
+ * @brief Writes the frames of @p capture to @p fd on their (scaled) timestamps
+ *        until the capture ends or @p keep_running turns false. Frames due at
+ *        the same time go out in one write.
+ * @throws std::invalid_argument if the speed is not positive.
+ * @throws std::runtime_error on a serial write error.
+ */
+ReplayReport replay_capture(int fd, const FrameCapture& capture, const ReplayOptions& options = ReplayOptions(),
+                            const std::atomic<bool>* keep_running = nullptr);
+
+#endif // DOFBOT_MOTION_CAPTURE_H
@@ -0,0 +1,110 @@
+/**
+ * @file mpsc_ring.h
+ * @brief Bounded lock-free ring buffer for handing work to a single consumer thread.
+ *
+ * Based on Dmitry Vyukov's bounded MPMC queue: every slot carries a sequence
+ * number that tells producers and the consumer whether the slot is free or
+ * holds a value, so push and pop are a single CAS on the happy path and never
+ * allocate once the ring is constructed.
+ */
+
+#ifndef DOFBOT_MPSC_RING_H
+#define DOFBOT_MPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+template <typename T>
+class MpscRing {
+public:
+    /**
+     * @brief Creates a ring with room for at least @p capacity elements
+     *        (rounded up to a power of two, minimum 2).
+     */
+    explicit MpscRing(std::size_t capacity)
+        : mask_(round_up_pow2(capacity) - 1),
+          cells_(new Cell[mask_ + 1]) {
+        for (std::size_t i = 0; i <= mask_; ++i) {
+            cells_[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    MpscRing(const MpscRing&) = delete;
+    MpscRing& operator=(const MpscRing&) = delete;
+
+    /**
+     * @brief Pushes a value from any thread.
+     * @return false if the ring is full; @p value is left untouched.
+     */
+    bool try_push(T& value) {
+        std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+        for (;;) {
+            Cell& cell = cells_[pos & mask_];
+            const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+            const std::ptrdiff_t diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+            if (diff == 0) {
+                if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    cell.value = std::move(value);
+                    cell.sequence.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = enqueue_pos_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * @brief Pops the oldest value. Must only be called from the consumer thread.
+     * @return false if the ring is empty.
+     */
+    bool try_pop(T& value) {
+        const std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        Cell& cell = cells_[pos & mask_];
+        const std::size_t seq = cell.sequence.load(std::memory_order_acquire);
+        if (static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1) < 0) {
+            return false;
+        }
+        dequeue_pos_.store(pos + 1, std::memory_order_relaxed);
+        value = std::move(cell.value);
+        cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief True if no value is waiting. Exact only on the consumer thread.
+     */
+    bool empty() const {
+        const std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+        const std::size_t seq = cells_[pos & mask_].sequence.load(std::memory_order_acquire);
+        return seq != pos + 1;
+    }
+
+    std::size_t capacity() const { return mask_ + 1; }
+
+private:
+    struct Cell {
+        std::atomic<std::size_t> sequence{0};
+        T value{};
+    };
+
+    static std::size_t round_up_pow2(std::size_t value) {
+        std::size_t result = 2;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    const std::size_t mask_;
+    std::unique_ptr<Cell[]> cells_;
+    // Producers and the consumer touch different indices; keep them on separate lines
+    alignas(64) std::atomic<std::size_t> enqueue_pos_{0};
+    alignas(64) std::atomic<std::size_t> dequeue_pos_{0};
+};
+
+#endif // DOFBOT_MPSC_RING_H
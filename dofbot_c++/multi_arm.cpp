@@ -0,0 +1,706 @@
+#include "multi_arm.h"
+
+#include "frame_decoder.h"
+#include "mpsc_ring.h"
+#include "serial_port.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <poll.h>
+#include <stdexcept>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <sys/epoll.h>
+#define DOFBOT_HAVE_EPOLL 1
+#endif
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Longest the destructor keeps serving queued work before giving up on a stuck port
+    constexpr auto kShutdownGrace = std::chrono::seconds(1);
+
+    // Motion slot layout: MOTION_PENDING | MOTION_GROUP | position << 16 | time
+    constexpr uint64_t MOTION_PENDING = 1ull << 63;
+    constexpr uint64_t MOTION_GROUP = 1ull << 62;
+
+    bool is_motion(uint8_t cmd) {
+        return cmd == arm_protocol::CMD_SERVO_WRITE6 ||
+               (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6);
+    }
+
+    void validate_angle(const CalibrationProfile& calibration, int id, int angle) {
+        if (id < 1 || id > 6) {
+            throw std::out_of_range("Servo ID must be between 1 and 6.");
+        }
+        if (!calibration.contains(id, angle)) {
+            throw std::out_of_range("Angle parameter is out of range.");
+        }
+    }
+
+    arm_protocol::Frame<19> encode_pose(const CalibrationProfile& calibration, const std::array<int, 6>& angles,
+                                        int time) {
+        for (int i = 0; i < 6; ++i) {
+            validate_angle(calibration, i + 1, angles[i]);
+        }
+        const auto pos = [&](int id) { return calibration.angle_to_position(id, angles[id - 1]); };
+        return arm_protocol::encode_servo_write6(pos(1), pos(2), pos(3), pos(4), pos(5), pos(6),
+                                                 static_cast<uint16_t>(time));
+    }
+}
+
+// One group_write6 call, shared by the command it queues on each arm; loop thread only
+struct MultiArmController::GroupTick {
+    std::size_t members = 0;
+    std::size_t arrived = 0;   // Members whose frame reached the head of their queue
+    std::size_t settled = 0;   // Members whose frame was sent or given up on
+    std::vector<std::size_t> missed;
+    std::promise<std::vector<std::size_t>> done;
+};
+
+struct MultiArmController::Command {
+    enum class Kind : uint8_t { Write, Read, Ping, Barrier, Group };
+
+    Kind kind = Kind::Write;
+    uint8_t len = 0;
+    std::array<uint8_t, arm_protocol::MAX_FRAME_SIZE> bytes{};
+    int id = 0;
+    std::unique_ptr<std::promise<int>> reply;
+    std::shared_ptr<GroupTick> group;
+
+    template <std::size_t N>
+    void set_frame(const arm_protocol::Frame<N>& frame) {
+        static_assert(N <= arm_protocol::MAX_FRAME_SIZE, "frame does not fit a command");
+        std::copy(frame.bytes.begin(), frame.bytes.end(), bytes.begin());
+        len = static_cast<uint8_t>(N);
+    }
+
+    // Value a request resolves to when no reply arrives
+    int failure_value() const { return kind == Kind::Read ? -1 : 0; }
+};
+
+struct MultiArmController::Arm {
+    Arm(std::size_t index, std::size_t capacity, const CalibrationProfile& calibration)
+        : index(index), calibration(calibration), queue(capacity) {}
+
+    const std::size_t index;
+    const CalibrationProfile calibration;
+    std::string port;
+    int fd = -1;
+    bool hung_up = false;  // Port gone; everything for this arm now fails at once
+    MpscRing<Command> queue;
+    arm_protocol::FrameDecoder decoder;
+
+    // Encoded bytes waiting for the port to accept them
+    std::array<uint8_t, 1024> tx{};
+    std::size_t tx_len = 0;
+    bool write_interest = false;
+
+    // Popped from the queue but blocked behind the request in flight, or a
+    // group frame waiting for the other arms of its tick (at_group)
+    Command held;
+    bool has_held = false;
+    bool at_group = false;
+
+    Command inflight;
+    bool awaiting = false;
+    Clock::time_point deadline;
+
+    // flush() callers, released once everything before them has hit the port
+    std::vector<std::unique_ptr<std::promise<int>>> barriers;
+
+    // Latest-value slots, one per joint, for moves that found the queue full;
+    // bit (id - 1) of motion_mask is set while joint id has a target waiting
+    std::array<std::atomic<uint64_t>, 6> motion{};
+    std::atomic<uint32_t> motion_mask{0};
+
+    std::atomic<uint64_t> frames_sent{0};
+    std::atomic<uint64_t> replies{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> dropped{0};
+
+    bool idle() const {
+        return !awaiting && !has_held && tx_len == 0 && barriers.empty() && queue.empty() && motion_mask.load() == 0;
+    }
+
+    /**
+     * @brief Posts the targets of an encoded motion frame to the motion slots.
+     */
+    void overflow_motion(const uint8_t* frame) {
+        const auto word = [frame](int offset) { return static_cast<uint64_t>((frame[offset] << 8) | frame[offset + 1]); };
+        const auto post = [this](int id, uint64_t packed) {
+            if (motion[id - 1].exchange(MOTION_PENDING | packed) & MOTION_PENDING) {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+            }
+        };
+        if (frame[3] == arm_protocol::CMD_SERVO_WRITE6) {
+            for (int id = 1; id <= 6; ++id) {
+                post(id, MOTION_GROUP | (word(2 + 2 * id) << 16) | word(16));
+            }
+            motion_mask.fetch_or(0x3F);
+        } else {
+            const int id = frame[3] - arm_protocol::CMD_SERVO_WRITE_BASE;
+            post(id, (word(4) << 16) | word(6));
+            motion_mask.fetch_or(1u << (id - 1));
+        }
+    }
+};
+
+MultiArmController::MultiArmController(const std::vector<std::string>& ports, const MultiArmOptions& options)
+    : options(options) {
+    try {
+        if (pipe(wake_pipe.data()) != 0) {
+            throw std::runtime_error("Failed to create wake-up pipe: " + std::string(strerror(errno)));
+        }
+        for (int fd : wake_pipe) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK);
+        }
+
+        for (const std::string& path : ports) {
+            const std::size_t index = arms.size();
+            std::unique_ptr<Arm> arm(new Arm(index, options.queue_capacity, index < options.calibrations.size()
+                                                                        ? options.calibrations[index]
+                                                                        : DEFAULT_CALIBRATION));
+            arm->port = path;
+            arm->fd = open_serial_port(path, true);
+            arms.push_back(std::move(arm));
+        }
+
+#if defined(DOFBOT_HAVE_EPOLL)
+        poll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (poll_fd < 0) {
+            throw std::runtime_error("epoll_create1 failed: " + std::string(strerror(errno)));
+        }
+        for (std::size_t i = 0; i <= arms.size(); ++i) {
+            epoll_event event{};
+            event.events = EPOLLIN;
+            event.data.u64 = i; // arms.size() is the wake-up pipe
+            const int fd = (i == arms.size()) ? wake_pipe[0] : arms[i]->fd;
+            if (epoll_ctl(poll_fd, EPOLL_CTL_ADD, fd, &event) != 0) {
+                throw std::runtime_error("epoll_ctl failed: " + std::string(strerror(errno)));
+            }
+        }
+#endif
+    } catch (...) {
+        for (const auto& arm : arms) {
+            close(arm->fd);
+        }
+        for (int fd : {wake_pipe[0], wake_pipe[1], poll_fd}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+        throw;
+    }
+
+    loop = std::thread(&MultiArmController::run, this);
+}
+
+MultiArmController::~MultiArmController() {
+    // The loop finishes what is queued (bounded by kShutdownGrace) before it exits
+    stop = true;
+    wake();
+    loop.join();
+    for (const auto& arm : arms) {
+        close(arm->fd);
+    }
+    close(wake_pipe[0]);
+    close(wake_pipe[1]);
+    if (poll_fd >= 0) {
+        close(poll_fd);
+    }
+}
+
+const std::string& MultiArmController::port(std::size_t arm) const {
+    return arm_at(arm).port;
+}
+
+MultiArmController::Arm& MultiArmController::arm_at(std::size_t arm) const {
+    if (arm >= arms.size()) {
+        throw std::out_of_range("Arm index is out of range.");
+    }
+    return *arms[arm];
+}
+
+void MultiArmController::submit(std::size_t index, Command& command) {
+    Arm& arm = arm_at(index);
+    if (command.kind == Command::Kind::Write && is_motion(command.bytes[3])) {
+        // Once one target has overflowed, later ones must not overtake it through the queue
+        if (arm.motion_mask.load() != 0 || !arm.queue.try_push(command)) {
+            arm.overflow_motion(command.bytes.data());
+        }
+    } else {
+        // State changes and requests are never dropped, and never overtake overflowed motion
+        while (arm.motion_mask.load() != 0 || !arm.queue.try_push(command)) {
+            std::this_thread::yield();
+        }
+    }
+    wake();
+}
+
+void MultiArmController::wake() {
+    // One byte in the pipe is enough; the loop clears the flag before it drains the queues
+    if (!wake_pending.exchange(true)) {
+        const uint8_t byte = 1;
+        if (::write(wake_pipe[1], &byte, 1) < 0 && errno != EAGAIN) {
+            std::cerr << "MultiArmController wake-up failed: " << strerror(errno) << std::endl;
+        }
+    }
+}
+
+void MultiArmController::write6(std::size_t arm, const std::array<int, 6>& angles, int time) {
+    Command command;
+    command.set_frame(encode_pose(arm_at(arm).calibration, angles, time));
+    submit(arm, command);
+}
+
+void MultiArmController::write(std::size_t arm, int id, int angle, int time) {
+    const CalibrationProfile& calibration = arm_at(arm).calibration;
+    validate_angle(calibration, id, angle);
+    Command command;
+    command.set_frame(arm_protocol::encode_servo_write(static_cast<uint8_t>(id),
+                                                      calibration.angle_to_position(id, angle),
+                                                      static_cast<uint16_t>(time)));
+    submit(arm, command);
+}
+
+void MultiArmController::set_torque(std::size_t arm, bool enable) {
+    Command command;
+    command.set_frame(arm_protocol::encode_torque(enable));
+    submit(arm, command);
+}
+
+std::future<int> MultiArmController::read(std::size_t arm, int id) {
+    if (id < 1 || id > 6) {
+        throw std::out_of_range("Servo ID must be between 1 and 6.");
+    }
+    Command command;
+    command.kind = Command::Kind::Read;
+    command.id = id;
+    command.set_frame(arm_protocol::encode_servo_read(static_cast<uint8_t>(id)));
+    command.reply.reset(new std::promise<int>());
+    std::future<int> result = command.reply->get_future();
+    submit(arm, command);
+    return result;
+}
+
+std::future<int> MultiArmController::ping(std::size_t arm, int id) {
+    if (id < 1 || id > 250) {
+        throw std::out_of_range("Servo ID must be between 1 and 250.");
+    }
+    Command command;
+    command.kind = Command::Kind::Ping;
+    command.id = id;
+    command.set_frame(arm_protocol::encode_ping(static_cast<uint8_t>(id)));
+    command.reply.reset(new std::promise<int>());
+    std::future<int> result = command.reply->get_future();
+    submit(arm, command);
+    return result;
+}
+
+std::vector<std::size_t> MultiArmController::group_write6(const std::vector<GroupTarget>& targets, int time) {
+    if (targets.empty()) {
+        return {};
+    }
+    // Encode (and validate) everything before any arm is touched
+    std::shared_ptr<GroupTick> tick = std::make_shared<GroupTick>();
+    tick->members = targets.size();
+    std::vector<Command> commands(targets.size());
+    std::vector<bool> listed(arms.size(), false);
+    for (std::size_t i = 0; i < targets.size(); ++i) {
+        const std::size_t arm = targets[i].arm;
+        commands[i].set_frame(encode_pose(arm_at(arm).calibration, targets[i].angles, time));
+        if (listed[arm]) {
+            throw std::invalid_argument("An arm may appear only once in a group move.");
+        }
+        listed[arm] = true;
+        commands[i].kind = Command::Kind::Group;
+        commands[i].group = tick;
+    }
+    std::future<std::vector<std::size_t>> done = tick->done.get_future();
+    {
+        // Ticks reach every arm in the same order, so no two wait on each other
+        std::lock_guard<std::mutex> lock(group_mutex);
+        for (std::size_t i = 0; i < targets.size(); ++i) {
+            submit(targets[i].arm, commands[i]);
+        }
+    }
+    return done.get();
+}
+
+void MultiArmController::flush() {
+    std::vector<std::future<int>> pending;
+    for (std::size_t i = 0; i < arms.size(); ++i) {
+        Command command;
+        command.kind = Command::Kind::Barrier;
+        command.reply.reset(new std::promise<int>());
+        pending.push_back(command.reply->get_future());
+        submit(i, command);
+    }
+    for (std::future<int>& barrier : pending) {
+        barrier.wait();
+    }
+}
+
+MultiArmStats MultiArmController::stats(std::size_t index) const {
+    const Arm& arm = arm_at(index);
+    MultiArmStats snapshot;
+    snapshot.frames_sent = arm.frames_sent.load(std::memory_order_relaxed);
+    snapshot.replies = arm.replies.load(std::memory_order_relaxed);
+    snapshot.timeouts = arm.timeouts.load(std::memory_order_relaxed);
+    snapshot.dropped = arm.dropped.load(std::memory_order_relaxed);
+    return snapshot;
+}
+
+void MultiArmController::set_write_interest(Arm& arm, bool enabled) {
+    if (arm.write_interest == enabled) {
+        return;
+    }
+    arm.write_interest = enabled;
+#if defined(DOFBOT_HAVE_EPOLL)
+    epoll_event event{};
+    event.events = EPOLLIN | (enabled ? EPOLLOUT : 0);
+    event.data.u64 = arm.index;
+    epoll_ctl(poll_fd, EPOLL_CTL_MOD, arm.fd, &event);
+#endif
+}
+
+void MultiArmController::handle_readable(Arm& arm) {
+    for (;;) {
+        const ssize_t n = ::read(arm.fd, arm.decoder.write_ptr(), arm.decoder.write_space());
+        if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+            hang_up(arm); // EIO once a USB adapter is unplugged
+        }
+        if (n <= 0) {
+            break;
+        }
+        arm.decoder.commit(static_cast<std::size_t>(n));
+
+        uint8_t ext_type = 0;
+        arm_protocol::PayloadView payload;
+        while (arm.decoder.next(ext_type, payload)) {
+            if (!arm.awaiting) {
+                continue; // Late reply to a request that already timed out
+            }
+            Command& request = arm.inflight;
+            int value = 0;
+            if (request.kind == Command::Kind::Read) {
+                // Replies echo the query id (0x31-0x36) in their third data byte
+                if (ext_type != arm_protocol::REPLY_SERVO || payload.size < 3 ||
+                    payload[2] != arm_protocol::CMD_SERVO_READ_BASE + request.id) {
+                    continue;
+                }
+                const uint16_t pos = static_cast<uint16_t>((payload[0] << 8) | payload[1]);
+                value = arm.calibration.position_to_angle(request.id, pos);
+            } else {
+                // Anything else on the wire (a stray read reply, noise) is not the ping's answer
+                if (ext_type != arm_protocol::CMD_PING || payload.empty()) {
+                    continue;
+                }
+                value = payload[0];
+            }
+            request.reply->set_value(value);
+            request.reply.reset();
+            arm.awaiting = false;
+            arm.replies.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+}
+
+void MultiArmController::hang_up(Arm& arm) {
+    if (arm.hung_up) {
+        return;
+    }
+    std::cerr << "MultiArmController lost " << arm.port << "; failing its pending commands" << std::endl;
+    arm.hung_up = true;
+#if defined(DOFBOT_HAVE_EPOLL)
+    // Level-triggered HUP/ERR would otherwise wake the loop forever
+    epoll_ctl(poll_fd, EPOLL_CTL_DEL, arm.fd, nullptr);
+#endif
+    arm.write_interest = false;
+    arm.tx_len = 0;
+    expire(arm, true);
+}
+
+void MultiArmController::expire(Arm& arm, bool abandon) {
+    if (arm.awaiting && (abandon || Clock::now() >= arm.deadline)) {
+        arm.inflight.reply->set_value(arm.inflight.failure_value());
+        arm.inflight.reply.reset();
+        arm.awaiting = false;
+        arm.timeouts.fetch_add(1, std::memory_order_relaxed);
+    }
+    if (!abandon) {
+        return;
+    }
+    // Nothing will reach the port after this: fail whatever is still waiting
+    while (arm.has_held || arm.queue.try_pop(arm.held)) {
+        if (arm.held.group) {
+            settle_group(arm, false);
+        } else if (arm.held.reply) {
+            arm.held.reply->set_value(arm.held.failure_value());
+            arm.held.reply.reset();
+        } else {
+            arm.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+        arm.has_held = false;
+    }
+    const uint32_t mask = arm.motion_mask.exchange(0);
+    for (int i = 0; i < 6; ++i) {
+        if ((mask & (1u << i)) && (arm.motion[i].exchange(0) & MOTION_PENDING)) {
+            arm.dropped.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    for (auto& barrier : arm.barriers) {
+        barrier->set_value(0);
+    }
+    arm.barriers.clear();
+}
+
+void MultiArmController::pump_queue(Arm& arm) {
+    if (arm.hung_up) {
+        expire(arm, true);
+        return;
+    }
+    for (;;) {
+        if (!arm.has_held) {
+            if (!arm.queue.try_pop(arm.held)) {
+                // Overflowed motion was posted after everything the queue held
+                if (arm.motion_mask.load() != 0) {
+                    flush_motion(arm);
+                }
+                return;
+            }
+            arm.has_held = true;
+        }
+        Command& command = arm.held;
+
+        if (command.kind == Command::Kind::Barrier) {
+            if (arm.awaiting) {
+                return;
+            }
+            arm.barriers.push_back(std::move(command.reply));
+            arm.has_held = false;
+            continue;
+        }
+        if (command.kind == Command::Kind::Group) {
+            if (!arm.at_group) {
+                arm.at_group = true;
+                ++command.group->arrived;
+            }
+            return; // Sent with the rest of its tick by release_groups()
+        }
+        if (command.kind != Command::Kind::Write && arm.awaiting) {
+            return; // One request in flight per arm
+        }
+        if (arm.tx_len + command.len > arm.tx.size()) {
+            return; // Port is backed up; retry once it drains
+        }
+
+        std::copy(command.bytes.begin(), command.bytes.begin() + command.len, arm.tx.begin() + arm.tx_len);
+        arm.tx_len += command.len;
+        arm.frames_sent.fetch_add(1, std::memory_order_relaxed);
+        if (command.kind != Command::Kind::Write) {
+            arm.inflight = std::move(command);
+            arm.awaiting = true;
+            arm.deadline = Clock::now() + std::chrono::milliseconds(options.reply_timeout_ms);
+        }
+        arm.has_held = false;
+    }
+}
+
+void MultiArmController::settle_group(Arm& arm, bool sent) {
+    GroupTick& tick = *arm.held.group;
+    if (!arm.at_group) {
+        ++tick.arrived; // Given up on before it reached the head of the queue
+    }
+    if (!sent) {
+        tick.missed.push_back(arm.index);
+    }
+    if (++tick.settled == tick.members) {
+        tick.done.set_value(tick.missed);
+    }
+    arm.held.group.reset();
+    arm.at_group = false;
+    arm.has_held = false;
+}
+
+void MultiArmController::release_groups() {
+    // Every member is waiting at its tick, so each frame goes out in this pass
+    for (const auto& entry : arms) {
+        Arm& arm = *entry;
+        if (!arm.at_group || arm.held.group->arrived < arm.held.group->members) {
+            continue;
+        }
+        const bool fits = arm.tx_len + arm.held.len <= arm.tx.size();
+        if (fits) {
+            std::copy(arm.held.bytes.begin(), arm.held.bytes.begin() + arm.held.len, arm.tx.begin() + arm.tx_len);
+            arm.tx_len += arm.held.len;
+            arm.frames_sent.fetch_add(1, std::memory_order_relaxed);
+        }
+        settle_group(arm, fits);
+    }
+}
+
+void MultiArmController::flush_motion(Arm& arm) {
+    if (arm.tx_len + 6 * arm_protocol::MAX_FRAME_SIZE > arm.tx.size()) {
+        return; // Port is backed up; the slots keep only the newest targets meanwhile
+    }
+    const uint32_t mask = arm.motion_mask.exchange(0);
+    std::array<uint64_t, 6> slots{};
+    for (int i = 0; i < 6; ++i) {
+        if (mask & (1u << i)) {
+            slots[i] = arm.motion[i].exchange(0);
+        }
+    }
+
+    const auto append = [&arm](const uint8_t* bytes, std::size_t len) {
+        std::copy(bytes, bytes + len, arm.tx.begin() + arm.tx_len);
+        arm.tx_len += len;
+        arm.frames_sent.fetch_add(1, std::memory_order_relaxed);
+    };
+    const auto pos = [&slots](int i) { return static_cast<uint16_t>(slots[i] >> 16); };
+    const auto time = [&slots](int i) { return static_cast<uint16_t>(slots[i] & 0xFFFF); };
+
+    // A complete write6 that nothing has partially overwritten goes out as one frame
+    const uint64_t group_bits = MOTION_PENDING | MOTION_GROUP;
+    bool whole_group = true;
+    for (int i = 0; i < 6; ++i) {
+        if ((slots[i] & group_bits) != group_bits || time(i) != time(0)) {
+            whole_group = false;
+            break;
+        }
+    }
+    if (whole_group) {
+        const auto frame = arm_protocol::encode_servo_write6(pos(0), pos(1), pos(2), pos(3), pos(4), pos(5), time(0));
+        append(frame.bytes.data(), frame.size());
+        return;
+    }
+    for (int i = 0; i < 6; ++i) {
+        if (slots[i] & MOTION_PENDING) {
+            const auto frame = arm_protocol::encode_servo_write(static_cast<uint8_t>(i + 1), pos(i), time(i));
+            append(frame.bytes.data(), frame.size());
+        }
+    }
+}
+
+void MultiArmController::flush_tx(Arm& arm) {
+    while (arm.tx_len > 0) {
+        const ssize_t n = ::write(arm.fd, arm.tx.data(), arm.tx_len);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                set_write_interest(arm, true);
+                return;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            std::cerr << "MultiArmController write error on " << arm.port << ": " << strerror(errno) << std::endl;
+            arm.tx_len = 0;
+            break;
+        }
+        std::memmove(arm.tx.data(), arm.tx.data() + n, arm.tx_len - static_cast<std::size_t>(n));
+        arm.tx_len -= static_cast<std::size_t>(n);
+    }
+    set_write_interest(arm, false);
+    for (auto& barrier : arm.barriers) {
+        barrier->set_value(0);
+    }
+    arm.barriers.clear();
+}
+
+void MultiArmController::run() {
+#if defined(DOFBOT_HAVE_EPOLL)
+    std::vector<epoll_event> events(arms.size() + 1);
+#else
+    std::vector<pollfd> fds(arms.size() + 1);
+#endif
+    Clock::time_point stop_deadline = Clock::time_point::max();
+
+    for (;;) {
+        // Sleep until I/O, a wake-up or the earliest reply deadline
+        int timeout_ms = 100;
+        const Clock::time_point now = Clock::now();
+        for (const auto& arm : arms) {
+            if (arm->awaiting) {
+                const auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(arm->deadline - now).count() + 1;
+                timeout_ms = std::max(0, std::min(timeout_ms, static_cast<int>(wait)));
+            }
+        }
+
+#if defined(DOFBOT_HAVE_EPOLL)
+        const int ready = epoll_wait(poll_fd, events.data(), static_cast<int>(events.size()), timeout_ms);
+        for (int i = 0; i < ready; ++i) {
+            const std::size_t index = static_cast<std::size_t>(events[i].data.u64);
+            if (index == arms.size()) {
+                continue; // Wake-up pipe; drained below
+            }
+            Arm& arm = *arms[index];
+            if (events[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP)) {
+                handle_readable(arm); // Keep whatever arrived before the hang-up
+            }
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                hang_up(arm);
+            } else if (events[i].events & EPOLLOUT) {
+                flush_tx(arm);
+            }
+        }
+#else
+        for (std::size_t i = 0; i < arms.size(); ++i) {
+            // poll() skips negative descriptors, so a hung-up port stops waking the loop
+            fds[i] = {arms[i]->hung_up ? -1 : arms[i]->fd,
+                      static_cast<short>(POLLIN | (arms[i]->write_interest ? POLLOUT : 0)), 0};
+        }
+        fds[arms.size()] = {wake_pipe[0], POLLIN, 0};
+        const int ready = poll(fds.data(), fds.size(), timeout_ms);
+        for (std::size_t i = 0; ready > 0 && i < arms.size(); ++i) {
+            if (fds[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+                handle_readable(*arms[i]);
+            }
+            if (fds[i].revents & (POLLERR | POLLHUP | POLLNVAL)) {
+                hang_up(*arms[i]);
+            } else if (fds[i].revents & POLLOUT) {
+                flush_tx(*arms[i]);
+            }
+        }
+#endif
+
+        // Clear the flag before looking at the queues so no push goes unnoticed
+        if (wake_pending.exchange(false)) {
+            uint8_t sink[64];
+            while (::read(wake_pipe[0], sink, sizeof(sink)) > 0) {
+            }
+        }
+
+        for (const auto& arm : arms) {
+            expire(*arm, false);
+            pump_queue(*arm);
+        }
+        // Group frames whose tick every member has reached go out together,
+        // behind whatever each arm had queued before them
+        release_groups();
+
+        bool all_idle = true;
+        for (const auto& arm : arms) {
+            pump_queue(*arm);
+            flush_tx(*arm);
+            all_idle = all_idle && arm->idle();
+        }
+
+        if (stop.load()) {
+            if (stop_deadline == Clock::time_point::max()) {
+                stop_deadline = Clock::now() + kShutdownGrace;
+            }
+            if (all_idle || Clock::now() >= stop_deadline) {
+                for (const auto& arm : arms) {
+                    expire(*arm, true);
+                }
+                return;
+            }
+        }
+    }
+}
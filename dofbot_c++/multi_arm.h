@@ -0,0 +1,150 @@
+/**
+ * @file multi_arm.h
+ * @brief One event loop driving many DOFBOT boards from a single thread.
+ *
+ * Each arm gets a lock-free command queue that any thread may fill; the loop
+ * thread multiplexes every port with epoll (poll() where epoll is missing),
+ * writes frames non-blocking, parses replies with a per-arm FrameDecoder and
+ * completes the matching futures. Only 0x0A replies carry an id, so each arm
+ * has at most one read or ping in flight; writes keep flowing meanwhile, but
+ * nothing queued behind a second request overtakes it. A port that hangs up
+ * is dropped from the loop, and from then on requests for that arm fail at
+ * once with their usual no-reply value.
+ */
+
+#ifndef DOFBOT_MULTI_ARM_H
+#define DOFBOT_MULTI_ARM_H
+
+#include "Arm_Protocol.h"
+#include "calibration.h"
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct MultiArmOptions {
+    std::size_t queue_capacity = 64;  // Commands buffered per arm
+    unsigned int reply_timeout_ms = 200;
+    // Angle/position mapping per arm (index = arm number); arms past the end
+    // use DEFAULT_CALIBRATION
+    std::vector<CalibrationProfile> calibrations;
+};
+
+struct MultiArmStats {
+    uint64_t frames_sent = 0;
+    uint64_t replies = 0;
+    uint64_t timeouts = 0;
+    uint64_t dropped = 0;   // Writes never sent: replaced by a newer target, or the port was lost
+};
+
+/**
+ * @brief One arm's share of a synchronised group move.
+ */
+struct GroupTarget {
+    std::size_t arm = 0;
+    std::array<int, 6> angles{};
+};
+
+class MultiArmController {
+public:
+    /**
+     * @brief Opens every port in @p ports (index = arm number) and starts the loop thread.
+     * @throws std::runtime_error if a port cannot be opened; ports opened so far are closed.
+     */
+    explicit MultiArmController(const std::vector<std::string>& ports,
+                                const MultiArmOptions& options = MultiArmOptions());
+    ~MultiArmController();
+
+    MultiArmController(const MultiArmController&) = delete;
+    MultiArmController& operator=(const MultiArmController&) = delete;
+
+    std::size_t size() const { return arms.size(); }
+    const std::string& port(std::size_t arm) const;
+
+    /**
+     * @brief Queues a six-servo move for @p arm. Angles are validated like
+     *        Arm_serial_servo_write6 (std::out_of_range). While the arm's
+     *        queue is full, moves go to per-joint slots that keep only the
+     *        newest target, so a producer never blocks on motion.
+     */
+    void write6(std::size_t arm, const std::array<int, 6>& angles, int time);
+
+    /**
+     * @brief Queues a single-servo move for @p arm; see write6().
+     */
+    void write(std::size_t arm, int id, int angle, int time);
+
+    /**
+     * @brief Queues a torque change for @p arm. Like every command that is
+     *        not a move, it waits for queue room rather than being dropped.
+     */
+    void set_torque(std::size_t arm, bool enable);
+
+    /**
+     * @brief Reads servo @p id of @p arm; the future yields the angle or -1.
+     */
+    std::future<int> read(std::size_t arm, int id);
+
+    /**
+     * @brief Pings servo @p id of @p arm; the future yields the response byte or 0.
+     */
+    std::future<int> ping(std::size_t arm, int id);
+
+    /**
+     * @brief Moves every listed arm in the same loop iteration. Each frame
+     *        queues behind what its arm already has queued; once every listed
+     *        arm has reached it, all frames are written back-to-back. Blocks
+     *        until then.
+     * @return The arms that did not get their frame (port backed up, or
+     *         the controller shutting down); empty when all did.
+     * @throws std::invalid_argument if an arm is listed twice, std::out_of_range
+     *         for a bad arm index or angle (nothing is sent then).
+     */
+    std::vector<std::size_t> group_write6(const std::vector<GroupTarget>& targets, int time);
+
+    /**
+     * @brief Blocks until every command queued so far has been written and
+     *        every outstanding reply has arrived or timed out.
+     */
+    void flush();
+
+    MultiArmStats stats(std::size_t arm) const;
+
+private:
+    struct GroupTick;
+    struct Command;
+    struct Arm;
+
+    MultiArmOptions options;
+    std::vector<std::unique_ptr<Arm>> arms;
+    int poll_fd = -1;                 // epoll instance (Linux only)
+    std::array<int, 2> wake_pipe{{-1, -1}};
+    std::atomic<bool> stop{false};
+    std::atomic<bool> wake_pending{false};
+    std::thread loop;
+
+    std::mutex group_mutex;  // Serialises group_write6 submissions
+
+    Arm& arm_at(std::size_t arm) const;
+    void submit(std::size_t arm, Command& command);
+    void wake();
+    void run();
+    void handle_readable(Arm& arm);
+    void pump_queue(Arm& arm);
+    void flush_motion(Arm& arm);
+    void release_groups();
+    void settle_group(Arm& arm, bool sent);
+    void flush_tx(Arm& arm);
+    void set_write_interest(Arm& arm, bool enabled);
+    void expire(Arm& arm, bool abandon);
+    void hang_up(Arm& arm);
+};
+
+#endif // DOFBOT_MULTI_ARM_H
@@ -0,0 +1,79 @@
+#include "pose_snapshot.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    constexpr uint32_t kSegmentMagic = 0x444F4642;   // "DOFB"
+
+    // Precedes the payload, which starts on the next cache line
+    struct SegmentHeader {
+        uint32_t magic;
+        uint32_t layout;
+        uint64_t size;
+    };
+
+    static_assert(sizeof(SegmentHeader) <= CACHE_LINE_SIZE, "header must fit before the payload");
+}
+
+SharedMemory::SharedMemory(const std::string& name, std::size_t size, uint32_t layout, Mode mode)
+    : segment_name(name), mapped_size(CACHE_LINE_SIZE + size), owner(mode == Mode::Create) {
+    int fd = -1;
+    if (owner) {
+        shm_unlink(name.c_str());   // A stale segment from a process that crashed
+        fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd >= 0 && ftruncate(fd, static_cast<off_t>(mapped_size)) != 0) {
+            const int error = errno;
+            close(fd);
+            shm_unlink(name.c_str());
+            fd = -1;
+            errno = error;
+        }
+    } else {
+        fd = shm_open(name.c_str(), O_RDONLY, 0);
+        struct stat info{};
+        if (fd >= 0 && (fstat(fd, &info) != 0 || info.st_size < static_cast<off_t>(mapped_size))) {
+            close(fd);
+            throw std::runtime_error("Shared memory " + name + " is too small for the expected layout");
+        }
+    }
+    if (fd < 0) {
+        throw std::runtime_error("Failed to " + std::string(owner ? "create" : "open") + " shared memory " +
+                                 name + ": " + strerror(errno));
+    }
+
+    base = mmap(nullptr, mapped_size, owner ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0);
+    const int error = errno;
+    close(fd);
+    if (base == MAP_FAILED) {
+        if (owner) {
+            shm_unlink(name.c_str());
+        }
+        throw std::runtime_error("Failed to map shared memory " + name + ": " + strerror(error));
+    }
+    payload = static_cast<char*>(base) + CACHE_LINE_SIZE;
+
+    SegmentHeader* header = static_cast<SegmentHeader*>(base);
+    if (owner) {
+        *header = {kSegmentMagic, layout, size};
+    } else if (header->magic != kSegmentMagic || header->layout != layout || header->size != size) {
+        munmap(base, mapped_size);
+        throw std::runtime_error("Shared memory " + name + " holds a different layout");
+    }
+}
+
+SharedMemory::~SharedMemory() {
+    munmap(base, mapped_size);
+    if (owner) {
+        shm_unlink(segment_name.c_str());
+    }
+}
+
+SharedPoseReader::SharedPoseReader(const std::string& name)
+    : memory(name, sizeof(PoseSnapshot), POSE_SNAPSHOT_LAYOUT, SharedMemory::Mode::ReadOnly) {
+}
@@ -0,0 +1,214 @@
+/**
+ * @file pose_snapshot.h
+ * @brief Seqlock-protected joint pose that many threads or processes can read
+ *        without touching the serial link.
+ *
+ * Arm_Device keeps its latest commanded and measured angles in a
+ * PoseSnapshot: every motion command updates the commanded side, every
+ * successful read the measured side. Readers copy the whole 6-joint state out
+ * with plain loads and never block the writer; a read only retries if it
+ * overlapped an update, which takes a few dozen nanoseconds.
+ *
+ * SeqLock stores its value as relaxed atomic words and needs no pointers or
+ * process-local state, so it works unchanged inside a SharedMemory segment:
+ * set Arm_Options::pose_shm_name and any process can map the pose with
+ * SharedPoseReader.
+ */
+
+#ifndef DOFBOT_POSE_SNAPSHOT_H
+#define DOFBOT_POSE_SNAPSHOT_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+
+/**
+ * @brief A trivially copyable T behind a sequence counter. Writers, in any
+ *        thread or process, exclude each other by making the counter odd;
+ *        readers never write to shared memory.
+ */
+template <typename T>
+class alignas(CACHE_LINE_SIZE) SeqLock {
+    static_assert(std::is_trivially_copyable<T>::value, "SeqLock needs a trivially copyable value");
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "SeqLock words must be lock-free to work across processes");
+
+public:
+    explicit SeqLock(const T& initial = T()) {
+        std::array<uint64_t, WORDS> raw{};
+        std::memcpy(raw.data(), &initial, sizeof(T));
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            words[i].store(raw[i], std::memory_order_relaxed);
+        }
+    }
+
+    SeqLock(const SeqLock&) = delete;
+    SeqLock& operator=(const SeqLock&) = delete;
+
+    /**
+     * @brief Applies @p fn to the current value in place, as one update readers see atomically.
+     */
+    template <typename Fn>
+    void update(Fn&& fn) {
+        uint32_t sequence = lock();
+        T value = unlocked_value();
+        fn(value);
+        std::array<uint64_t, WORDS> raw{};
+        std::memcpy(raw.data(), &value, sizeof(T));
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            words[i].store(raw[i], std::memory_order_relaxed);
+        }
+        counter.store(sequence + 2, std::memory_order_release);
+    }
+
+    void store(const T& value) {
+        update([&value](T& current) { current = value; });
+    }
+
+    /**
+     * @brief One attempt at a consistent copy.
+     * @return false if an update was in progress or overlapped the copy.
+     */
+    bool try_load(T& out) const {
+        const uint32_t before = counter.load(std::memory_order_acquire);
+        if (before & 1u) {
+            return false;
+        }
+        std::array<uint64_t, WORDS> raw;
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            raw[i] = words[i].load(std::memory_order_relaxed);
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (counter.load(std::memory_order_relaxed) != before) {
+            return false;
+        }
+        std::memcpy(&out, raw.data(), sizeof(T));
+        return true;
+    }
+
+    /**
+     * @brief A consistent copy; spins only while an update is in progress.
+     */
+    T load() const {
+        T value;
+        while (!try_load(value)) {
+        }
+        return value;
+    }
+
+    /**
+     * @brief Number of completed updates, to spot changes without copying.
+     */
+    uint32_t version() const { return counter.load(std::memory_order_acquire) / 2; }
+
+private:
+    static constexpr std::size_t WORDS = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    std::atomic<uint32_t> counter{0};   // Odd while an update is in progress
+    std::array<std::atomic<uint64_t>, WORDS> words{};
+
+    uint32_t lock() {
+        uint32_t sequence = counter.load(std::memory_order_relaxed);
+        for (;;) {
+            if (!(sequence & 1u) &&
+                counter.compare_exchange_weak(sequence, sequence + 1, std::memory_order_acquire)) {
+                break;
+            }
+            if (sequence & 1u) {
+                std::this_thread::yield();
+                sequence = counter.load(std::memory_order_relaxed);
+            }
+        }
+        // Readers must see the odd counter before any of the new words
+        std::atomic_thread_fence(std::memory_order_release);
+        return sequence;
+    }
+
+    // Only valid while holding the lock
+    T unlocked_value() const {
+        std::array<uint64_t, WORDS> raw;
+        for (std::size_t i = 0; i < WORDS; ++i) {
+            raw[i] = words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        std::memcpy(&value, raw.data(), sizeof(T));
+        return value;
+    }
+};
+
+/**
+ * @brief Latest commanded and measured angles of the six joints, -1 where
+ *        unknown. Times are steady_clock nanoseconds (CLOCK_MONOTONIC on
+ *        Linux, so they compare across processes); 0 means never.
+ */
+struct ArmPose {
+    std::array<double, 6> commanded = {-1.0, -1.0, -1.0, -1.0, -1.0, -1.0}; // Angle of the position sent
+    std::array<double, 6> measured = {-1.0, -1.0, -1.0, -1.0, -1.0, -1.0};
+    int64_t commanded_ns = 0;
+    int64_t measured_ns = 0;
+};
+
+using PoseSnapshot = SeqLock<ArmPose>;
+
+/**
+ * @brief Layout tag of a shared PoseSnapshot.
+ */
+constexpr uint32_t POSE_SNAPSHOT_LAYOUT = 0x504F5301;   // "POS" v1
+
+/**
+ * @brief A named POSIX shared-memory segment holding one object of @p size
+ *        bytes, cache-line aligned. The creator removes the name again.
+ */
+class SharedMemory {
+public:
+    enum class Mode {
+        Create,    // Replace any stale segment of that name; mapped read/write, zero-filled
+        ReadOnly   // Map an existing segment
+    };
+
+    /**
+     * @param layout Tag checked when opening, so readers refuse a segment of another type or version.
+     * @throws std::runtime_error if the segment cannot be created or opened,
+     *         or holds a different layout.
+     */
+    SharedMemory(const std::string& name, std::size_t size, uint32_t layout, Mode mode);
+    ~SharedMemory();
+
+    SharedMemory(const SharedMemory&) = delete;
+    SharedMemory& operator=(const SharedMemory&) = delete;
+
+    void* data() const { return payload; }
+    const std::string& name() const { return segment_name; }
+
+private:
+    std::string segment_name;
+    std::size_t mapped_size = 0;
+    bool owner = false;
+    void* base = nullptr;
+    void* payload = nullptr;
+};
+
+/**
+ * @brief Maps the PoseSnapshot an Arm_Device publishes under Arm_Options::pose_shm_name.
+ */
+class SharedPoseReader {
+public:
+    /**
+     * @throws std::runtime_error if nothing is published under @p name.
+     */
+    explicit SharedPoseReader(const std::string& name);
+
+    ArmPose read() const { return snapshot().load(); }
+    const PoseSnapshot& snapshot() const { return *static_cast<const PoseSnapshot*>(memory.data()); }
+
+private:
+    SharedMemory memory;
+};
+
+#endif // DOFBOT_POSE_SNAPSHOT_H
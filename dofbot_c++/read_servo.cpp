@@ -1,19 +1,32 @@
 /**
  * @file read_servo.cpp
- * @brief Continuously reads and prints all servo angles.
+ * @brief Continuously reads and prints all servo angles, optionally logging every sample.
  */
 
 #include "Arm_Lib.h"
 #include "cli_args.h"
+#include "telemetry.h"
 
+#include <array>
 #include <atomic>
 #include <chrono>
 #include <csignal>
 #include <exception>
 #include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
 #include <thread>
+#include <vector>
 
 namespace {
+    const char* kUsageSuffix =
+        "\nAdditional parameters:\n"
+        "  --log PATH          Sample as fast as the link allows and record every read to a\n"
+        "                      binary telemetry log (inspect it with telemetry_dump).";
+
+    constexpr auto kPrintInterval = std::chrono::milliseconds(100);
+
     std::atomic<bool> g_running(true);
 
     void handle_signal(int signum) {
@@ -25,24 +38,72 @@ namespace {
 
 int main(int argc, char* argv[]) {
     const std::string description =
-        "Poll servos 1-6, printing their ping response and reported angles.";
+        "Poll servos 1-6, printing their ping response and reported angles." + std::string(kUsageSuffix);
 
     std::signal(SIGINT, handle_signal);
 
     try {
-        const CommonArgs args = parse_common_args(argc, argv, description);
-        Arm_Device arm(args.port);
+        std::vector<std::string> extra_args;
+        const CommonArgs args = parse_common_args(argc, argv, description, &extra_args);
+
+        std::string log_path;
+        for (size_t i = 0; i < extra_args.size(); ++i) {
+            const std::string& token = extra_args[i];
+            if (token == "--log" && i + 1 < extra_args.size()) {
+                log_path = extra_args[++i];
+            } else if (token.rfind("--log=", 0) == 0) {
+                log_path = token.substr(6);
+            } else {
+                std::cerr << "Unrecognized argument: " << token << '\n';
+                return 1;
+            }
+        }
+
+        Arm_Options options = make_arm_options(args);
+        // Torque is re-asserted every pass; only the first one needs to reach the board
+        options.suppress_redundant = true;
+        Arm_Device arm(args.port, options);
+        std::unique_ptr<TelemetryWriter> log;
+        if (!log_path.empty()) {
+            log.reset(new TelemetryWriter(log_path));
+        }
 
         std::this_thread::sleep_for(std::chrono::duration<double>(args.init_delay));
 
+        auto next_print = std::chrono::steady_clock::now();
         while (g_running) {
+            if (!log) {
+                std::this_thread::sleep_until(next_print);
+            }
+
+            // One pipelined exchange for the whole arm instead of six round-trips
+            const auto started = std::chrono::steady_clock::now();
+            const Arm_ServoReadings readings = arm.Arm_serial_servo_read6();
+            const auto finished = std::chrono::steady_clock::now();
+            if (log) {
+                log->record(readings, started, finished);
+            }
+
+            if (finished < next_print) {
+                continue; // Only while logging: keep sampling between printouts
+            }
+            next_print = finished + kPrintInterval;
+
+            std::array<int, 6> pings{};
             for (int id = 1; id <= 6 && g_running; ++id) {
-                const int ping = arm.Arm_ping_servo(id);
+                pings[id - 1] = arm.Arm_ping_servo(id);
                 arm.Arm_serial_set_torque(1);
-                const int angle = arm.Arm_serial_servo_read(id);
-                std::cout << "Servo " << id << " ping: " << ping << ", angle: " << angle << "°" << std::endl;
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
             }
+            if (!g_running) break;
+
+            for (int id = 1; id <= 6; ++id) {
+                std::cout << "Servo " << id << " ping: " << pings[id - 1]
+                          << ", angle: " << readings.angles[id - 1] << "°\n";
+            }
+            if (log) {
+                std::cout << "Logged " << log->written() << " samples (" << log->dropped() << " dropped)\n";
+            }
+            std::cout.flush();
         }
 
         std::cout << "\nProgram closed." << std::endl;
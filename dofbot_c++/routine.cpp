@@ -0,0 +1,339 @@
+#include "routine.h"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+    using Clock = std::chrono::steady_clock;
+
+    // Longest uninterrupted sleep, so a cancelled routine stops promptly
+    constexpr auto kMaxSleep = std::chrono::milliseconds(50);
+
+    void validate_angle(const std::array<double, 6>& max_angle, int id, int angle) {
+        if (id < 1 || id > 6) {
+            throw std::out_of_range("Servo ID must be between 1 and 6.");
+        }
+        if (angle < 0 || angle > max_angle[id - 1]) {
+            throw std::out_of_range("Servo " + std::to_string(id) + " angle must be between 0 and " +
+                                    std::to_string(static_cast<int>(max_angle[id - 1])) + ".");
+        }
+    }
+
+    void validate_time(int time_ms) {
+        if (time_ms < 0 || time_ms > std::numeric_limits<uint16_t>::max()) {
+            throw std::out_of_range("Move time must be between 0 and 65535 ms.");
+        }
+    }
+
+    int read_int(std::istringstream& in, const char* what) {
+        int value = 0;
+        if (!(in >> value)) {
+            throw std::invalid_argument(std::string("expected ") + what);
+        }
+        return value;
+    }
+
+    // Sleeps until @p deadline; false if @p keep_running turned false first
+    bool wait_until(Clock::time_point deadline, const std::atomic<bool>* keep_running) {
+        for (;;) {
+            if (keep_running && !keep_running->load()) {
+                return false;
+            }
+            const Clock::time_point now = Clock::now();
+            if (now >= deadline) {
+                return true;
+            }
+            std::this_thread::sleep_until(std::min(deadline, now + kMaxSleep));
+        }
+    }
+}
+
+Routine::Routine(const CalibrationProfile& calibration) : max_angle(calibration.max_angles()) {}
+
+Routine Routine::parse(const std::string& text, const CalibrationProfile& calibration) {
+    Routine routine(calibration);
+    std::istringstream lines(text);
+    std::string line;
+    int number = 0;
+
+    while (std::getline(lines, line)) {
+        ++number;
+        const std::size_t comment = line.find('#');
+        if (comment != std::string::npos) {
+            line.erase(comment);
+        }
+        std::istringstream in(line);
+        std::string command;
+        if (!(in >> command)) {
+            continue;
+        }
+
+        try {
+            if (command == "pose") {
+                std::array<int, 6> angles{};
+                for (int& angle : angles) {
+                    angle = read_int(in, "six angles and a move time");
+                }
+                routine.pose(angles, read_int(in, "six angles and a move time"));
+            } else if (command == "move") {
+                const int id = read_int(in, "servo id, angle and move time");
+                const int angle = read_int(in, "servo id, angle and move time");
+                routine.move(id, angle, read_int(in, "servo id, angle and move time"));
+            } else if (command == "wait") {
+                routine.wait(read_int(in, "milliseconds"));
+            } else if (command == "torque") {
+                std::string state;
+                in >> state;
+                if (state != "on" && state != "off") {
+                    throw std::invalid_argument("expected on or off");
+                }
+                routine.torque(state == "on");
+            } else if (command == "beep") {
+                routine.beep(read_int(in, "buzzer delay"));
+            } else if (command == "echo") {
+                std::string message;
+                std::getline(in >> std::ws, message);
+                routine.echo(message);
+                continue;
+            } else if (command == "loop") {
+                routine.loop();
+            } else {
+                throw std::invalid_argument("unknown command '" + command + "'");
+            }
+
+            std::string extra;
+            if (in >> extra) {
+                throw std::invalid_argument("unexpected '" + extra + "'");
+            }
+        } catch (const std::exception& e) {
+            throw std::invalid_argument("Routine line " + std::to_string(number) + ": " + e.what());
+        }
+    }
+    return routine;
+}
+
+Routine Routine::load(const std::string& path, const CalibrationProfile& calibration) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Failed to open routine: " + path);
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    return parse(text.str(), calibration);
+}
+
+void Routine::add_move(uint8_t joints, const std::array<int, 6>& angles, int time_ms) {
+    validate_time(time_ms);
+
+    // Fold into the previous step when it moves at the same instant with the
+    // same move time; never across the loop marker
+    const bool after_marker = loop_step == kNoLoop || program.size() > loop_step;
+    if (!program.empty() && after_marker) {
+        RoutineStep& last = program.back();
+        if (last.op == RoutineOp::Move && last.at_ms == clock_ms && last.time_ms == time_ms) {
+            for (int i = 0; i < 6; ++i) {
+                if (joints & (1u << i)) {
+                    last.angles[i] = static_cast<int16_t>(angles[i]);
+                }
+            }
+            last.joints |= joints;
+            return;
+        }
+    }
+
+    RoutineStep step;
+    step.at_ms = clock_ms;
+    step.time_ms = static_cast<uint16_t>(time_ms);
+    step.op = RoutineOp::Move;
+    step.joints = joints;
+    for (int i = 0; i < 6; ++i) {
+        step.angles[i] = static_cast<int16_t>(angles[i]);
+    }
+    program.push_back(step);
+}
+
+Routine& Routine::pose(const std::array<int, 6>& angles, int time_ms) {
+    for (int id = 1; id <= 6; ++id) {
+        validate_angle(max_angle, id, angles[id - 1]);
+    }
+    add_move(0x3F, angles, time_ms);
+    return *this;
+}
+
+Routine& Routine::move(int id, int angle, int time_ms) {
+    validate_angle(max_angle, id, angle);
+    std::array<int, 6> angles{};
+    angles[id - 1] = angle;
+    add_move(static_cast<uint8_t>(1u << (id - 1)), angles, time_ms);
+    return *this;
+}
+
+Routine& Routine::wait(int ms) {
+    if (ms < 0) {
+        throw std::out_of_range("Wait must not be negative.");
+    }
+    clock_ms += static_cast<uint32_t>(ms);
+    return *this;
+}
+
+Routine& Routine::torque(bool on) {
+    RoutineStep step;
+    step.at_ms = clock_ms;
+    step.op = RoutineOp::Torque;
+    step.angles[0] = on ? 1 : 0;
+    program.push_back(step);
+    return *this;
+}
+
+Routine& Routine::beep(int delay) {
+    if (delay < 0 || delay > 0xFF) {
+        throw std::out_of_range("Buzzer delay must be between 0 and 255.");
+    }
+    RoutineStep step;
+    step.at_ms = clock_ms;
+    step.op = RoutineOp::Buzzer;
+    step.time_ms = static_cast<uint16_t>(delay);
+    program.push_back(step);
+    return *this;
+}
+
+Routine& Routine::echo(const std::string& text) {
+    RoutineStep step;
+    step.at_ms = clock_ms;
+    step.op = RoutineOp::Echo;
+    step.angles[0] = static_cast<int16_t>(texts.size());
+    texts.push_back(text);
+    program.push_back(step);
+    return *this;
+}
+
+Routine& Routine::loop() {
+    if (loops()) {
+        throw std::logic_error("A routine can only have one loop.");
+    }
+    loop_step = program.size();
+    loop_ms = clock_ms;
+    return *this;
+}
+
+RoutineReport RoutineExecutor::run(const Routine& routine, const std::atomic<bool>* keep_running,
+                                   uint64_t max_loops) {
+    const uint32_t period_ms = routine.duration_ms() - routine.loop_start_ms();
+    if (routine.loops() && period_ms == 0) {
+        throw std::invalid_argument("The loop section of a routine must contain a wait.");
+    }
+
+    // The routine may have been compiled against another profile than this arm's
+    const std::array<double, 6> limits = arm.Arm_calibration().max_angles();
+    for (const RoutineStep& step : routine.steps()) {
+        if (step.op != RoutineOp::Move) {
+            continue;
+        }
+        for (int id = 1; id <= 6; ++id) {
+            if (step.joints & (1u << (id - 1))) {
+                validate_angle(limits, id, step.angles[id - 1]);
+            }
+        }
+    }
+
+    // Another run, or anything else driving the arm meanwhile, may have moved the joints
+    known = 0;
+
+    RoutineReport report;
+    const std::vector<RoutineStep>& steps = routine.steps();
+    const Clock::time_point start = Clock::now();
+    uint64_t pass = 0;
+    std::size_t next = 0;
+
+    // Deadlines are absolute offsets from start, so a late step never delays the rest
+    const auto deadline = [&](uint32_t at_ms) {
+        return start + std::chrono::milliseconds(at_ms + pass * period_ms);
+    };
+
+    for (;;) {
+        if (next == steps.size()) {
+            // Let the trailing wait of this pass elapse before wrapping or returning
+            if (!wait_until(deadline(routine.duration_ms()), keep_running)) {
+                report.cancelled = true;
+                break;
+            }
+            if (!routine.loops()) {
+                break;
+            }
+            ++report.loops;
+            if (max_loops != 0 && report.loops >= max_loops) {
+                break;
+            }
+            ++pass;
+            next = routine.loop_start();
+            continue;
+        }
+
+        const RoutineStep& step = steps[next];
+        const Clock::time_point due = deadline(step.at_ms);
+        if (!wait_until(due, keep_running)) {
+            report.cancelled = true;
+            break;
+        }
+        const double lateness_us = std::chrono::duration<double, std::micro>(Clock::now() - due).count();
+        report.max_lateness_us = std::max(report.max_lateness_us, lateness_us);
+
+        execute(routine, step, report);
+        ++report.steps;
+        ++next;
+    }
+    return report;
+}
+
+void RoutineExecutor::execute(const Routine& routine, const RoutineStep& step, RoutineReport& report) {
+    switch (step.op) {
+    case RoutineOp::Move: {
+        int count = 0;
+        for (int i = 0; i < 6; ++i) {
+            if (step.joints & (1u << i)) {
+                last_pose[i] = step.angles[i];
+                ++count;
+            }
+        }
+        known |= step.joints;
+
+        // Several joints and a known pose for the rest: one write6 instead of N writes
+        if (step.joints == 0x3F || (count > 1 && known == 0x3F)) {
+            arm.Arm_serial_servo_write6(last_pose[0], last_pose[1], last_pose[2],
+                                        last_pose[3], last_pose[4], last_pose[5], step.time_ms);
+            ++report.frames_sent;
+            if (step.joints != 0x3F) {
+                report.writes_merged += static_cast<uint64_t>(count);
+            }
+            break;
+        }
+        for (int i = 0; i < 6; ++i) {
+            if (step.joints & (1u << i)) {
+                arm.Arm_serial_servo_write(i + 1, step.angles[i], step.time_ms);
+                ++report.frames_sent;
+            }
+        }
+        break;
+    }
+    case RoutineOp::Torque:
+        arm.Arm_serial_set_torque(step.angles[0]);
+        if (step.angles[0] == 0) {
+            known = 0; // Limp joints can be pushed anywhere; the last pose no longer holds
+        }
+        ++report.frames_sent;
+        break;
+    case RoutineOp::Buzzer:
+        arm.Arm_Buzzer_On(step.time_ms);
+        ++report.frames_sent;
+        break;
+    case RoutineOp::Echo:
+        std::cout << routine.messages()[static_cast<std::size_t>(step.angles[0])] << std::endl;
+        break;
+    }
+}
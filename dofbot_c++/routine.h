@@ -0,0 +1,139 @@
+/**
+ * @file routine.h
+ * @brief Motion routines as data: a small text format, a compiled step array
+ *        and an executor that plays it on absolute deadlines.
+ *
+ * Routine text, one command per line ('#' starts a comment):
+ *   pose S1 S2 S3 S4 S5 S6 TIME   move all six joints
+ *   move ID ANGLE TIME            move one joint
+ *   wait MS                       advance the routine clock
+ *   torque on|off
+ *   beep DELAY                    buzzer for DELAY units (0 switches it off)
+ *   echo TEXT                     print TEXT
+ *   loop                          everything below repeats until cancelled
+ *
+ * Commands between two waits happen at the same instant. Moves that share an
+ * instant and a move time are folded into one step at load time, and the
+ * executor sends such a step as a single write6 frame, filling the joints it
+ * does not touch from the last commanded pose.
+ */
+
+#ifndef DOFBOT_ROUTINE_H
+#define DOFBOT_ROUTINE_H
+
+#include "Arm_Lib.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+enum class RoutineOp : uint8_t {
+    Move,    // joints/angles/time_ms
+    Torque,  // angles[0] = 1 on, 0 off
+    Buzzer,  // time_ms = buzzer delay
+    Echo     // angles[0] = index into Routine::messages()
+};
+
+/**
+ * @brief One compiled instruction, 20 bytes.
+ */
+struct RoutineStep {
+    uint32_t at_ms = 0;        // Offset from the start of the routine
+    uint16_t time_ms = 0;      // Move time
+    RoutineOp op = RoutineOp::Move;
+    uint8_t joints = 0;        // Bit (id - 1) set for every joint this step moves
+    std::array<int16_t, 6> angles{};
+};
+static_assert(sizeof(RoutineStep) == 20, "Routine steps must stay 20 bytes");
+
+class Routine {
+public:
+    /**
+     * @param calibration Profile whose joint ranges the angles are checked
+     *        against, usually Arm_Device::Arm_calibration() of the arm that plays it.
+     */
+    explicit Routine(const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    /**
+     * @brief Compiles routine text.
+     * @throws std::invalid_argument naming the offending line on a syntax or range error.
+     */
+    static Routine parse(const std::string& text, const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    /**
+     * @brief Reads and compiles a routine file.
+     * @throws std::runtime_error if the file cannot be read; std::invalid_argument as parse().
+     */
+    static Routine load(const std::string& path, const CalibrationProfile& calibration = DEFAULT_CALIBRATION);
+
+    // Builders used by parse(); handy for routines generated in code.
+    // Angles are validated like Arm_Device (std::out_of_range).
+    Routine& pose(const std::array<int, 6>& angles, int time_ms);
+    Routine& move(int id, int angle, int time_ms);
+    Routine& wait(int ms);
+    Routine& torque(bool on);
+    Routine& beep(int delay);
+    Routine& echo(const std::string& text);
+
+    /**
+     * @brief Marks the current point as the start of the repeating section.
+     * @throws std::logic_error if a loop was already started.
+     */
+    Routine& loop();
+
+    const std::vector<RoutineStep>& steps() const { return program; }
+    const std::vector<std::string>& messages() const { return texts; }
+
+    bool loops() const { return loop_step != kNoLoop; }
+    std::size_t loop_start() const { return loop_step; }        // Index of the first repeated step
+    uint32_t loop_start_ms() const { return loop_ms; }
+    uint32_t duration_ms() const { return clock_ms; }           // End of one pass, loop included
+
+private:
+    static constexpr std::size_t kNoLoop = static_cast<std::size_t>(-1);
+
+    std::array<double, 6> max_angle;   // Joint ranges of the calibration profile
+    std::vector<RoutineStep> program;
+    std::vector<std::string> texts;
+    uint32_t clock_ms = 0;
+    std::size_t loop_step = kNoLoop;
+    uint32_t loop_ms = 0;
+
+    void add_move(uint8_t joints, const std::array<int, 6>& angles, int time_ms);
+};
+
+struct RoutineReport {
+    uint64_t steps = 0;          // Steps executed
+    uint64_t frames_sent = 0;    // Command frames written
+    uint64_t writes_merged = 0;  // Per-joint writes folded into write6 frames
+    uint64_t loops = 0;          // Completed passes through the loop section
+    double max_lateness_us = 0.0;
+    bool cancelled = false;
+};
+
+class RoutineExecutor {
+public:
+    explicit RoutineExecutor(Arm_Device& arm) : arm(arm) {}
+
+    /**
+     * @brief Plays @p routine until it ends, @p max_loops passes of its loop
+     *        section have run (0 = no limit) or @p keep_running turns false.
+     *        Waits check @p keep_running at least every 50 ms.
+     * @throws std::invalid_argument if the loop section takes no time.
+     * @throws std::out_of_range before anything is sent if a move is outside
+     *         the arm's calibrated joint ranges.
+     */
+    RoutineReport run(const Routine& routine, const std::atomic<bool>* keep_running = nullptr,
+                      uint64_t max_loops = 0);
+
+private:
+    Arm_Device& arm;
+    std::array<int, 6> last_pose{};   // Last commanded angle per joint
+    uint8_t known = 0;                // Bit (id - 1) set while joint id still holds its last_pose
+
+    void execute(const Routine& routine, const RoutineStep& step, RoutineReport& report);
+};
+
+#endif // DOFBOT_ROUTINE_H
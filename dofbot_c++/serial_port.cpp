@@ -0,0 +1,104 @@
+#include "serial_port.h"
+
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/serial.h>
+#include <sys/ioctl.h>
+#endif
+
+int open_serial_port(const std::string& path, bool non_blocking) {
+    // Open the serial port
+    // O_RDWR: Read/Write
+    // O_NOCTTY: Not the controlling terminal
+    // O_NONBLOCK: Only for callers that multiplex the port in an event loop
+    const int fd = open(path.c_str(), O_RDWR | O_NOCTTY | (non_blocking ? O_NONBLOCK : 0));
+    if (fd == -1) {
+        throw std::runtime_error("Failed to open serial port: " + path + " - " + strerror(errno));
+    }
+
+    // Configure the serial port
+    struct termios tty;
+    std::memset(&tty, 0, sizeof(tty));
+
+    if (tcgetattr(fd, &tty) != 0) {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error("Failed to get serial attributes: " + std::string(strerror(error)));
+    }
+
+    // Set Baud Rate (115200)
+    cfsetospeed(&tty, B115200);
+    cfsetispeed(&tty, B115200);
+
+    // Set Port Settings
+    tty.c_cflag &= ~PARENB;        // No parity
+    tty.c_cflag &= ~CSTOPB;        // 1 stop bit
+    tty.c_cflag &= ~CSIZE;         // Clear data size bits
+    tty.c_cflag |= CS8;            // 8 data bits
+    tty.c_cflag &= ~CRTSCTS;       // No hardware flow control
+    tty.c_cflag |= CREAD | CLOCAL; // Enable receiver, ignore modem control lines
+
+    // Local flags (non-canonical mode)
+    tty.c_lflag &= ~ICANON; // Disable canonical mode
+    tty.c_lflag &= ~ECHO;   // Disable echo
+    tty.c_lflag &= ~ECHOE;  // Disable erasure
+    tty.c_lflag &= ~ECHONL; // Disable newline echo
+    tty.c_lflag &= ~ISIG;   // Disable interpretation of INTR, QUIT and SUSP
+
+    // Input flags (ignore parity)
+    tty.c_iflag &= ~(IXON | IXOFF | IXANY); // Disable software flow control
+    tty.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL); // Disable special handling
+    tty.c_iflag |= IGNPAR;
+
+    // Output flags (raw output)
+    tty.c_oflag = 0;
+
+    // Set Timeouts (VMIN = 0, VTIME = 2)
+    // This matches the Python 'timeout=.2' (2 deciseconds = 0.2s)
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 2;
+
+    // Apply the settings
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        const int error = errno;
+        close(fd);
+        throw std::runtime_error("Failed to set serial attributes: " + std::string(strerror(error)));
+    }
+
+    return fd;
+}
+
+bool set_serial_low_latency(int fd) {
+    struct termios tty;
+    if (tcgetattr(fd, &tty) != 0) {
+        throw std::runtime_error("Failed to get serial attributes: " + std::string(strerror(errno)));
+    }
+    // Never block inside read(); poll() does all the waiting
+    tty.c_cc[VMIN] = 0;
+    tty.c_cc[VTIME] = 0;
+    if (tcsetattr(fd, TCSANOW, &tty) != 0) {
+        throw std::runtime_error("Failed to set serial attributes: " + std::string(strerror(errno)));
+    }
+
+#ifdef __linux__
+    struct serial_struct serial;
+    std::memset(&serial, 0, sizeof(serial));
+    if (ioctl(fd, TIOCGSERIAL, &serial) != 0) {
+        return false;
+    }
+    serial.flags |= ASYNC_LOW_LATENCY;
+    if (ioctl(fd, TIOCSSERIAL, &serial) != 0) {
+        return false;
+    }
+    // Some drivers accept the call but drop flags they do not implement
+    return ioctl(fd, TIOCGSERIAL, &serial) == 0 && (serial.flags & ASYNC_LOW_LATENCY) != 0;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,32 @@
+/**
+ * @file serial_port.h
+ * @brief Opens and configures a tty for the Dofbot board (115200 8N1, raw).
+ */
+
+#ifndef DOFBOT_SERIAL_PORT_H
+#define DOFBOT_SERIAL_PORT_H
+
+#include <string>
+
+/**
+ * @brief Opens @p path read/write and puts it in raw 115200 8N1 mode with no
+ *        flow control, VMIN = 0 and VTIME = 2 (a 0.2 s read timeout, as in the
+ *        Python driver).
+ * @param non_blocking Open with O_NONBLOCK, for event-loop users.
+ * @return The file descriptor; the caller closes it.
+ * @throws std::runtime_error if the port cannot be opened or configured.
+ */
+int open_serial_port(const std::string& path, bool non_blocking = false);
+
+/**
+ * @brief Tunes an open port for the shortest reply latency: VMIN = 0 and
+ *        VTIME = 0, so read() returns at once and the caller waits in poll()
+ *        instead, and on Linux the driver's ASYNC_LOW_LATENCY flag (TIOCSSERIAL),
+ *        which also drops the FTDI USB latency timer from 16 ms to 1 ms.
+ * @return true if the driver accepted ASYNC_LOW_LATENCY; false where it is
+ *         not supported (other platforms, pseudo-terminals, some USB adapters).
+ * @throws std::runtime_error if the termios settings cannot be applied.
+ */
+bool set_serial_low_latency(int fd);
+
+#endif // DOFBOT_SERIAL_PORT_H
@@ -0,0 +1,261 @@
+#include "servo_sim.h"
+
+#include "Arm_Protocol.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdexcept>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    // Raw positions that read back as 90 degrees
+    constexpr double kCentre = 2000.0;
+    constexpr double kCentreServo5 = 1487.0;
+    constexpr uint8_t kReplyDeviceId = arm_protocol::DEVICE_ID - 1;
+    constexpr uint8_t kPingReply = 0xDA;
+    // len byte of the shortest (read) and longest (write6) command
+    constexpr uint8_t kMinLen = 3;
+    constexpr uint8_t kMaxLen = arm_protocol::MAX_FRAME_SIZE - 2;
+
+    double now_seconds() {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    struct PendingReply {
+        double due_s;
+        std::vector<uint8_t> bytes;
+    };
+}
+
+ServoSimulator::ServoSimulator(const SimulatorOptions& options)
+    : config(options), rng(options.seed) {
+    for (Servo& servo : servos) {
+        servo.from = servo.to = kCentre;
+    }
+    servos[4].from = servos[4].to = kCentreServo5;
+    // Room for a full pty read plus a partial frame, so steady traffic never reallocates
+    pending.reserve(1024);
+}
+
+void ServoSimulator::inject_faults(std::vector<uint8_t>& bytes, size_t from) {
+    if (config.drop_rate <= 0.0 && config.corrupt_rate <= 0.0) {
+        return;
+    }
+    size_t out = from;
+    for (size_t i = from; i < bytes.size(); ++i) {
+        if (config.drop_rate > 0.0 && chance(rng) < config.drop_rate) {
+            ++counters.dropped_bytes;
+            continue;
+        }
+        uint8_t value = bytes[i];
+        if (config.corrupt_rate > 0.0 && chance(rng) < config.corrupt_rate) {
+            value ^= static_cast<uint8_t>(1u << (rng() % 8));
+            ++counters.corrupted_bytes;
+        }
+        bytes[out++] = value;
+    }
+    bytes.resize(out);
+}
+
+void ServoSimulator::receive(const uint8_t* data, size_t len, double now_s, std::vector<uint8_t>& replies) {
+    const size_t arrived = pending.size();
+    pending.insert(pending.end(), data, data + len);
+    inject_faults(pending, arrived);
+
+    const size_t reply_start = replies.size();
+    size_t offset = 0;
+    while (pending.size() - offset >= 4) {
+        if (pending[offset] != arm_protocol::HEAD || pending[offset + 1] != arm_protocol::DEVICE_ID) {
+            ++offset;
+            continue;
+        }
+        const uint8_t frame_len_byte = pending[offset + 2];
+        if (frame_len_byte < kMinLen || frame_len_byte > kMaxLen) {
+            ++offset; // Not a real header; resync on the next byte
+            continue;
+        }
+        const size_t frame_len = static_cast<size_t>(frame_len_byte) + 2;
+        if (pending.size() - offset < frame_len) {
+            break;
+        }
+        const uint8_t* frame = pending.data() + offset;
+        if (arm_protocol::checksum(frame, frame_len - 1) != frame[frame_len - 1]) {
+            ++counters.bad_checksums;
+            ++offset;
+            continue;
+        }
+        execute(frame, frame_len, now_s, replies);
+        offset += frame_len;
+    }
+    pending.erase(pending.begin(), pending.begin() + static_cast<std::ptrdiff_t>(offset));
+
+    inject_faults(replies, reply_start);
+}
+
+void ServoSimulator::execute(const uint8_t* frame, size_t len, double now_s, std::vector<uint8_t>& replies) {
+    const uint8_t cmd = frame[3];
+    const uint8_t* payload = frame + 4;
+    const size_t payload_len = len - 5;
+    const auto word = [payload](size_t index) {
+        return static_cast<uint16_t>((payload[index] << 8) | payload[index + 1]);
+    };
+
+    if (cmd == arm_protocol::CMD_SERVO_WRITE6 && payload_len == 14) {
+        for (int id = 1; id <= 6; ++id) {
+            move(id, word(2 * (id - 1)), word(12), now_s);
+        }
+    } else if (cmd > arm_protocol::CMD_SERVO_WRITE_BASE && cmd <= arm_protocol::CMD_SERVO_WRITE_BASE + 6 &&
+               payload_len == 4) {
+        move(cmd - arm_protocol::CMD_SERVO_WRITE_BASE, word(0), word(2), now_s);
+    } else if (cmd > arm_protocol::CMD_SERVO_READ_BASE && cmd <= arm_protocol::CMD_SERVO_READ_BASE + 6 &&
+               payload_len == 0) {
+        const uint16_t pos = position(cmd - arm_protocol::CMD_SERVO_READ_BASE, now_s);
+        const uint8_t data[] = {arm_protocol::high_byte(pos), arm_protocol::low_byte(pos), cmd};
+        reply(arm_protocol::REPLY_SERVO, data, sizeof(data), replies);
+    } else if (cmd == arm_protocol::CMD_TORQUE && payload_len == 1) {
+        // Servos hold wherever they are when torque changes
+        for (int id = 1; id <= 6; ++id) {
+            Servo& servo = servos[id - 1];
+            servo.from = servo.to = position(id, now_s);
+            servo.duration_s = 0.0;
+        }
+        torque = payload[0] != 0;
+    } else if (cmd == arm_protocol::CMD_PING && payload_len == 1) {
+        if (payload[0] >= 1 && payload[0] <= 6) {
+            const uint8_t data[] = {kPingReply};
+            reply(arm_protocol::CMD_PING, data, sizeof(data), replies);
+        }
+    } else if (cmd == arm_protocol::CMD_BUZZER && payload_len == 1) {
+        buzzer_delay = payload[0];
+    } else {
+        ++counters.unknown_commands;
+        return;
+    }
+    ++counters.frames;
+}
+
+void ServoSimulator::move(int id, uint16_t target, uint16_t time_ms, double now_s) {
+    if (!torque) {
+        return;
+    }
+    Servo& servo = servos[id - 1];
+    servo.from = position(id, now_s);
+    servo.to = target;
+    servo.start_s = now_s;
+    servo.duration_s = time_ms / 1000.0;
+}
+
+uint16_t ServoSimulator::position(int id, double now_s) const {
+    const Servo& servo = servos[id - 1];
+    const double elapsed = now_s - servo.start_s;
+    if (servo.duration_s <= 0.0 || elapsed >= servo.duration_s) {
+        return static_cast<uint16_t>(std::lround(servo.to));
+    }
+    const double progress = std::max(elapsed, 0.0) / servo.duration_s;
+    return static_cast<uint16_t>(std::lround(servo.from + (servo.to - servo.from) * progress));
+}
+
+void ServoSimulator::reply(uint8_t type, const uint8_t* data, size_t len, std::vector<uint8_t>& replies) {
+    // 0xFF 0xFB <len> <type> <data...> <checksum>, checksum over len, type and data
+    const uint8_t ext_len = static_cast<uint8_t>(len + 3);
+    unsigned int sum = ext_len + type;
+    replies.push_back(arm_protocol::HEAD);
+    replies.push_back(kReplyDeviceId);
+    replies.push_back(ext_len);
+    replies.push_back(type);
+    for (size_t i = 0; i < len; ++i) {
+        replies.push_back(data[i]);
+        sum += data[i];
+    }
+    replies.push_back(static_cast<uint8_t>(sum & 0xFF));
+    ++counters.replies;
+}
+
+SimulatedPort::SimulatedPort(const SimulatorOptions& options) : simulator(options) {
+    master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master_fd < 0 || grantpt(master_fd) != 0 || unlockpt(master_fd) != 0) {
+        const int error = errno;
+        if (master_fd >= 0) {
+            close(master_fd);
+        }
+        throw std::runtime_error("Failed to allocate a pseudo-terminal: " + std::string(strerror(error)));
+    }
+    slave_name = ptsname(master_fd);
+
+    // Hold the slave open so the master does not see a hangup every time a
+    // client disconnects, and keep it raw until a client configures it.
+    slave_fd = open(slave_name.c_str(), O_RDWR | O_NOCTTY);
+    if (slave_fd < 0) {
+        const int error = errno;
+        close(master_fd);
+        throw std::runtime_error("Failed to open " + slave_name + ": " + strerror(error));
+    }
+    termios tty{};
+    if (tcgetattr(slave_fd, &tty) == 0) {
+        cfmakeraw(&tty);
+        tcsetattr(slave_fd, TCSANOW, &tty);
+    }
+
+    server = std::thread(&SimulatedPort::serve, this);
+}
+
+SimulatedPort::~SimulatedPort() {
+    running = false;
+    server.join();
+    close(slave_fd);
+    close(master_fd);
+}
+
+void SimulatedPort::serve() {
+    const double latency_s = simulator.options().latency_ms / 1000.0;
+    std::deque<PendingReply> outbox;
+    std::vector<uint8_t> replies;
+    replies.reserve(512);
+    uint8_t buffer[512];
+
+    while (running) {
+        // Sleep until input arrives, the next delayed reply is due or 20 ms pass
+        int timeout_ms = 20;
+        if (!outbox.empty()) {
+            const double wait_ms = (outbox.front().due_s - now_seconds()) * 1000.0;
+            timeout_ms = std::max(0, std::min(timeout_ms, static_cast<int>(std::ceil(wait_ms))));
+        }
+        pollfd pfd = {master_fd, POLLIN, 0};
+        if (poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN)) {
+            const ssize_t n = read(master_fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                const double now = now_seconds();
+                replies.clear();
+                {
+                    std::lock_guard<std::mutex> lock(model_mutex);
+                    simulator.receive(buffer, static_cast<size_t>(n), now, replies);
+                }
+                if (latency_s <= 0.0) {
+                    if (!replies.empty() && write(master_fd, replies.data(), replies.size()) < 0) {
+                        std::perror("SimulatedPort write");
+                    }
+                } else if (!replies.empty()) {
+                    outbox.push_back({now + latency_s, replies});
+                }
+            }
+        }
+
+        const double now = now_seconds();
+        while (!outbox.empty() && outbox.front().due_s <= now) {
+            const std::vector<uint8_t>& bytes = outbox.front().bytes;
+            if (write(master_fd, bytes.data(), bytes.size()) < 0) {
+                std::perror("SimulatedPort write");
+            }
+            outbox.pop_front();
+        }
+    }
+}
@@ -0,0 +1,131 @@
+/**
+ * @file servo_sim.h
+ * @brief Software model of the DOFBOT expansion board for hardware-free runs.
+ *
+ * ServoSimulator parses the same 0xFF 0xFC command frames the board does and
+ * produces the replies it would send. It does no I/O of its own: feed it the
+ * bytes the host wrote plus the current time, and write whatever it returns
+ * back to the host. SimulatedPort serves it on a pseudo-terminal for
+ * dofbot_sim and the benchmarks; anything else that needs a fake arm can
+ * reuse the model directly.
+ *
+ * Servo motion is linear in raw position over the commanded move time, so a
+ * read issued mid-move reports an intermediate angle just as the real servos do.
+ */
+
+#ifndef DOFBOT_SERVO_SIM_H
+#define DOFBOT_SERVO_SIM_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+struct SimulatorOptions {
+    double latency_ms = 0.0;    // Delay before a reply reaches the host (applied by the transport)
+    double drop_rate = 0.0;     // Probability that any byte, in either direction, is lost
+    double corrupt_rate = 0.0;  // Probability that any byte has one bit flipped
+    uint32_t seed = 1;          // Seed for the fault generator, so failures reproduce
+};
+
+struct SimulatorStats {
+    uint64_t frames = 0;           // Well-formed command frames executed
+    uint64_t bad_checksums = 0;    // Frames rejected for a checksum mismatch
+    uint64_t unknown_commands = 0; // Well-formed frames with an unsupported command id
+    uint64_t replies = 0;          // Reply frames produced
+    uint64_t dropped_bytes = 0;
+    uint64_t corrupted_bytes = 0;
+};
+
+class ServoSimulator {
+public:
+    explicit ServoSimulator(const SimulatorOptions& options = SimulatorOptions());
+
+    /**
+     * @brief Consumes bytes written by the host at time @p now_s (seconds, any
+     *        monotonic origin) and appends the board's replies to @p replies.
+     *        Partial frames are kept until the rest arrives.
+     */
+    void receive(const uint8_t* data, size_t len, double now_s, std::vector<uint8_t>& replies);
+
+    /**
+     * @brief Raw position of servo @p id (1-6) at time @p now_s.
+     */
+    uint16_t position(int id, double now_s) const;
+
+    bool torque_enabled() const { return torque; }
+    uint8_t buzzer() const { return buzzer_delay; }
+    const SimulatorStats& stats() const { return counters; }
+    const SimulatorOptions& options() const { return config; }
+
+private:
+    struct Servo {
+        double from = 0.0;  // Raw position at start_s
+        double to = 0.0;    // Raw target
+        double start_s = 0.0;
+        double duration_s = 0.0;
+    };
+
+    SimulatorOptions config;
+    SimulatorStats counters;
+    std::array<Servo, 6> servos;
+    bool torque = true;
+    uint8_t buzzer_delay = 0;
+    std::vector<uint8_t> pending;
+    std::mt19937 rng;
+    std::uniform_real_distribution<double> chance{0.0, 1.0};
+
+    // Drops or corrupts bytes in place according to the fault rates
+    void inject_faults(std::vector<uint8_t>& bytes, size_t from);
+    void execute(const uint8_t* frame, size_t len, double now_s, std::vector<uint8_t>& replies);
+    void move(int id, uint16_t target, uint16_t time_ms, double now_s);
+    void reply(uint8_t type, const uint8_t* data, size_t len, std::vector<uint8_t>& replies);
+};
+
+/**
+ * @brief A ServoSimulator served on the master side of a pseudo-terminal by a
+ *        background thread. Open path() with Arm_Device like a real port.
+ */
+class SimulatedPort {
+public:
+    /**
+     * @throws std::runtime_error if no pseudo-terminal can be allocated.
+     */
+    explicit SimulatedPort(const SimulatorOptions& options = SimulatorOptions());
+    ~SimulatedPort();
+
+    SimulatedPort(const SimulatedPort&) = delete;
+    SimulatedPort& operator=(const SimulatedPort&) = delete;
+
+    /**
+     * @brief Slave device path, e.g. /dev/pts/3.
+     */
+    const std::string& path() const { return slave_name; }
+
+    /**
+     * @brief Runs @p fn with the simulator locked against the serving thread.
+     */
+    template <typename Fn>
+    void inspect(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        fn(static_cast<const ServoSimulator&>(simulator));
+    }
+
+private:
+    ServoSimulator simulator;
+    mutable std::mutex model_mutex;
+    int master_fd = -1;
+    int slave_fd = -1;
+    std::string slave_name;
+    std::atomic<bool> running{true};
+    std::thread server;
+
+    void serve();
+};
+
+#endif // DOFBOT_SERVO_SIM_H
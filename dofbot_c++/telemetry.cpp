@@ -0,0 +1,207 @@
+#include "telemetry.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <stdexcept>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+    constexpr char kMagic[8] = {'D', 'O', 'F', 'T', 'L', 'M', 'Y', 0};
+    constexpr uint32_t kVersion = 1;
+    constexpr uint32_t kByteOrder = 0x01020304;
+    // Records written per write() call; the ring is drained in chunks of this size
+    constexpr std::size_t kBatch = 256;
+
+    struct FileHeader {
+        char magic[8];
+        uint32_t version;
+        uint32_t byte_order;
+        uint32_t record_size;
+        uint32_t reserved;
+        uint64_t wall_start_ns;
+        uint8_t padding[32];
+    };
+    static_assert(sizeof(FileHeader) == 64, "Telemetry file header must stay 64 bytes");
+}
+
+TelemetryWriter::TelemetryWriter(const std::string& path, const TelemetryOptions& options)
+    : path(path), options(options), start(Clock::now()), ring(options.ring_capacity) {
+    fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to create telemetry log: " + path + " - " + strerror(errno));
+    }
+
+    FileHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.byte_order = kByteOrder;
+    header.record_size = sizeof(TelemetryRecord);
+    header.wall_start_ns = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    try {
+        write_all(&header, sizeof(header));
+    } catch (...) {
+        ::close(fd);
+        throw;
+    }
+
+    flusher = std::thread(&TelemetryWriter::run, this);
+}
+
+TelemetryWriter::~TelemetryWriter() {
+    stop = true;
+    flusher.join();
+    ::close(fd);
+}
+
+bool TelemetryWriter::record(const Arm_ServoReadings& readings, Clock::time_point started,
+                             Clock::time_point finished) {
+    TelemetryRecord record;
+    record.time_ns = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(started - start).count());
+    const auto read_us = std::chrono::duration_cast<std::chrono::microseconds>(finished - started).count();
+    record.read_us = static_cast<uint16_t>(std::min<int64_t>(std::max<int64_t>(read_us, 0), 0xFFFF));
+    for (int i = 0; i < 6; ++i) {
+        if (readings.status[i] == Arm_ReadStatus::Ok) {
+            record.valid_mask |= static_cast<uint8_t>(1u << i);
+            record.angles[i] = static_cast<int16_t>(readings.angles[i]);
+        }
+    }
+    return append(record);
+}
+
+bool TelemetryWriter::append(TelemetryRecord& record) {
+    record.sequence = next_sequence.fetch_add(1, std::memory_order_relaxed);
+    if (!ring.try_push(record)) {
+        records_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void TelemetryWriter::write_all(const void* data, std::size_t size) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    while (size > 0) {
+        const ssize_t n = ::write(fd, bytes, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            throw std::runtime_error("Failed to write telemetry log: " + path + " - " + strerror(errno));
+        }
+        bytes += n;
+        size -= static_cast<std::size_t>(n);
+    }
+}
+
+void TelemetryWriter::run() {
+    std::vector<TelemetryRecord> batch(kBatch);
+    bool failed = false;
+
+    for (;;) {
+        // Read the flag first so a final pass always follows the last push
+        const bool stopping = stop.load();
+        std::size_t filled = 0;
+        for (;;) {
+            while (filled < kBatch && ring.try_pop(batch[filled])) {
+                ++filled;
+            }
+            if (filled == 0) {
+                break;
+            }
+            if (!failed) {
+                try {
+                    write_all(batch.data(), filled * sizeof(TelemetryRecord));
+                    records_written.fetch_add(filled, std::memory_order_relaxed);
+                } catch (const std::exception& e) {
+                    // Keep draining so producers never see a full ring, but stop writing
+                    std::cerr << e.what() << std::endl;
+                    failed = true;
+                }
+            }
+            if (failed) {
+                records_dropped.fetch_add(filled, std::memory_order_relaxed);
+            }
+            filled = 0;
+        }
+        if (stopping) {
+            return;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(options.flush_interval_ms));
+    }
+}
+
+TelemetryReader::TelemetryReader(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open telemetry log: " + path + " - " + strerror(errno));
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        const int error = errno;
+        ::close(fd);
+        throw std::runtime_error("Failed to stat telemetry log: " + path + " - " + strerror(error));
+    }
+    const std::size_t size = static_cast<std::size_t>(info.st_size);
+    if (size < sizeof(FileHeader)) {
+        ::close(fd);
+        throw std::runtime_error("Telemetry log is truncated: " + path);
+    }
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd); // The mapping keeps the file alive
+    if (mapped == MAP_FAILED) {
+        throw std::runtime_error("Failed to map telemetry log: " + path + " - " + strerror(errno));
+    }
+
+    FileHeader header;
+    std::memcpy(&header, mapped, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.byte_order != kByteOrder || header.record_size != sizeof(TelemetryRecord)) {
+        munmap(mapped, size);
+        throw std::runtime_error("Not a valid telemetry log (or written on another byte order): " + path);
+    }
+
+    mapping = mapped;
+    mapping_size = size;
+    wall_start_ns = header.wall_start_ns;
+    records = reinterpret_cast<const TelemetryRecord*>(static_cast<const uint8_t*>(mapped) + sizeof(FileHeader));
+    count = (size - sizeof(FileHeader)) / sizeof(TelemetryRecord);
+    madvise(mapped, size, MADV_SEQUENTIAL);
+}
+
+TelemetryReader::~TelemetryReader() {
+    if (mapping) {
+        munmap(mapping, mapping_size);
+    }
+}
+
+void TelemetryReader::write_csv(std::ostream& out) const {
+    out << "time_s,sequence,read_us,s1,s2,s3,s4,s5,s6\n";
+
+    // Format into a local buffer; going through operator<< per field is several times slower
+    std::vector<char> buffer(1 << 16);
+    std::size_t used = 0;
+    for (const TelemetryRecord& record : *this) {
+        if (buffer.size() - used < 128) {
+            out.write(buffer.data(), static_cast<std::streamsize>(used));
+            used = 0;
+        }
+        char* line = buffer.data() + used;
+        int n = std::snprintf(line, 64, "%.6f,%u,%u", record.time_ns * 1e-9,
+                              record.sequence, static_cast<unsigned>(record.read_us));
+        for (int id = 1; id <= 6; ++id) {
+            n += record.valid(id) ? std::snprintf(line + n, 8, ",%d", record.angles[id - 1])
+                                  : std::snprintf(line + n, 8, ",");
+        }
+        line[n++] = '\n';
+        used += static_cast<std::size_t>(n);
+    }
+    out.write(buffer.data(), static_cast<std::streamsize>(used));
+}
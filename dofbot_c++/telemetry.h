@@ -0,0 +1,137 @@
+/**
+ * @file telemetry.h
+ * @brief Binary joint-feedback log: lock-free capture, background flush, mmap replay.
+ *
+ * The sampling thread hands fixed-size records to TelemetryWriter, which only
+ * pushes them into an MpscRing; a flusher thread drains the ring in batches
+ * and appends them to the log file, so the sampling loop never waits on the
+ * disk. TelemetryReader maps a finished (or still growing) log read-only for
+ * offline analysis and CSV export.
+ *
+ * File layout (native byte order): a 64-byte header followed by 32-byte
+ * records. A record cut short by a crash is ignored on open.
+ */
+
+#ifndef DOFBOT_TELEMETRY_H
+#define DOFBOT_TELEMETRY_H
+
+#include "Arm_Lib.h"
+#include "mpsc_ring.h"
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <thread>
+
+/**
+ * @brief One read6 sample.
+ */
+struct TelemetryRecord {
+    uint64_t time_ns = 0;           // Start of the exchange, relative to the log's start
+    uint32_t sequence = 0;
+    uint16_t read_us = 0;           // Duration of the exchange, saturating at 65535
+    uint8_t valid_mask = 0;         // Bit i set when servo i + 1 reported an angle
+    uint8_t reserved = 0;
+    std::array<int16_t, 6> angles{{-1, -1, -1, -1, -1, -1}};
+    uint32_t padding = 0;
+
+    bool valid(int id) const { return (valid_mask >> (id - 1)) & 1; }
+};
+static_assert(sizeof(TelemetryRecord) == 32, "Telemetry records must stay 32 bytes");
+
+struct TelemetryOptions {
+    std::size_t ring_capacity = 4096;   // Records buffered between flushes
+    unsigned int flush_interval_ms = 50;
+};
+
+class TelemetryWriter {
+public:
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @brief Creates (truncates) @p path, writes the header and starts the flusher.
+     * @throws std::runtime_error if the file cannot be created.
+     */
+    explicit TelemetryWriter(const std::string& path, const TelemetryOptions& options = TelemetryOptions());
+
+    /**
+     * @brief Stops the flusher after it has written everything still queued.
+     */
+    ~TelemetryWriter();
+
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    /**
+     * @brief Queues a sample taken between @p started and @p finished. Never
+     *        blocks; callable from any thread.
+     * @return false if the ring was full and the sample was dropped.
+     */
+    bool record(const Arm_ServoReadings& readings, Clock::time_point started, Clock::time_point finished);
+
+    /**
+     * @brief Queues a prepared record as is.
+     */
+    bool append(TelemetryRecord& record);
+
+    uint64_t written() const { return records_written.load(std::memory_order_relaxed); }
+    uint64_t dropped() const { return records_dropped.load(std::memory_order_relaxed); }
+
+private:
+    int fd = -1;
+    std::string path;
+    TelemetryOptions options;
+    Clock::time_point start;
+    MpscRing<TelemetryRecord> ring;
+    std::atomic<uint32_t> next_sequence{0};
+    std::atomic<uint64_t> records_written{0};
+    std::atomic<uint64_t> records_dropped{0};
+    std::atomic<bool> stop{false};
+    std::thread flusher;
+
+    void run();
+    void write_all(const void* data, std::size_t size);
+};
+
+class TelemetryReader {
+public:
+    /**
+     * @brief Maps @p path read-only.
+     * @throws std::runtime_error if the file cannot be opened or is not a telemetry log.
+     */
+    explicit TelemetryReader(const std::string& path);
+    ~TelemetryReader();
+
+    TelemetryReader(const TelemetryReader&) = delete;
+    TelemetryReader& operator=(const TelemetryReader&) = delete;
+
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    const TelemetryRecord& operator[](std::size_t index) const { return records[index]; }
+    const TelemetryRecord* begin() const { return records; }
+    const TelemetryRecord* end() const { return records + count; }
+
+    /**
+     * @brief Wall-clock time the log was started, in nanoseconds since the Unix epoch.
+     */
+    uint64_t start_time_ns() const { return wall_start_ns; }
+
+    /**
+     * @brief Writes one CSV row per record: time_s, sequence, read_us, s1..s6
+     *        (an empty field where a servo did not reply).
+     */
+    void write_csv(std::ostream& out) const;
+
+private:
+    void* mapping = nullptr;
+    std::size_t mapping_size = 0;
+    const TelemetryRecord* records = nullptr;
+    std::size_t count = 0;
+    uint64_t wall_start_ns = 0;
+};
+
+#endif // DOFBOT_TELEMETRY_H
@@ -0,0 +1,141 @@
+/**
+ * @file telemetry_dump.cpp
+ * @brief Summarises a telemetry log written by read_servo --log and exports it as CSV.
+ */
+
+#include "telemetry.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace {
+    const char* kUsage =
+        "Summarise a binary telemetry log and optionally export it.\n\n"
+        "Usage: telemetry_dump LOG [options]\n"
+        "  --csv PATH          Write every record as CSV (- for stdout, which skips the summary)\n"
+        "  --help              Show this message and exit\n";
+
+    const std::string& expect_value(const std::vector<std::string>& tokens, size_t& index) {
+        if (index + 1 >= tokens.size()) {
+            throw std::runtime_error("Missing value for argument: " + tokens[index]);
+        }
+        return tokens[++index];
+    }
+
+    double percentile(std::vector<uint16_t>& values, double fraction) {
+        if (values.empty()) {
+            return 0.0;
+        }
+        const size_t index = std::min(values.size() - 1, static_cast<size_t>(fraction * values.size()));
+        std::nth_element(values.begin(), values.begin() + index, values.end());
+        return values[index];
+    }
+
+    void print_summary(const TelemetryReader& log) {
+        std::cout << "Records:        " << log.size() << '\n';
+        if (log.empty()) {
+            return;
+        }
+
+        const double duration_s = (log[log.size() - 1].time_ns - log[0].time_ns) * 1e-9;
+        uint64_t max_gap_ns = 0;
+        uint64_t lost = 0;
+        uint64_t incomplete = 0;
+        std::array<int, 6> lo{{1000, 1000, 1000, 1000, 1000, 1000}};
+        std::array<int, 6> hi{{-1, -1, -1, -1, -1, -1}};
+        std::vector<uint16_t> read_us;
+        read_us.reserve(log.size());
+
+        const TelemetryRecord* previous = nullptr;
+        for (const TelemetryRecord& record : log) {
+            if (previous) {
+                max_gap_ns = std::max(max_gap_ns, record.time_ns - previous->time_ns);
+                lost += record.sequence - previous->sequence - 1;
+            }
+            previous = &record;
+            if (record.valid_mask != 0x3F) {
+                ++incomplete;
+            }
+            for (int i = 0; i < 6; ++i) {
+                if (record.valid(i + 1)) {
+                    lo[i] = std::min<int>(lo[i], record.angles[i]);
+                    hi[i] = std::max<int>(hi[i], record.angles[i]);
+                }
+            }
+            read_us.push_back(record.read_us);
+        }
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << "Duration:       " << duration_s << " s\n"
+                  << "Sample rate:    " << (duration_s > 0.0 ? (log.size() - 1) / duration_s : 0.0) << " Hz\n"
+                  << "Largest gap:    " << max_gap_ns * 1e-6 << " ms\n"
+                  << "Lost samples:   " << lost << " (dropped before reaching the file)\n"
+                  << "Incomplete:     " << incomplete << " (at least one joint did not reply)\n"
+                  << std::setprecision(0)
+                  << "Read time:      p50 " << percentile(read_us, 0.5) << " us, p99 "
+                  << percentile(read_us, 0.99) << " us\n";
+        for (int i = 0; i < 6; ++i) {
+            std::cout << "S" << (i + 1) << " range:       ";
+            if (hi[i] < 0) {
+                std::cout << "no replies\n";
+            } else {
+                std::cout << lo[i] << "-" << hi[i] << "°\n";
+            }
+        }
+    }
+}
+
+int main(int argc, char* argv[]) {
+    try {
+        const std::vector<std::string> args(argv + 1, argv + argc);
+        std::string log_path;
+        std::string csv_path;
+
+        for (size_t i = 0; i < args.size(); ++i) {
+            const std::string& token = args[i];
+            if (token == "--help" || token == "-h") {
+                std::cout << kUsage;
+                return 0;
+            } else if (token == "--csv") {
+                csv_path = expect_value(args, i);
+            } else if (log_path.empty() && token.rfind("--", 0) != 0) {
+                log_path = token;
+            } else {
+                std::cerr << "Unrecognized argument: " << token << "\n\n" << kUsage;
+                return 1;
+            }
+        }
+        if (log_path.empty()) {
+            std::cerr << kUsage;
+            return 1;
+        }
+
+        const TelemetryReader log(log_path);
+        if (csv_path == "-") {
+            log.write_csv(std::cout);
+            return 0;
+        }
+
+        print_summary(log);
+        if (!csv_path.empty()) {
+            std::ofstream out(csv_path);
+            if (!out) {
+                throw std::runtime_error("Failed to create " + csv_path);
+            }
+            log.write_csv(out);
+            std::cout << "Wrote " << log.size() << " rows to " << csv_path << std::endl;
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
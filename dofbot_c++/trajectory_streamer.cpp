@@ -0,0 +1,169 @@
+#include "trajectory_streamer.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <pthread.h>
+#include <sched.h>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <time.h>
+
+namespace {
+    constexpr int64_t kNanosPerSecond = 1000000000;
+
+    int64_t now_ns() {
+        timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return static_cast<int64_t>(ts.tv_sec) * kNanosPerSecond + ts.tv_nsec;
+    }
+
+    // Sleeps until the absolute CLOCK_MONOTONIC time @p deadline_ns
+    void sleep_until_ns(int64_t deadline_ns) {
+#if defined(__APPLE__)
+        // No clock_nanosleep on macOS; steady_clock is mach_absolute_time there
+        const int64_t remaining = deadline_ns - now_ns();
+        if (remaining > 0) {
+            std::this_thread::sleep_for(std::chrono::nanoseconds(remaining));
+        }
+#else
+        timespec ts;
+        ts.tv_sec = static_cast<time_t>(deadline_ns / kNanosPerSecond);
+        ts.tv_nsec = static_cast<long>(deadline_ns % kNanosPerSecond);
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+        }
+#endif
+    }
+
+    // True if the process already has locked pages, e.g. from the host's own mlockall()
+    bool memory_locked() {
+#if defined(__linux__)
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line)) {
+            if (line.compare(0, 6, "VmLck:") == 0) {
+                return std::stoul(line.substr(6)) > 0;
+            }
+        }
+#endif
+        return false;
+    }
+
+    // Applies SCHED_FIFO and/or mlockall for one play() call and undoes them
+    // after. Memory the host locked itself stays locked: munlockall() would
+    // release its locks too, so play() leaves locking alone in that case.
+    class RealtimeScope {
+    public:
+        explicit RealtimeScope(const StreamerOptions& options) {
+            if (options.lock_memory && !memory_locked()) {
+                if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+                    locked = true;
+                } else {
+                    std::cerr << "Warning: mlockall failed: " << strerror(errno) << std::endl;
+                }
+            }
+            if (options.realtime) {
+                pthread_getschedparam(pthread_self(), &old_policy, &old_param);
+                sched_param param{};
+                param.sched_priority = options.realtime_priority;
+                const int rc = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+                if (rc == 0) {
+                    scheduled = true;
+                } else {
+                    std::cerr << "Warning: SCHED_FIFO unavailable: " << strerror(rc) << std::endl;
+                }
+            }
+        }
+
+        ~RealtimeScope() {
+            if (scheduled) {
+                pthread_setschedparam(pthread_self(), old_policy, &old_param);
+            }
+            if (locked) {
+                munlockall();
+            }
+        }
+
+        RealtimeScope(const RealtimeScope&) = delete;
+        RealtimeScope& operator=(const RealtimeScope&) = delete;
+
+    private:
+        bool locked = false;
+        bool scheduled = false;
+        int old_policy = SCHED_OTHER;
+        sched_param old_param{};
+    };
+}
+
+TrajectoryStreamer::TrajectoryStreamer(Arm_Device& arm, const StreamerOptions& options)
+    : arm(arm), options(options) {
+    if (!(options.rate_hz > 0.0) || options.rate_hz > 1000.0) {
+        throw std::invalid_argument("Streamer rate must be between 0 and 1000 Hz.");
+    }
+    if (options.jitter_buckets == 0 || !(options.jitter_bucket_us > 0.0)) {
+        throw std::invalid_argument("Jitter histogram needs at least one bucket of positive width.");
+    }
+}
+
+StreamerReport TrajectoryStreamer::play(const JointTrajectory& trajectory,
+                                        const std::atomic<bool>* keep_running) {
+    StreamerReport report;
+    report.bucket_width_us = options.jitter_bucket_us;
+    report.jitter_histogram.assign(options.jitter_buckets, 0);
+
+    const int64_t period_ns = static_cast<int64_t>(std::llround(kNanosPerSecond / options.rate_hz));
+    const int move_time_ms = std::max(1, static_cast<int>(std::lround(1000.0 / options.rate_hz)));
+
+    RealtimeScope realtime(options);
+
+    std::array<double, 6> pose{};
+    double jitter_sum_us = 0.0;
+    const int64_t start_ns = now_ns();
+    int64_t tick = 0;
+
+    for (;;) {
+        if (keep_running && !keep_running->load()) {
+            break;
+        }
+
+        const double t = static_cast<double>(tick * period_ns) / kNanosPerSecond;
+        if (!trajectory(t, pose)) {
+            break;
+        }
+        arm.Arm_serial_servo_write6(pose, move_time_ms);
+        ++report.ticks;
+
+        // Stay on the start-aligned grid: if this tick overran one or more
+        // slots, skip them rather than firing a burst of late samples.
+        int64_t next_tick = tick + 1;
+        const int64_t after_work = now_ns();
+        if (after_work > start_ns + next_tick * period_ns) {
+            const int64_t behind = (after_work - start_ns) / period_ns + 1;
+            report.missed_deadlines += static_cast<uint64_t>(behind - next_tick);
+            next_tick = behind;
+        }
+
+        const int64_t deadline = start_ns + next_tick * period_ns;
+        sleep_until_ns(deadline);
+
+        const double lateness_us = static_cast<double>(std::max<int64_t>(0, now_ns() - deadline)) / 1000.0;
+        jitter_sum_us += lateness_us;
+        report.max_jitter_us = std::max(report.max_jitter_us, lateness_us);
+        const size_t bucket = std::min(report.jitter_histogram.size() - 1,
+                                       static_cast<size_t>(lateness_us / report.bucket_width_us));
+        ++report.jitter_histogram[bucket];
+
+        tick = next_tick;
+    }
+
+    if (report.ticks > 0) {
+        report.mean_jitter_us = jitter_sum_us / static_cast<double>(report.ticks);
+    }
+    return report;
+}
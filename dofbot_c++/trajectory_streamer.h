@@ -0,0 +1,73 @@
+/**
+ * @file trajectory_streamer.h
+ * @brief Plays a time-parameterised joint trajectory at a fixed rate.
+ *
+ * The streamer samples a trajectory on a fixed grid of absolute deadlines and
+ * sends each sample as one write6 frame. Deadlines are absolute, so a late
+ * tick never shifts the ones after it, and the report tells how late every
+ * wake-up was.
+ */
+
+#ifndef DOFBOT_TRAJECTORY_STREAMER_H
+#define DOFBOT_TRAJECTORY_STREAMER_H
+
+#include "Arm_Lib.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+/**
+ * @brief Timing options for TrajectoryStreamer.
+ */
+struct StreamerOptions {
+    double rate_hz = 100.0;          // Samples per second, typically 50-200
+    bool realtime = false;           // Run play() under SCHED_FIFO
+    int realtime_priority = 80;      // SCHED_FIFO priority when realtime is set
+    bool lock_memory = false;        // mlockall() for the duration of play(), unless already locked
+    double jitter_bucket_us = 50.0;  // Width of one jitter histogram bucket
+    size_t jitter_buckets = 40;      // Buckets; the last one collects everything above
+};
+
+/**
+ * @brief Timing statistics gathered by one TrajectoryStreamer::play() call.
+ */
+struct StreamerReport {
+    uint64_t ticks = 0;            // Samples sent
+    uint64_t missed_deadlines = 0; // Grid slots skipped because a tick overran
+    double mean_jitter_us = 0.0;   // Mean wake-up lateness
+    double max_jitter_us = 0.0;    // Worst wake-up lateness
+    double bucket_width_us = 0.0;
+    std::vector<uint64_t> jitter_histogram; // Wake-up lateness counts per bucket
+};
+
+/**
+ * @brief Returns false once the trajectory has ended; otherwise fills @p pose
+ *        with the joint angles (degrees, S1-S6, fractions kept) at time @p t seconds.
+ */
+using JointTrajectory = std::function<bool(double t, std::array<double, 6>& pose)>;
+
+class TrajectoryStreamer {
+public:
+    /**
+     * @throws std::invalid_argument if the rate is not in (0, 1000] Hz.
+     */
+    explicit TrajectoryStreamer(Arm_Device& arm, const StreamerOptions& options = StreamerOptions());
+
+    /**
+     * @brief Streams @p trajectory until it ends or @p keep_running turns false.
+     *
+     * Each sample is sent with a move time of one period so the board's own
+     * interpolator bridges consecutive samples.
+     */
+    StreamerReport play(const JointTrajectory& trajectory,
+                        const std::atomic<bool>* keep_running = nullptr);
+
+private:
+    Arm_Device& arm;
+    StreamerOptions options;
+};
+
+#endif // DOFBOT_TRAJECTORY_STREAMER_H
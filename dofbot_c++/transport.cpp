@@ -0,0 +1,146 @@
+#include "transport.h"
+#include "serial_port.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <poll.h>
+#include <stdexcept>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace {
+    // One 8N1 character is ten bit times
+    std::chrono::nanoseconds byte_time_at(double baud) {
+        if (!(baud > 0.0)) {
+            throw std::invalid_argument("Loopback baud rate must be positive.");
+        }
+        return std::chrono::nanoseconds(static_cast<long long>(10e9 / baud));
+    }
+}
+
+TtyTransport::TtyTransport(const std::string& path, bool low_latency) : path(path) {
+    ser_fd = open_serial_port(path);
+    if (low_latency) {
+        try {
+            low_latency_driver = set_serial_low_latency(ser_fd);
+        } catch (...) {
+            close(ser_fd);
+            throw;
+        }
+    }
+}
+
+TtyTransport::~TtyTransport() {
+    if (ser_fd != -1) {
+        close(ser_fd);
+    }
+}
+
+std::size_t TtyTransport::write(const uint8_t* data, std::size_t len) {
+    const ssize_t n = ::write(ser_fd, data, len);
+    if (n < 0) {
+        throw std::runtime_error("Serial write error: " + std::string(strerror(errno)));
+    }
+    return static_cast<std::size_t>(n);
+}
+
+long TtyTransport::read(uint8_t* buf, std::size_t cap, std::chrono::nanoseconds timeout) {
+    // Round up so a poll timeout always lands past the caller's deadline
+    const auto timeout_ms = std::chrono::ceil<std::chrono::milliseconds>(timeout);
+    pollfd pfd = {ser_fd, POLLIN, 0};
+    const int ready = poll(&pfd, 1, static_cast<int>(std::max<long long>(0, timeout_ms.count())));
+    if (ready < 0) {
+        return errno == EINTR ? 0 : -1;
+    }
+    if (ready == 0) {
+        return 0;
+    }
+    // Take everything the driver has in one read
+    const ssize_t n = ::read(ser_fd, buf, cap);
+    if (n < 0) {
+        return (errno == EINTR || errno == EAGAIN) ? 0 : -1;
+    }
+    return static_cast<long>(n);
+}
+
+void TtyTransport::discard_input() {
+    tcflush(ser_fd, TCIFLUSH);
+}
+
+std::size_t TtyTransport::tx_backlog() const {
+    int queued = 0;
+    if (ioctl(ser_fd, TIOCOUTQ, &queued) != 0 || queued < 0) {
+        return 0;
+    }
+    return static_cast<std::size_t>(queued);
+}
+
+LoopbackTransport::LoopbackTransport(const LoopbackOptions& options)
+    : byte_time(byte_time_at(options.baud)),
+      latency(std::chrono::nanoseconds(static_cast<long long>(options.simulator.latency_ms * 1e6))),
+      simulator(options.simulator) {
+}
+
+std::size_t LoopbackTransport::write(const uint8_t* data, std::size_t len) {
+    std::lock_guard<std::mutex> lock(model_mutex);
+    // The board sees the bytes once they are off the wire, behind anything still being sent
+    wire_free = std::max(clock, wire_free) + byte_time * static_cast<std::chrono::nanoseconds::rep>(len);
+    replies.clear();
+    simulator.receive(data, len, seconds(wire_free), replies);
+    if (!replies.empty()) {
+        std::chrono::nanoseconds arrival =
+            wire_free + latency + byte_time * static_cast<std::chrono::nanoseconds::rep>(replies.size());
+        if (!rx.empty()) {
+            arrival = std::max(arrival, rx.back().arrival);   // One return line, in order
+        }
+        rx.push_back({arrival, replies.size()});
+        rx_bytes.insert(rx_bytes.end(), replies.begin(), replies.end());
+    }
+    return len;
+}
+
+long LoopbackTransport::read(uint8_t* buf, std::size_t cap, std::chrono::nanoseconds timeout) {
+    std::lock_guard<std::mutex> lock(model_mutex);
+    const auto deadline = clock + std::max(timeout, std::chrono::nanoseconds(0));
+    if (rx.empty() || rx.front().arrival > deadline) {
+        clock = deadline;
+        return 0;
+    }
+    clock = std::max(clock, rx.front().arrival);
+
+    // Everything that has arrived by now, like one read() of the driver's buffer
+    std::size_t n = 0;
+    while (!rx.empty() && rx.front().arrival <= clock && n < cap) {
+        Pending& reply = rx.front();
+        const std::size_t take = std::min(reply.len, cap - n);
+        std::copy(rx_bytes.begin(), rx_bytes.begin() + static_cast<std::ptrdiff_t>(take), buf + n);
+        rx_bytes.erase(rx_bytes.begin(), rx_bytes.begin() + static_cast<std::ptrdiff_t>(take));
+        n += take;
+        reply.len -= take;
+        if (reply.len == 0) {
+            rx.pop_front();
+        }
+    }
+    return static_cast<long>(n);
+}
+
+std::chrono::nanoseconds LoopbackTransport::now() const {
+    std::lock_guard<std::mutex> lock(model_mutex);
+    return clock;
+}
+
+void LoopbackTransport::discard_input() {
+    std::lock_guard<std::mutex> lock(model_mutex);
+    // Only what has already arrived; replies still on the wire come in later
+    while (!rx.empty() && rx.front().arrival <= clock) {
+        rx_bytes.erase(rx_bytes.begin(), rx_bytes.begin() + static_cast<std::ptrdiff_t>(rx.front().len));
+        rx.pop_front();
+    }
+}
+
+void LoopbackTransport::advance(std::chrono::nanoseconds duration) {
+    std::lock_guard<std::mutex> lock(model_mutex);
+    clock += std::max(duration, std::chrono::nanoseconds(0));
+}
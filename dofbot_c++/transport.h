@@ -0,0 +1,163 @@
+/**
+ * @file transport.h
+ * @brief Byte transports Arm_Device can drive the board over.
+ *
+ * TtyTransport is the real thing: a serial tty, or the slave side of a
+ * pseudo-terminal such as SimulatedPort::path(). LoopbackTransport wires
+ * Arm_Device straight to an in-process ServoSimulator on a virtual clock:
+ * nothing touches the kernel, waiting for a reply advances the clock instead
+ * of sleeping, and thousands of motion cycles run in milliseconds.
+ *
+ * Arm_Device serialises all calls into its transport (the caller in
+ * synchronous mode, the I/O thread in async mode), so a transport needs no
+ * locking of its own against Arm_Device.
+ */
+
+#ifndef DOFBOT_TRANSPORT_H
+#define DOFBOT_TRANSPORT_H
+
+#include "servo_sim.h"
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+class Transport {
+public:
+    virtual ~Transport() = default;
+
+    /**
+     * @brief Writes up to @p len bytes.
+     * @return Bytes accepted, which may be fewer than @p len.
+     * @throws std::runtime_error on a write error.
+     */
+    virtual std::size_t write(const uint8_t* data, std::size_t len) = 0;
+
+    /**
+     * @brief Waits at most @p timeout for input and reads what has arrived.
+     * @return Bytes read into @p buf (0 if nothing arrived), or -1 on a read error.
+     */
+    virtual long read(uint8_t* buf, std::size_t cap, std::chrono::nanoseconds timeout) = 0;
+
+    /**
+     * @brief Bytes accepted by write() but not yet sent on the wire.
+     */
+    virtual std::size_t tx_backlog() const { return 0; }
+
+    /**
+     * @brief Drops any input received but not yet read.
+     */
+    virtual void discard_input() {}
+
+    /**
+     * @brief Current time on the transport's clock, any monotonic origin.
+     *        Reply deadlines are measured on it.
+     */
+    virtual std::chrono::nanoseconds now() const {
+        return std::chrono::steady_clock::now().time_since_epoch();
+    }
+
+    /**
+     * @brief Port path or backend name, for log messages and metric labels.
+     */
+    virtual const std::string& name() const = 0;
+};
+
+/**
+ * @brief A tty or pty opened in raw 115200 8N1 mode (see serial_port.h).
+ */
+class TtyTransport : public Transport {
+public:
+    /**
+     * @brief Opens @p path. Arm_Device checks the link with a ping handshake
+     *        rather than waiting a fixed time for the port to settle.
+     * @param low_latency Tune the port with set_serial_low_latency().
+     * @throws std::runtime_error if the port cannot be opened or configured.
+     */
+    explicit TtyTransport(const std::string& path, bool low_latency = false);
+    ~TtyTransport() override;
+
+    TtyTransport(const TtyTransport&) = delete;
+    TtyTransport& operator=(const TtyTransport&) = delete;
+
+    std::size_t write(const uint8_t* data, std::size_t len) override;
+    long read(uint8_t* buf, std::size_t cap, std::chrono::nanoseconds timeout) override;
+    std::size_t tx_backlog() const override;
+    void discard_input() override;
+    const std::string& name() const override { return path; }
+
+    int fd() const { return ser_fd; }
+
+    /**
+     * @brief Whether the driver runs the port with ASYNC_LOW_LATENCY.
+     */
+    bool driver_low_latency() const { return low_latency_driver; }
+
+private:
+    std::string path;
+    int ser_fd = -1;
+    bool low_latency_driver = false;
+};
+
+struct LoopbackOptions {
+    SimulatorOptions simulator;    // Fault rates and reply latency of the model
+    double baud = 115200.0;        // Wire speed used to time frames in each direction (8N1)
+};
+
+/**
+ * @brief An in-process ServoSimulator on a virtual clock. Frames reach the
+ *        model after their wire time and replies come back after the
+ *        simulator latency plus theirs; read() jumps the clock forward to the
+ *        next reply (or to its timeout) instead of sleeping. Writes are taken
+ *        whole, so tx_backlog() is always 0.
+ */
+class LoopbackTransport : public Transport {
+public:
+    explicit LoopbackTransport(const LoopbackOptions& options = LoopbackOptions());
+
+    std::size_t write(const uint8_t* data, std::size_t len) override;
+    long read(uint8_t* buf, std::size_t cap, std::chrono::nanoseconds timeout) override;
+    std::chrono::nanoseconds now() const override;
+    void discard_input() override;
+    const std::string& name() const override { return label; }
+
+    /**
+     * @brief Moves the virtual clock forward, e.g. to let a commanded move finish.
+     */
+    void advance(std::chrono::nanoseconds duration);
+
+    /**
+     * @brief Runs @p fn with the simulator and the current virtual time in
+     *        seconds, locked against the thread driving the transport.
+     */
+    template <typename Fn>
+    void inspect(Fn&& fn) const {
+        std::lock_guard<std::mutex> lock(model_mutex);
+        fn(static_cast<const ServoSimulator&>(simulator), seconds(clock));
+    }
+
+private:
+    struct Pending {
+        std::chrono::nanoseconds arrival;
+        std::size_t len;
+    };
+
+    const std::string label = "loopback";
+    const std::chrono::nanoseconds byte_time;
+    const std::chrono::nanoseconds latency;
+    ServoSimulator simulator;
+    mutable std::mutex model_mutex;
+    std::chrono::nanoseconds clock{0};
+    std::chrono::nanoseconds wire_free{0};   // When the host-to-board line goes idle
+    std::deque<Pending> rx;                  // Replies in arrival order
+    std::deque<uint8_t> rx_bytes;            // Their bytes, back to back
+    std::vector<uint8_t> replies;            // Scratch buffer for the simulator
+
+    static double seconds(std::chrono::nanoseconds t) { return std::chrono::duration<double>(t).count(); }
+};
+
+#endif // DOFBOT_TRANSPORT_H